@@ -0,0 +1,110 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HOSTSIM_H_INCLUDED
+#define HOSTSIM_H_INCLUDED
+
+#include <libopencm3/cm3/common.h>
+#include <libopencm3/stm32/timer.h>
+
+/** \file hostsim.h
+ * Interface between the simulated STM32F1 peripherals and the models that
+ * are attached to them (board strapping, motor plant, CAN bus partner).
+ *
+ * Simulated time only advances when the firmware polls hardware from thread
+ * mode, i.e. from term_Run() and the blocking UART functions. Interrupt
+ * handlers run in zero simulated time and are dispatched by priority at the
+ * end of every step, so all interrupt-to-interrupt timing is cycle exact
+ * while the code itself is measured on the host CPU.
+ *
+ * Environment variables:
+ *  - HOSTSIM_SECONDS  stop after this much simulated time
+ *                     (default: 0.1s after stdin reached end of file)
+ *  - HOSTSIM_REALTIME 1: pace simulation to wall clock (default if stdin is a tty)
+ *  - HOSTSIM_HWREV    board strapping rev1|rev2|rev3|tesla|teslam3|bluepill|prius
+ *  - HOSTSIM_FLASH    file that backs the 128k flash, makes parameters persistent
+ *  - HOSTSIM_CANLOG   1: print every transmitted CAN frame to stderr
+ *  - HOSTSIM_MOTOR    attach a motor to the test bench, e.g. pmsm,rs=0.05,ld=0.002
+ *                     or im,rr=0.04
+ *  - HOSTSIM_BENCH    test bench settings, see host/src/model_bench.c
+ */
+
+#define HOSTSIM_CLOCK        72000000
+#define HOSTSIM_US(us)       ((uint64_t)(us) * (HOSTSIM_CLOCK / 1000000))
+#define HOSTSIM_MS(ms)       ((uint64_t)(ms) * (HOSTSIM_CLOCK / 1000))
+#define HOSTSIM_ADC_MAX      4095
+
+BEGIN_DECLS
+
+/** \brief Simulated time since reset in CPU cycles (72MHz) */
+uint64_t hostsim_cycles(void);
+/** \brief Simulated time since reset in seconds */
+double hostsim_time(void);
+/** \brief Limit the step size so a model is called at least every n cycles */
+void hostsim_set_max_step(uint32_t cycles);
+/** \brief Terminate the simulation, calls hostsim_model_exit() */
+void hostsim_exit(int status) __attribute__((noreturn));
+
+/** \brief Name of the simulated board as accepted by HOSTSIM_HWREV */
+const char *hostsim_board(void);
+
+/** \brief Set voltage on an analog pin in ADC digits (0..4095) */
+void hostsim_set_analog(uint32_t port, uint16_t pin, int digits);
+/** \brief Set voltage of an ADC channel in ADC digits (0..4095) */
+void hostsim_set_adc_channel(int channel, int digits);
+
+/** \brief Drive input pins externally to the given level */
+void hostsim_drive_pins(uint32_t port, uint16_t pins, bool level);
+/** \brief Stop driving pins, they float or follow the internal pull resistor */
+void hostsim_release_pins(uint32_t port, uint16_t pins);
+/** \brief Mark pins as not bonded out, they always read 0 */
+void hostsim_remove_pins(uint32_t port, uint16_t pins);
+/** \brief Level of a pin as seen from outside the MCU */
+bool hostsim_get_pin(uint32_t port, uint16_t pin);
+
+/** \brief Count external clock pulses/encoder edges on a timer in encoder mode
+ * \param steps signed number of quadrature edges
+ */
+void hostsim_timer_count(uint32_t timer, int steps);
+/** \brief Signal an edge on a timer input: capture and slave reset */
+void hostsim_timer_capture(uint32_t timer, enum tim_ic_id ic);
+/** \brief State of the output compare reference signal OCxREF, 0 or 1 */
+int hostsim_timer_ocref(uint32_t timer, enum tim_oc_id oc);
+/** \brief Active (shadow) compare value of a channel */
+uint32_t hostsim_timer_compare(uint32_t timer, enum tim_oc_id oc);
+/** \brief Active (shadow) auto reload value */
+uint32_t hostsim_timer_period(uint32_t timer);
+/** \brief true if outputs are enabled via BDTR MOE */
+bool hostsim_timer_outputs_enabled(uint32_t timer);
+
+/** \brief Put a frame on the bus, returns false if no filter matched or FIFO full */
+bool hostsim_can_receive(uint32_t canport, uint32_t id, bool ext, uint8_t length, const uint8_t *data);
+
+/** \brief Model hooks. Weak no-op defaults are provided by the HAL.
+ * hostsim_model_init() is called before main(), hostsim_model_step() before
+ * the peripherals are advanced by dt cycles. Outputs read during the step
+ * are constant for the whole step.
+ */
+void hostsim_model_init(void);
+void hostsim_model_step(uint64_t now, uint32_t dt);
+void hostsim_model_can_tx(uint32_t canport, uint32_t id, bool ext, uint8_t length, const uint8_t *data);
+void hostsim_model_exit(void);
+
+END_DECLS
+
+#endif // HOSTSIM_H_INCLUDED
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Host build replacement for the libopencm3 headers.
+ * Only the subset of the API used by the firmware is provided. Peripheral
+ * registers live at their real addresses, backed by memory that is mapped
+ * by the simulated HAL (host/src/hal_core.c) before main() runs.
+ */
+#ifndef LIBOPENCM3_CM3_COMMON_H
+#define LIBOPENCM3_CM3_COMMON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+#define BEGIN_DECLS extern "C" {
+#define END_DECLS }
+#else
+#define BEGIN_DECLS
+#define END_DECLS
+#endif
+
+#define MMIO8(addr)     (*(volatile uint8_t *)(uintptr_t)(addr))
+#define MMIO16(addr)    (*(volatile uint16_t *)(uintptr_t)(addr))
+#define MMIO32(addr)    (*(volatile uint32_t *)(uintptr_t)(addr))
+#define MMIO64(addr)    (*(volatile uint64_t *)(uintptr_t)(addr))
+
+#define BIT0   (1 << 0)
+#define BIT1   (1 << 1)
+#define BIT2   (1 << 2)
+#define BIT3   (1 << 3)
+#define BIT4   (1 << 4)
+#define BIT5   (1 << 5)
+#define BIT6   (1 << 6)
+#define BIT7   (1 << 7)
+#define BIT8   (1 << 8)
+#define BIT9   (1 << 9)
+#define BIT10  (1 << 10)
+#define BIT11  (1 << 11)
+#define BIT12  (1 << 12)
+#define BIT13  (1 << 13)
+#define BIT14  (1 << 14)
+#define BIT15  (1 << 15)
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_SCB_H
+#define LIBOPENCM3_SCB_H
+
+#include <libopencm3/cm3/common.h>
+
+#define SCB_BASE                    0xE000ED00U
+#define SCB_CPUID                   MMIO32(SCB_BASE + 0x00)
+#define SCB_ICSR                    MMIO32(SCB_BASE + 0x04)
+#define SCB_VTOR                    MMIO32(SCB_BASE + 0x08)
+#define SCB_AIRCR                   MMIO32(SCB_BASE + 0x0C)
+#define SCB_SCR                     MMIO32(SCB_BASE + 0x10)
+#define SCB_CCR                     MMIO32(SCB_BASE + 0x14)
+
+#define SCB_AIRCR_VECTKEY           (0x05FA << 16)
+#define SCB_AIRCR_PRIGROUP_GROUP16_NOSUB   (0x3 << 8)
+#define SCB_AIRCR_PRIGROUP_GROUP8_SUB2     (0x4 << 8)
+#define SCB_AIRCR_PRIGROUP_GROUP4_SUB4     (0x5 << 8)
+#define SCB_AIRCR_PRIGROUP_GROUP2_SUB8     (0x6 << 8)
+#define SCB_AIRCR_PRIGROUP_NOGROUP_SUB16   (0x7 << 8)
+#define SCB_AIRCR_SYSRESETREQ       (1 << 2)
+
+BEGIN_DECLS
+
+void scb_reset_system(void) __attribute__((noreturn));
+
+END_DECLS
+
+#endif
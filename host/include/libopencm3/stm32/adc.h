@@ -0,0 +1,131 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_ADC_H
+#define LIBOPENCM3_ADC_H
+
+#include <libopencm3/stm32/memorymap.h>
+
+#define ADC1                        ADC1_BASE
+#define ADC2                        ADC2_BASE
+
+#define ADC_SR(adc)                 MMIO32((adc) + 0x00)
+#define ADC_CR1(adc)                MMIO32((adc) + 0x04)
+#define ADC_CR2(adc)                MMIO32((adc) + 0x08)
+#define ADC_SMPR1(adc)              MMIO32((adc) + 0x0c)
+#define ADC_SMPR2(adc)              MMIO32((adc) + 0x10)
+#define ADC_JOFR1(adc)              MMIO32((adc) + 0x14)
+#define ADC_JOFR2(adc)              MMIO32((adc) + 0x18)
+#define ADC_JOFR3(adc)              MMIO32((adc) + 0x1c)
+#define ADC_JOFR4(adc)              MMIO32((adc) + 0x20)
+#define ADC_HTR(adc)                MMIO32((adc) + 0x24)
+#define ADC_LTR(adc)                MMIO32((adc) + 0x28)
+#define ADC_SQR1(adc)               MMIO32((adc) + 0x2c)
+#define ADC_SQR2(adc)               MMIO32((adc) + 0x30)
+#define ADC_SQR3(adc)               MMIO32((adc) + 0x34)
+#define ADC_JSQR(adc)               MMIO32((adc) + 0x38)
+#define ADC_JDR1(adc)               MMIO32((adc) + 0x3c)
+#define ADC_JDR2(adc)               MMIO32((adc) + 0x40)
+#define ADC_JDR3(adc)               MMIO32((adc) + 0x44)
+#define ADC_JDR4(adc)               MMIO32((adc) + 0x48)
+#define ADC_DR(adc)                 MMIO32((adc) + 0x4c)
+
+#define ADC_SR_AWD                  (1 << 0)
+#define ADC_SR_EOC                  (1 << 1)
+#define ADC_SR_JEOC                 (1 << 2)
+#define ADC_SR_JSTRT                (1 << 3)
+#define ADC_SR_STRT                 (1 << 4)
+
+#define ADC_CR1_EOCIE               (1 << 5)
+#define ADC_CR1_AWDIE               (1 << 6)
+#define ADC_CR1_JEOCIE              (1 << 7)
+#define ADC_CR1_SCAN                (1 << 8)
+#define ADC_CR1_JAUTO               (1 << 10)
+#define ADC_CR1_DISCEN              (1 << 11)
+#define ADC_CR1_JDISCEN             (1 << 12)
+
+#define ADC_CR2_ADON                (1 << 0)
+#define ADC_CR2_CONT                (1 << 1)
+#define ADC_CR2_CAL                 (1 << 2)
+#define ADC_CR2_RSTCAL              (1 << 3)
+#define ADC_CR2_DMA                 (1 << 8)
+#define ADC_CR2_ALIGN               (1 << 11)
+#define ADC_CR2_JEXTSEL_SHIFT       12
+#define ADC_CR2_JEXTSEL_MASK        (0x7 << 12)
+#define ADC_CR2_JEXTSEL_TIM1_TRGO   (0x0 << 12)
+#define ADC_CR2_JEXTSEL_TIM1_CC4    (0x1 << 12)
+#define ADC_CR2_JEXTSEL_TIM2_TRGO   (0x2 << 12)
+#define ADC_CR2_JEXTSEL_TIM2_CC1    (0x3 << 12)
+#define ADC_CR2_JEXTSEL_TIM3_CC4    (0x4 << 12)
+#define ADC_CR2_JEXTSEL_TIM4_TRGO   (0x5 << 12)
+#define ADC_CR2_JEXTSEL_EXTI15      (0x6 << 12)
+#define ADC_CR2_JEXTSEL_JSWSTART    (0x7 << 12)
+#define ADC_CR2_JEXTTRIG            (1 << 15)
+#define ADC_CR2_EXTSEL_MASK         (0x7 << 17)
+#define ADC_CR2_EXTSEL_SWSTART      (0x7 << 17)
+#define ADC_CR2_EXTTRIG             (1 << 20)
+#define ADC_CR2_JSWSTART            (1 << 21)
+#define ADC_CR2_SWSTART             (1 << 22)
+#define ADC_CR2_TSVREFE             (1 << 23)
+
+#define ADC_SMPR_SMP_1DOT5CYC       0x0
+#define ADC_SMPR_SMP_7DOT5CYC       0x1
+#define ADC_SMPR_SMP_13DOT5CYC      0x2
+#define ADC_SMPR_SMP_28DOT5CYC      0x3
+#define ADC_SMPR_SMP_41DOT5CYC      0x4
+#define ADC_SMPR_SMP_55DOT5CYC      0x5
+#define ADC_SMPR_SMP_71DOT5CYC      0x6
+#define ADC_SMPR_SMP_239DOT5CYC     0x7
+
+#define ADC_SQR_MAX_CHANNELS_REGULAR   16
+#define ADC_JSQR_JL_SHIFT           20
+
+BEGIN_DECLS
+
+void adc_power_on(uint32_t adc);
+void adc_power_off(uint32_t adc);
+void adc_enable_scan_mode(uint32_t adc);
+void adc_disable_scan_mode(uint32_t adc);
+void adc_set_continuous_conversion_mode(uint32_t adc);
+void adc_set_single_conversion_mode(uint32_t adc);
+void adc_set_right_aligned(uint32_t adc);
+void adc_set_left_aligned(uint32_t adc);
+void adc_set_sample_time(uint32_t adc, uint8_t channel, uint8_t time);
+void adc_set_sample_time_on_all_channels(uint32_t adc, uint8_t time);
+void adc_reset_calibration(uint32_t adc);
+void adc_calibrate(uint32_t adc);
+void adc_set_regular_sequence(uint32_t adc, uint8_t length, uint8_t channel[]);
+void adc_set_injected_sequence(uint32_t adc, uint8_t length, uint8_t channel[]);
+void adc_set_injected_offset(uint32_t adc, uint8_t reg, uint32_t offset);
+void adc_enable_dma(uint32_t adc);
+void adc_disable_dma(uint32_t adc);
+void adc_enable_eoc_interrupt_injected(uint32_t adc);
+void adc_disable_eoc_interrupt_injected(uint32_t adc);
+void adc_enable_external_trigger_injected(uint32_t adc, uint32_t trigger);
+void adc_disable_external_trigger_injected(uint32_t adc);
+void adc_start_conversion_regular(uint32_t adc);
+void adc_start_conversion_direct(uint32_t adc);
+void adc_start_conversion_injected(uint32_t adc);
+bool adc_eoc(uint32_t adc);
+bool adc_eoc_injected(uint32_t adc);
+uint32_t adc_read_regular(uint32_t adc);
+uint32_t adc_read_injected(uint32_t adc, uint8_t reg);
+
+END_DECLS
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_CAN_H
+#define LIBOPENCM3_CAN_H
+
+#include <libopencm3/stm32/memorymap.h>
+
+#define CAN1                        BX_CAN1_BASE
+#define CAN2                        BX_CAN2_BASE
+
+#define CAN_MCR(can_base)           MMIO32((can_base) + 0x000)
+#define CAN_MSR(can_base)           MMIO32((can_base) + 0x004)
+#define CAN_TSR(can_base)           MMIO32((can_base) + 0x008)
+#define CAN_RF0R(can_base)          MMIO32((can_base) + 0x00C)
+#define CAN_RF1R(can_base)          MMIO32((can_base) + 0x010)
+#define CAN_IER(can_base)           MMIO32((can_base) + 0x014)
+#define CAN_ESR(can_base)           MMIO32((can_base) + 0x018)
+#define CAN_BTR(can_base)           MMIO32((can_base) + 0x01C)
+#define CAN_FMR(can_base)           MMIO32((can_base) + 0x200)
+#define CAN_FM1R(can_base)          MMIO32((can_base) + 0x204)
+#define CAN_FS1R(can_base)          MMIO32((can_base) + 0x20C)
+#define CAN_FFA1R(can_base)         MMIO32((can_base) + 0x214)
+#define CAN_FA1R(can_base)          MMIO32((can_base) + 0x21C)
+#define CAN_FiR1(can_base, bank)    MMIO32((can_base) + 0x240 + ((bank) * 0x8))
+#define CAN_FiR2(can_base, bank)    MMIO32((can_base) + 0x244 + ((bank) * 0x8))
+
+#define CAN_MCR_INRQ                (1 << 0)
+#define CAN_MCR_ABOM                (1 << 6)
+#define CAN_MSR_INAK                (1 << 0)
+#define CAN_TSR_TME0                (1 << 26)
+#define CAN_TSR_TME1                (1 << 27)
+#define CAN_TSR_TME2                (1 << 28)
+#define CAN_RF0R_FMP0_MASK          (0x3 << 0)
+#define CAN_RF1R_FMP1_MASK          (0x3 << 0)
+
+#define CAN_IER_TMEIE               (1 << 0)
+#define CAN_IER_FMPIE0              (1 << 1)
+#define CAN_IER_FFIE0               (1 << 2)
+#define CAN_IER_FOVIE0              (1 << 3)
+#define CAN_IER_FMPIE1              (1 << 4)
+#define CAN_IER_FFIE1               (1 << 5)
+#define CAN_IER_FOVIE1              (1 << 6)
+
+#define CAN_BTR_SILM                (1 << 31)
+#define CAN_BTR_LBKM                (1 << 30)
+#define CAN_BTR_SJW_1TQ             (0x0 << 24)
+#define CAN_BTR_SJW_2TQ             (0x1 << 24)
+#define CAN_BTR_SJW_3TQ             (0x2 << 24)
+#define CAN_BTR_SJW_4TQ             (0x3 << 24)
+#define CAN_BTR_SJW_MASK            (0x3 << 24)
+#define CAN_BTR_TS2_1TQ             (0x0 << 20)
+#define CAN_BTR_TS2_2TQ             (0x1 << 20)
+#define CAN_BTR_TS2_3TQ             (0x2 << 20)
+#define CAN_BTR_TS2_4TQ             (0x3 << 20)
+#define CAN_BTR_TS2_5TQ             (0x4 << 20)
+#define CAN_BTR_TS2_6TQ             (0x5 << 20)
+#define CAN_BTR_TS2_7TQ             (0x6 << 20)
+#define CAN_BTR_TS2_8TQ             (0x7 << 20)
+#define CAN_BTR_TS2_MASK            (0x7 << 20)
+#define CAN_BTR_TS1_1TQ             (0x0 << 16)
+#define CAN_BTR_TS1_2TQ             (0x1 << 16)
+#define CAN_BTR_TS1_3TQ             (0x2 << 16)
+#define CAN_BTR_TS1_4TQ             (0x3 << 16)
+#define CAN_BTR_TS1_5TQ             (0x4 << 16)
+#define CAN_BTR_TS1_6TQ             (0x5 << 16)
+#define CAN_BTR_TS1_7TQ             (0x6 << 16)
+#define CAN_BTR_TS1_8TQ             (0x7 << 16)
+#define CAN_BTR_TS1_9TQ             (0x8 << 16)
+#define CAN_BTR_TS1_10TQ            (0x9 << 16)
+#define CAN_BTR_TS1_11TQ            (0xA << 16)
+#define CAN_BTR_TS1_12TQ            (0xB << 16)
+#define CAN_BTR_TS1_13TQ            (0xC << 16)
+#define CAN_BTR_TS1_14TQ            (0xD << 16)
+#define CAN_BTR_TS1_15TQ            (0xE << 16)
+#define CAN_BTR_TS1_16TQ            (0xF << 16)
+#define CAN_BTR_TS1_MASK            (0xF << 16)
+#define CAN_BTR_BRP_MASK            (0x3FF << 0)
+
+BEGIN_DECLS
+
+void can_reset(uint32_t canport);
+int can_init(uint32_t canport, bool ttcm, bool abom, bool awum, bool nart,
+             bool rflm, bool txfp, uint32_t sjw, uint32_t ts1, uint32_t ts2,
+             uint32_t brp, bool loopback, bool silent);
+void can_filter_id_list_16bit_init(uint32_t nr, uint16_t id1, uint16_t id2,
+                                   uint16_t id3, uint16_t id4, uint32_t fifo,
+                                   bool enable);
+void can_enable_irq(uint32_t canport, uint32_t irq);
+void can_disable_irq(uint32_t canport, uint32_t irq);
+int can_transmit(uint32_t canport, uint32_t id, bool ext, bool rtr,
+                 uint8_t length, uint8_t *data);
+int can_receive(uint32_t canport, uint8_t fifo, bool release, uint32_t *id,
+                bool *ext, bool *rtr, uint8_t *fmi, uint8_t *length,
+                uint8_t *data, uint16_t *timestamp);
+bool can_available_mailbox(uint32_t canport);
+
+END_DECLS
+
+#endif
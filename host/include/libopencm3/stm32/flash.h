@@ -0,0 +1,46 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_FLASH_H
+#define LIBOPENCM3_FLASH_H
+
+#include <libopencm3/stm32/memorymap.h>
+
+#define FLASH_ACR                   MMIO32(FLASH_MEM_INTERFACE_BASE + 0x00)
+#define FLASH_KEYR                  MMIO32(FLASH_MEM_INTERFACE_BASE + 0x04)
+#define FLASH_SR                    MMIO32(FLASH_MEM_INTERFACE_BASE + 0x0c)
+#define FLASH_CR                    MMIO32(FLASH_MEM_INTERFACE_BASE + 0x10)
+#define FLASH_AR                    MMIO32(FLASH_MEM_INTERFACE_BASE + 0x14)
+
+#define FLASH_CR_LOCK               (1 << 7)
+#define FLASH_ACR_LATENCY_0WS       0x00
+#define FLASH_ACR_LATENCY_1WS       0x01
+#define FLASH_ACR_LATENCY_2WS       0x02
+
+BEGIN_DECLS
+
+void flash_set_ws(uint32_t ws);
+void flash_unlock(void);
+void flash_lock(void);
+void flash_erase_page(uint32_t page_address);
+void flash_program_word(uint32_t address, uint32_t data);
+void flash_program_half_word(uint32_t address, uint16_t data);
+
+END_DECLS
+
+#endif
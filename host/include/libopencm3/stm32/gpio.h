@@ -0,0 +1,128 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_GPIO_H
+#define LIBOPENCM3_GPIO_H
+
+#include <libopencm3/stm32/memorymap.h>
+
+#define GPIOA                       GPIO_PORT_A_BASE
+#define GPIOB                       GPIO_PORT_B_BASE
+#define GPIOC                       GPIO_PORT_C_BASE
+#define GPIOD                       GPIO_PORT_D_BASE
+#define GPIOE                       GPIO_PORT_E_BASE
+
+#define GPIO0                       (1 << 0)
+#define GPIO1                       (1 << 1)
+#define GPIO2                       (1 << 2)
+#define GPIO3                       (1 << 3)
+#define GPIO4                       (1 << 4)
+#define GPIO5                       (1 << 5)
+#define GPIO6                       (1 << 6)
+#define GPIO7                       (1 << 7)
+#define GPIO8                       (1 << 8)
+#define GPIO9                       (1 << 9)
+#define GPIO10                      (1 << 10)
+#define GPIO11                      (1 << 11)
+#define GPIO12                      (1 << 12)
+#define GPIO13                      (1 << 13)
+#define GPIO14                      (1 << 14)
+#define GPIO15                      (1 << 15)
+#define GPIO_ALL                    0xffff
+
+#define GPIO_CRL(port)              MMIO32((port) + 0x00)
+#define GPIO_CRH(port)              MMIO32((port) + 0x04)
+#define GPIO_IDR(port)              MMIO32((port) + 0x08)
+#define GPIO_ODR(port)              MMIO32((port) + 0x0c)
+#define GPIO_BSRR(port)             MMIO32((port) + 0x10)
+#define GPIO_BRR(port)              MMIO32((port) + 0x14)
+#define GPIO_LCKR(port)             MMIO32((port) + 0x18)
+
+#define GPIO_MODE_INPUT             0x00
+#define GPIO_MODE_OUTPUT_10_MHZ     0x01
+#define GPIO_MODE_OUTPUT_2_MHZ      0x02
+#define GPIO_MODE_OUTPUT_50_MHZ     0x03
+
+#define GPIO_CNF_INPUT_ANALOG       0x00
+#define GPIO_CNF_INPUT_FLOAT        0x01
+#define GPIO_CNF_INPUT_PULL_UPDOWN  0x02
+#define GPIO_CNF_OUTPUT_PUSHPULL    0x00
+#define GPIO_CNF_OUTPUT_OPENDRAIN   0x01
+#define GPIO_CNF_OUTPUT_ALTFN_PUSHPULL  0x02
+#define GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN 0x03
+
+#define GPIO_BANK_USART3_TX         GPIOB
+#define GPIO_USART3_TX              GPIO10
+#define GPIO_BANK_USART3_RX         GPIOB
+#define GPIO_USART3_RX              GPIO11
+#define GPIO_BANK_CAN1_RX           GPIOA
+#define GPIO_CAN1_RX                GPIO11
+#define GPIO_BANK_CAN1_TX           GPIOA
+#define GPIO_CAN1_TX                GPIO12
+#define GPIO_BANK_CAN2_RX           GPIOB
+#define GPIO_CAN2_RX                GPIO12
+#define GPIO_BANK_CAN2_TX           GPIOB
+#define GPIO_CAN2_TX                GPIO13
+#define GPIO_BANK_SPI1_SCK          GPIOA
+#define GPIO_SPI1_SCK               GPIO5
+#define GPIO_BANK_SPI1_MISO         GPIOA
+#define GPIO_SPI1_MISO              GPIO6
+#define GPIO_BANK_SPI1_MOSI         GPIOA
+#define GPIO_SPI1_MOSI              GPIO7
+#define GPIO_BANK_SPI1_RE_SCK       GPIOB
+#define GPIO_SPI1_RE_SCK            GPIO3
+#define GPIO_BANK_SPI1_RE_MISO      GPIOB
+#define GPIO_SPI1_RE_MISO           GPIO4
+#define GPIO_BANK_SPI1_RE_MOSI      GPIOB
+#define GPIO_SPI1_RE_MOSI           GPIO5
+
+/* Alternate function IO */
+#define AFIO_EVCR                   MMIO32(AFIO_BASE + 0x00)
+#define AFIO_MAPR                   MMIO32(AFIO_BASE + 0x04)
+#define AFIO_EXTICR1                MMIO32(AFIO_BASE + 0x08)
+#define AFIO_EXTICR2                MMIO32(AFIO_BASE + 0x0c)
+#define AFIO_EXTICR3                MMIO32(AFIO_BASE + 0x10)
+#define AFIO_EXTICR4                MMIO32(AFIO_BASE + 0x14)
+#define AFIO_MAPR2                  MMIO32(AFIO_BASE + 0x1C)
+
+#define AFIO_MAPR_SWJ_MASK                  (0x7 << 24)
+#define AFIO_MAPR_SWJ_CFG_FULL_SWJ          (0x0 << 24)
+#define AFIO_MAPR_SWJ_CFG_FULL_SWJ_NO_JNTRST (0x1 << 24)
+#define AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_ON    (0x2 << 24)
+#define AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_OFF   (0x4 << 24)
+#define AFIO_MAPR_TIM2_REMAP_NO_REMAP       (0x0 << 8)
+#define AFIO_MAPR_TIM2_REMAP_PARTIAL_REMAP1 (0x1 << 8)
+#define AFIO_MAPR_TIM2_REMAP_PARTIAL_REMAP2 (0x2 << 8)
+#define AFIO_MAPR_TIM2_REMAP_FULL_REMAP     (0x3 << 8)
+#define AFIO_MAPR_USART3_REMAP_PARTIAL_REMAP (0x1 << 4)
+#define AFIO_MAPR_SPI1_REMAP                (1 << 0)
+
+BEGIN_DECLS
+
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios);
+void gpio_set(uint32_t gpioport, uint16_t gpios);
+void gpio_clear(uint32_t gpioport, uint16_t gpios);
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios);
+void gpio_toggle(uint32_t gpioport, uint16_t gpios);
+uint16_t gpio_port_read(uint32_t gpioport);
+void gpio_port_write(uint32_t gpioport, uint16_t data);
+void gpio_primary_remap(uint32_t swjenable, uint32_t maps);
+
+END_DECLS
+
+#endif
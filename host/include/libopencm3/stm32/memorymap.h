@@ -0,0 +1,75 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_MEMORYMAP_H
+#define LIBOPENCM3_MEMORYMAP_H
+
+#include <libopencm3/cm3/common.h>
+
+/* STM32F103 (high/connectivity density) memory map */
+#define FLASH_BASE                  0x08000000U
+#define FLASH_SIZE                  0x00020000U
+#define PERIPH_BASE                 0x40000000U
+#define PERIPH_SIZE                 0x00024000U
+#define INFO_BASE                   0x1FFFF000U
+#define INFO_SIZE                   0x00001000U
+#define PPBI_BASE                   0xE0000000U
+#define PPBI_SIZE                   0x00100000U
+
+#define PERIPH_BASE_APB1            (PERIPH_BASE + 0x00000)
+#define PERIPH_BASE_APB2            (PERIPH_BASE + 0x10000)
+#define PERIPH_BASE_AHB             (PERIPH_BASE + 0x18000)
+
+#define TIM2_BASE                   (PERIPH_BASE_APB1 + 0x0000)
+#define TIM3_BASE                   (PERIPH_BASE_APB1 + 0x0400)
+#define TIM4_BASE                   (PERIPH_BASE_APB1 + 0x0800)
+#define RTC_BASE                    (PERIPH_BASE_APB1 + 0x2800)
+#define IWDG_BASE                   (PERIPH_BASE_APB1 + 0x3000)
+#define SPI2_BASE                   (PERIPH_BASE_APB1 + 0x3800)
+#define USART2_BASE                 (PERIPH_BASE_APB1 + 0x4400)
+#define USART3_BASE                 (PERIPH_BASE_APB1 + 0x4800)
+#define BX_CAN1_BASE                (PERIPH_BASE_APB1 + 0x6400)
+#define BX_CAN2_BASE                (PERIPH_BASE_APB1 + 0x6800)
+
+#define AFIO_BASE                   (PERIPH_BASE_APB2 + 0x0000)
+#define EXTI_BASE                   (PERIPH_BASE_APB2 + 0x0400)
+#define GPIO_PORT_A_BASE            (PERIPH_BASE_APB2 + 0x0800)
+#define GPIO_PORT_B_BASE            (PERIPH_BASE_APB2 + 0x0c00)
+#define GPIO_PORT_C_BASE            (PERIPH_BASE_APB2 + 0x1000)
+#define GPIO_PORT_D_BASE            (PERIPH_BASE_APB2 + 0x1400)
+#define GPIO_PORT_E_BASE            (PERIPH_BASE_APB2 + 0x1800)
+#define ADC1_BASE                   (PERIPH_BASE_APB2 + 0x2400)
+#define ADC2_BASE                   (PERIPH_BASE_APB2 + 0x2800)
+#define TIM1_BASE                   (PERIPH_BASE_APB2 + 0x2c00)
+#define SPI1_BASE                   (PERIPH_BASE_APB2 + 0x3000)
+#define USART1_BASE                 (PERIPH_BASE_APB2 + 0x3800)
+
+#define DMA1_BASE                   (PERIPH_BASE_AHB + 0x8000)
+#define DMA2_BASE                   (PERIPH_BASE_AHB + 0x8400)
+#define RCC_BASE                    (PERIPH_BASE_AHB + 0x9000)
+#define FLASH_MEM_INTERFACE_BASE    (PERIPH_BASE_AHB + 0xa000)
+#define CRC_BASE                    (PERIPH_BASE_AHB + 0xb000)
+
+#define DESIG_FLASH_SIZE_BASE       (INFO_BASE + 0x7e0)
+#define DESIG_UNIQUE_ID_BASE        (INFO_BASE + 0x7e8)
+
+#define DESIG_UNIQUE_ID0            MMIO32(DESIG_UNIQUE_ID_BASE + 0x0)
+#define DESIG_UNIQUE_ID1            MMIO32(DESIG_UNIQUE_ID_BASE + 0x4)
+#define DESIG_UNIQUE_ID2            MMIO32(DESIG_UNIQUE_ID_BASE + 0x8)
+
+#endif
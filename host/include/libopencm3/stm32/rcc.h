@@ -0,0 +1,124 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_RCC_H
+#define LIBOPENCM3_RCC_H
+
+#include <libopencm3/stm32/memorymap.h>
+
+#define RCC_CR                      MMIO32(RCC_BASE + 0x00)
+#define RCC_CFGR                    MMIO32(RCC_BASE + 0x04)
+#define RCC_CIR                     MMIO32(RCC_BASE + 0x08)
+#define RCC_APB2RSTR                MMIO32(RCC_BASE + 0x0c)
+#define RCC_APB1RSTR                MMIO32(RCC_BASE + 0x10)
+#define RCC_AHBENR                  MMIO32(RCC_BASE + 0x14)
+#define RCC_APB2ENR                 MMIO32(RCC_BASE + 0x18)
+#define RCC_APB1ENR                 MMIO32(RCC_BASE + 0x1c)
+#define RCC_BDCR                    MMIO32(RCC_BASE + 0x20)
+#define RCC_CSR                     MMIO32(RCC_BASE + 0x24)
+
+#define RCC_CFGR_ADCPRE_SHIFT       14
+#define RCC_CFGR_ADCPRE             (0x3 << RCC_CFGR_ADCPRE_SHIFT)
+#define RCC_CFGR_ADCPRE_PCLK2_DIV2  0x0
+#define RCC_CFGR_ADCPRE_PCLK2_DIV4  0x1
+#define RCC_CFGR_ADCPRE_PCLK2_DIV6  0x2
+#define RCC_CFGR_ADCPRE_PCLK2_DIV8  0x3
+
+#define RCC_APB1ENR_TIM2EN          (1 << 0)
+#define RCC_APB1ENR_TIM3EN          (1 << 1)
+#define RCC_APB1ENR_TIM4EN          (1 << 2)
+#define RCC_APB1ENR_USART3EN        (1 << 18)
+#define RCC_APB1ENR_CAN1EN          (1 << 25)
+#define RCC_APB2ENR_AFIOEN          (1 << 0)
+#define RCC_APB2ENR_ADC1EN          (1 << 9)
+#define RCC_APB2ENR_TIM1EN          (1 << 11)
+#define RCC_APB2ENR_SPI1EN          (1 << 12)
+
+/* Encoding as in libopencm3: register offset << 5 | bit number */
+#define _REG_BIT(base, bit)         (((base) << 5) + (bit))
+
+enum rcc_osc {
+   RCC_PLL, RCC_PLL2, RCC_PLL3, RCC_HSE, RCC_HSI, RCC_LSE, RCC_LSI
+};
+
+enum rcc_periph_clken {
+   RCC_DMA1 = _REG_BIT(0x14, 0),
+   RCC_DMA2 = _REG_BIT(0x14, 1),
+   RCC_CRC = _REG_BIT(0x14, 6),
+
+   RCC_AFIO = _REG_BIT(0x18, 0),
+   RCC_GPIOA = _REG_BIT(0x18, 2),
+   RCC_GPIOB = _REG_BIT(0x18, 3),
+   RCC_GPIOC = _REG_BIT(0x18, 4),
+   RCC_GPIOD = _REG_BIT(0x18, 5),
+   RCC_GPIOE = _REG_BIT(0x18, 6),
+   RCC_ADC1 = _REG_BIT(0x18, 9),
+   RCC_ADC2 = _REG_BIT(0x18, 10),
+   RCC_TIM1 = _REG_BIT(0x18, 11),
+   RCC_SPI1 = _REG_BIT(0x18, 12),
+   RCC_USART1 = _REG_BIT(0x18, 14),
+
+   RCC_TIM2 = _REG_BIT(0x1c, 0),
+   RCC_TIM3 = _REG_BIT(0x1c, 1),
+   RCC_TIM4 = _REG_BIT(0x1c, 2),
+   RCC_SPI2 = _REG_BIT(0x1c, 14),
+   RCC_USART2 = _REG_BIT(0x1c, 17),
+   RCC_USART3 = _REG_BIT(0x1c, 18),
+   RCC_CAN = _REG_BIT(0x1c, 25),
+   RCC_CAN1 = _REG_BIT(0x1c, 25),
+   RCC_CAN2 = _REG_BIT(0x1c, 26),
+   RCC_BKP = _REG_BIT(0x1c, 27),
+   RCC_PWR = _REG_BIT(0x1c, 28),
+};
+
+enum rcc_periph_rst {
+   RST_AFIO = _REG_BIT(0x0c, 0),
+   RST_GPIOA = _REG_BIT(0x0c, 2),
+   RST_GPIOB = _REG_BIT(0x0c, 3),
+   RST_GPIOC = _REG_BIT(0x0c, 4),
+   RST_GPIOD = _REG_BIT(0x0c, 5),
+   RST_ADC1 = _REG_BIT(0x0c, 9),
+   RST_TIM1 = _REG_BIT(0x0c, 11),
+   RST_SPI1 = _REG_BIT(0x0c, 12),
+   RST_USART1 = _REG_BIT(0x0c, 14),
+
+   RST_TIM2 = _REG_BIT(0x10, 0),
+   RST_TIM3 = _REG_BIT(0x10, 1),
+   RST_TIM4 = _REG_BIT(0x10, 2),
+   RST_SPI2 = _REG_BIT(0x10, 14),
+   RST_USART2 = _REG_BIT(0x10, 17),
+   RST_USART3 = _REG_BIT(0x10, 18),
+   RST_CAN1 = _REG_BIT(0x10, 25),
+   RST_CAN2 = _REG_BIT(0x10, 26),
+};
+
+BEGIN_DECLS
+
+extern uint32_t rcc_ahb_frequency;
+extern uint32_t rcc_apb1_frequency;
+extern uint32_t rcc_apb2_frequency;
+
+void rcc_clock_setup_in_hse_8mhz_out_72mhz(void);
+void rcc_set_adcpre(uint32_t adcpre);
+void rcc_periph_clock_enable(enum rcc_periph_clken clken);
+void rcc_periph_clock_disable(enum rcc_periph_clken clken);
+void rcc_periph_reset_pulse(enum rcc_periph_rst rst);
+
+END_DECLS
+
+#endif
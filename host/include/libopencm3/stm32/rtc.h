@@ -0,0 +1,41 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LIBOPENCM3_RTC_H
+#define LIBOPENCM3_RTC_H
+
+#include <libopencm3/stm32/memorymap.h>
+#include <libopencm3/stm32/rcc.h>
+
+#define RTC_CRH                     MMIO32(RTC_BASE + 0x00)
+#define RTC_CRL                     MMIO32(RTC_BASE + 0x04)
+#define RTC_PRLH                    MMIO32(RTC_BASE + 0x08)
+#define RTC_PRLL                    MMIO32(RTC_BASE + 0x0c)
+#define RTC_CNTH                    MMIO32(RTC_BASE + 0x18)
+#define RTC_CNTL                    MMIO32(RTC_BASE + 0x1c)
+
+BEGIN_DECLS
+
+void rtc_auto_awake(enum rcc_osc clock_source, uint32_t prescale_val);
+void rtc_set_prescale_val(uint32_t prescale_val);
+uint32_t rtc_get_counter_val(void);
+void rtc_set_counter_val(uint32_t counter_val);
+
+END_DECLS
+
+#endif
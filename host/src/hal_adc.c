@@ -0,0 +1,377 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/adc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/cm3/nvic.h>
+#include "hal_internal.h"
+
+#define NUM_CHANNELS   18
+#define DMA_CHANNEL    1
+
+//Current sensors idle at mid scale (il1 on PA5, il2 on PB0)
+static int analogValues[NUM_CHANNELS] = { [5] = 2048, [8] = 2048 };
+static bool regularRunning = false;
+static int regularIndex = 0;
+static uint32_t regularCycles = 0;
+
+/** Sample time in half ADC clocks, indexed by SMP value */
+static const uint32_t sampleHalfCycles[] = { 3, 15, 27, 57, 83, 111, 143, 479 };
+
+static uint32_t sample_time(int channel)
+{
+   uint32_t reg = channel < 10 ? ADC_SMPR2(ADC1) : ADC_SMPR1(ADC1);
+   return (reg >> ((channel % 10) * 3)) & 0x7;
+}
+
+/** CPU cycles needed for one conversion */
+static uint32_t conversion_cycles(int channel)
+{
+   static const uint32_t prescalers[] = { 2, 4, 6, 8 };
+   uint32_t adcpre = prescalers[(RCC_CFGR & RCC_CFGR_ADCPRE) >> RCC_CFGR_ADCPRE_SHIFT];
+
+   //Sample time plus 12.5 clocks successive approximation
+   return (sampleHalfCycles[sample_time(channel)] + 25) * adcpre / 2;
+}
+
+static int regular_length(void)
+{
+   return ((ADC_SQR1(ADC1) >> 20) & 0xF) + 1;
+}
+
+static int regular_channel(int index)
+{
+   volatile uint32_t *sqr = index < 6 ? &ADC_SQR3(ADC1) : index < 12 ? &ADC_SQR2(ADC1) : &ADC_SQR1(ADC1);
+   return (*sqr >> ((index % 6) * 5)) & 0x1F;
+}
+
+static uint16_t convert(uint32_t adc, int channel)
+{
+   int value = channel < NUM_CHANNELS ? analogValues[channel] : 0;
+
+   if (value < 0) value = 0;
+   if (value > HOSTSIM_ADC_MAX) value = HOSTSIM_ADC_MAX;
+
+   return ADC_CR2(adc) & ADC_CR2_ALIGN ? value << 4 : value;
+}
+
+static void start_regular(void)
+{
+   if (!(ADC_CR2(ADC1) & ADC_CR2_ADON)) return;
+
+   regularRunning = true;
+   regularIndex = 0;
+   regularCycles = 0;
+   ADC_SR(ADC1) |= ADC_SR_STRT;
+}
+
+/** ADC1 and ADC2 share the analog inputs, only ADC1 runs regular conversions */
+static void convert_injected(uint32_t adc)
+{
+   uint32_t jsqr = ADC_JSQR(adc);
+   int jl = (jsqr >> ADC_JSQR_JL_SHIFT) & 0x3;
+
+   if (!(ADC_CR2(adc) & ADC_CR2_ADON)) return;
+
+   //A sequence shorter than 4 starts at JSQ(4 - JL)
+   for (int k = 0; k <= jl; k++)
+   {
+      int jsq = 3 - jl + k;
+      int channel = (jsqr >> (jsq * 5)) & 0x1F;
+      int16_t value = (int16_t)convert(adc, channel) - (int16_t)(*(&ADC_JOFR1(adc) + k) & 0xFFF);
+
+      *(&ADC_JDR1(adc) + k) = (uint16_t)value;
+   }
+
+   ADC_SR(adc) |= ADC_SR_JSTRT | ADC_SR_JEOC;
+}
+
+bool hal_adc_injected_trigger(uint32_t adc, uint32_t *jextsel)
+{
+   uint32_t cr2 = ADC_CR2(adc);
+
+   *jextsel = (cr2 & ADC_CR2_JEXTSEL_MASK) >> ADC_CR2_JEXTSEL_SHIFT;
+   return (cr2 & ADC_CR2_JEXTTRIG) != 0;
+}
+
+void hal_adc_trigger_injected(uint32_t jextsel)
+{
+   static const uint32_t adcs[] = { ADC1, ADC2 };
+
+   for (unsigned i = 0; i < sizeof(adcs) / sizeof(adcs[0]); i++)
+   {
+      uint32_t selected;
+
+      if (hal_adc_injected_trigger(adcs[i], &selected) && selected == jextsel)
+         convert_injected(adcs[i]);
+   }
+}
+
+void hal_adc_trigger_regular(uint32_t extsel)
+{
+   uint32_t cr2 = ADC_CR2(ADC1);
+
+   if ((cr2 & ADC_CR2_EXTTRIG) && ((cr2 & ADC_CR2_EXTSEL_MASK) >> 17) == extsel && !regularRunning)
+      start_regular();
+}
+
+void hal_adc_advance(uint32_t cycles)
+{
+   if (!regularRunning) return;
+
+   regularCycles += cycles;
+
+   for (;;)
+   {
+      int channel = regular_channel(regularIndex);
+      uint32_t needed = conversion_cycles(channel);
+
+      if (regularCycles < needed) break;
+
+      regularCycles -= needed;
+      ADC_DR(ADC1) = convert(ADC1, channel);
+      ADC_SR(ADC1) |= ADC_SR_EOC;
+
+      if (ADC_CR2(ADC1) & ADC_CR2_DMA)
+         hal_dma_request(DMA_CHANNEL);
+
+      regularIndex = (ADC_CR1(ADC1) & ADC_CR1_SCAN) ? regularIndex + 1 : regular_length();
+
+      if (regularIndex >= regular_length())
+      {
+         regularIndex = 0;
+
+         if (!(ADC_CR2(ADC1) & ADC_CR2_CONT))
+         {
+            regularRunning = false;
+            break;
+         }
+      }
+   }
+}
+
+bool hal_adc_irq_pending(int irqn)
+{
+   static const uint32_t adcs[] = { ADC1, ADC2 };
+
+   if (irqn != NVIC_ADC1_2_IRQ) return false;
+
+   for (unsigned i = 0; i < sizeof(adcs) / sizeof(adcs[0]); i++)
+   {
+      uint32_t sr = ADC_SR(adcs[i]);
+      uint32_t cr1 = ADC_CR1(adcs[i]);
+
+      if (((sr & ADC_SR_JEOC) && (cr1 & ADC_CR1_JEOCIE)) ||
+          ((sr & ADC_SR_EOC) && (cr1 & ADC_CR1_EOCIE)))
+         return true;
+   }
+   return false;
+}
+
+/* Model interface */
+void hostsim_set_adc_channel(int channel, int digits)
+{
+   if (channel >= 0 && channel < NUM_CHANNELS)
+      analogValues[channel] = digits;
+}
+
+/** Same mapping as AnaIn::AdcChFromPort() */
+void hostsim_set_analog(uint32_t port, uint16_t pin, int digits)
+{
+   switch (port)
+   {
+   case GPIOA: hostsim_set_adc_channel(pin, digits); break;
+   case GPIOB: hostsim_set_adc_channel(8 + pin, digits); break;
+   case GPIOC: hostsim_set_adc_channel(10 + pin, digits); break;
+   default: break;
+   }
+}
+
+/* libopencm3 API */
+void adc_power_on(uint32_t adc)
+{
+   ADC_CR2(adc) |= ADC_CR2_ADON;
+}
+
+void adc_power_off(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_ADON;
+
+   if (adc == ADC1)
+      regularRunning = false;
+}
+
+void adc_enable_scan_mode(uint32_t adc)
+{
+   ADC_CR1(adc) |= ADC_CR1_SCAN;
+}
+
+void adc_disable_scan_mode(uint32_t adc)
+{
+   ADC_CR1(adc) &= ~ADC_CR1_SCAN;
+}
+
+void adc_set_continuous_conversion_mode(uint32_t adc)
+{
+   ADC_CR2(adc) |= ADC_CR2_CONT;
+}
+
+void adc_set_single_conversion_mode(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_CONT;
+}
+
+void adc_set_right_aligned(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_ALIGN;
+}
+
+void adc_set_left_aligned(uint32_t adc)
+{
+   ADC_CR2(adc) |= ADC_CR2_ALIGN;
+}
+
+void adc_set_sample_time(uint32_t adc, uint8_t channel, uint8_t time)
+{
+   volatile uint32_t *smpr = channel < 10 ? &ADC_SMPR2(adc) : &ADC_SMPR1(adc);
+   uint32_t shift = (channel % 10) * 3;
+
+   *smpr = (*smpr & ~(0x7U << shift)) | ((uint32_t)(time & 0x7) << shift);
+}
+
+void adc_set_sample_time_on_all_channels(uint32_t adc, uint8_t time)
+{
+   for (uint8_t channel = 0; channel < NUM_CHANNELS; channel++)
+      adc_set_sample_time(adc, channel, time);
+}
+
+void adc_reset_calibration(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_RSTCAL; //Completes instantly
+}
+
+void adc_calibrate(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_CAL; //Completes instantly
+}
+
+void adc_set_regular_sequence(uint32_t adc, uint8_t length, uint8_t channel[])
+{
+   uint32_t sqr[3] = { 0, 0, 0 };
+
+   if (length < 1 || length > ADC_SQR_MAX_CHANNELS_REGULAR) return;
+
+   for (int i = 0; i < length; i++)
+      sqr[i / 6] |= (uint32_t)(channel[i] & 0x1F) << ((i % 6) * 5);
+
+   ADC_SQR3(adc) = sqr[0];
+   ADC_SQR2(adc) = sqr[1];
+   ADC_SQR1(adc) = sqr[2] | ((uint32_t)(length - 1) << 20);
+}
+
+void adc_set_injected_sequence(uint32_t adc, uint8_t length, uint8_t channel[])
+{
+   uint32_t jsqr = 0;
+
+   if (length < 1 || length > 4) return;
+
+   //Last channel goes to JSQ4
+   for (int i = 0; i < length; i++)
+      jsqr |= (uint32_t)(channel[length - i - 1] & 0x1F) << ((3 - i) * 5);
+
+   ADC_JSQR(adc) = jsqr | ((uint32_t)(length - 1) << ADC_JSQR_JL_SHIFT);
+}
+
+void adc_set_injected_offset(uint32_t adc, uint8_t reg, uint32_t offset)
+{
+   if (reg >= 1 && reg <= 4)
+      *(&ADC_JOFR1(adc) + reg - 1) = offset & 0xFFF;
+}
+
+void adc_enable_dma(uint32_t adc)
+{
+   ADC_CR2(adc) |= ADC_CR2_DMA;
+}
+
+void adc_disable_dma(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_DMA;
+}
+
+void adc_enable_eoc_interrupt_injected(uint32_t adc)
+{
+   ADC_CR1(adc) |= ADC_CR1_JEOCIE;
+}
+
+void adc_disable_eoc_interrupt_injected(uint32_t adc)
+{
+   ADC_CR1(adc) &= ~ADC_CR1_JEOCIE;
+}
+
+void adc_enable_external_trigger_injected(uint32_t adc, uint32_t trigger)
+{
+   ADC_CR2(adc) = (ADC_CR2(adc) & ~ADC_CR2_JEXTSEL_MASK) | trigger | ADC_CR2_JEXTTRIG;
+}
+
+void adc_disable_external_trigger_injected(uint32_t adc)
+{
+   ADC_CR2(adc) &= ~ADC_CR2_JEXTTRIG;
+}
+
+void adc_start_conversion_regular(uint32_t adc)
+{
+   (void)adc;
+   if (!regularRunning)
+      start_regular();
+}
+
+void adc_start_conversion_direct(uint32_t adc)
+{
+   (void)adc;
+   if (!regularRunning)
+      start_regular();
+}
+
+void adc_start_conversion_injected(uint32_t adc)
+{
+   if ((ADC_CR2(adc) & ADC_CR2_JEXTSEL_MASK) == ADC_CR2_JEXTSEL_JSWSTART)
+      convert_injected(adc);
+}
+
+bool adc_eoc(uint32_t adc)
+{
+   return (ADC_SR(adc) & ADC_SR_EOC) != 0;
+}
+
+bool adc_eoc_injected(uint32_t adc)
+{
+   return (ADC_SR(adc) & ADC_SR_JEOC) != 0;
+}
+
+uint32_t adc_read_regular(uint32_t adc)
+{
+   ADC_SR(adc) &= ~ADC_SR_EOC;
+   return ADC_DR(adc);
+}
+
+uint32_t adc_read_injected(uint32_t adc, uint8_t reg)
+{
+   if (reg < 1 || reg > 4) return 0;
+   return *(&ADC_JDR1(adc) + reg - 1);
+}
@@ -0,0 +1,259 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libopencm3/stm32/can.h>
+#include <libopencm3/cm3/nvic.h>
+#include "hal_internal.h"
+
+#define NUM_PORTS      2
+#define NUM_FIFOS      2
+#define FIFO_DEPTH     3
+#define NUM_BANKS      28
+
+struct can_message
+{
+   uint32_t id;
+   bool ext;
+   uint8_t fmi;
+   uint8_t length;
+   uint8_t data[8];
+};
+
+struct can_fifo
+{
+   struct can_message messages[FIFO_DEPTH];
+   int count;
+};
+
+static struct can_fifo fifos[NUM_PORTS][NUM_FIFOS];
+
+static int port_index(uint32_t canport)
+{
+   return canport == CAN2 ? 1 : 0;
+}
+
+static volatile uint32_t* rfr(uint32_t canport, int fifo)
+{
+   return fifo == 0 ? &CAN_RF0R(canport) : &CAN_RF1R(canport);
+}
+
+__attribute__((weak)) void hostsim_model_can_tx(uint32_t canport, uint32_t id, bool ext, uint8_t length, const uint8_t *data)
+{
+   static int log = -1;
+
+   if (log < 0)
+      log = getenv("HOSTSIM_CANLOG") != NULL;
+
+   if (log)
+   {
+      fprintf(stderr, "%.6f can%d tx %0*x [%d]", hostsim_time(), port_index(canport) + 1, ext ? 8 : 3, id, length);
+      for (int i = 0; i < length; i++)
+         fprintf(stderr, " %02x", data[i]);
+      fprintf(stderr, "\n");
+   }
+}
+
+/** Find the filter that accepts a standard identifier.
+ * Filters are 16 bit identifier lists, 4 entries per bank. */
+static bool match_filter(uint32_t id, bool ext, int *fifo, uint8_t *fmi)
+{
+   uint16_t value = (uint16_t)(id << 5);
+   uint8_t index[NUM_FIFOS] = { 0, 0 };
+
+   if (ext) return false;
+
+   for (int bank = 0; bank < NUM_BANKS; bank++)
+   {
+      uint32_t mask = 1U << bank;
+      int assigned = (CAN_FFA1R(CAN1) & mask) ? 1 : 0;
+
+      if (!(CAN_FA1R(CAN1) & mask)) continue;
+
+      uint32_t r1 = CAN_FiR1(CAN1, bank);
+      uint32_t r2 = CAN_FiR2(CAN1, bank);
+      uint16_t ids[4] = { (uint16_t)r1, (uint16_t)(r1 >> 16), (uint16_t)r2, (uint16_t)(r2 >> 16) };
+
+      for (int i = 0; i < 4; i++)
+      {
+         if (ids[i] == value)
+         {
+            *fifo = assigned;
+            *fmi = index[assigned] + i;
+            return true;
+         }
+      }
+      index[assigned] += 4;
+   }
+   return false;
+}
+
+bool hal_can_irq_pending(int irqn)
+{
+   uint32_t canport;
+   int fifo = -1;
+
+   switch (irqn)
+   {
+   case NVIC_USB_HP_CAN_TX_IRQ: canport = CAN1; break;
+   case NVIC_USB_LP_CAN_RX0_IRQ: canport = CAN1; fifo = 0; break;
+   case NVIC_CAN_RX1_IRQ: canport = CAN1; fifo = 1; break;
+   case NVIC_CAN2_TX_IRQ: canport = CAN2; break;
+   case NVIC_CAN2_RX0_IRQ: canport = CAN2; fifo = 0; break;
+   case NVIC_CAN2_RX1_IRQ: canport = CAN2; fifo = 1; break;
+   default: return false;
+   }
+
+   if (fifo < 0)
+      return (CAN_IER(canport) & CAN_IER_TMEIE) && (CAN_TSR(canport) & CAN_TSR_TME0);
+
+   uint32_t enable = fifo == 0 ? CAN_IER_FMPIE0 : CAN_IER_FMPIE1;
+   return (CAN_IER(canport) & enable) && fifos[port_index(canport)][fifo].count > 0;
+}
+
+/* Model interface */
+bool hostsim_can_receive(uint32_t canport, uint32_t id, bool ext, uint8_t length, const uint8_t *data)
+{
+   int fifo;
+   uint8_t fmi;
+
+   if ((CAN_MCR(canport) & CAN_MCR_INRQ) || !match_filter(id, ext, &fifo, &fmi))
+      return false;
+
+   struct can_fifo *f = &fifos[port_index(canport)][fifo];
+
+   if (f->count >= FIFO_DEPTH)
+      return false; //Overrun
+
+   struct can_message *msg = &f->messages[f->count++];
+   msg->id = id;
+   msg->ext = ext;
+   msg->fmi = fmi;
+   msg->length = length > 8 ? 8 : length;
+   memcpy(msg->data, data, msg->length);
+   *rfr(canport, fifo) = f->count;
+   return true;
+}
+
+/* libopencm3 API */
+void can_reset(uint32_t canport)
+{
+   int port = port_index(canport);
+
+   for (uint32_t ofs = 0; ofs <= 0x1C; ofs += 4)
+      MMIO32(canport + ofs) = 0;
+
+   CAN_MCR(canport) = 0x10002;
+   CAN_MSR(canport) = 0xC02;
+   CAN_TSR(canport) = CAN_TSR_TME0 | CAN_TSR_TME1 | CAN_TSR_TME2;
+   fifos[port][0].count = fifos[port][1].count = 0;
+}
+
+int can_init(uint32_t canport, bool ttcm, bool abom, bool awum, bool nart,
+             bool rflm, bool txfp, uint32_t sjw, uint32_t ts1, uint32_t ts2,
+             uint32_t brp, bool loopback, bool silent)
+{
+   (void)ttcm; (void)awum; (void)nart; (void)rflm; (void)txfp;
+
+   CAN_MCR(canport) = abom ? CAN_MCR_ABOM : 0;
+   CAN_MSR(canport) &= ~CAN_MSR_INAK;
+   CAN_BTR(canport) = sjw | ts1 | ts2 | ((brp - 1) & CAN_BTR_BRP_MASK) |
+                      (loopback ? CAN_BTR_LBKM : 0) | (silent ? CAN_BTR_SILM : 0);
+   CAN_TSR(canport) = CAN_TSR_TME0 | CAN_TSR_TME1 | CAN_TSR_TME2;
+   return 0;
+}
+
+void can_filter_id_list_16bit_init(uint32_t nr, uint16_t id1, uint16_t id2,
+                                   uint16_t id3, uint16_t id4, uint32_t fifo,
+                                   bool enable)
+{
+   uint32_t mask = 1U << nr;
+
+   CAN_FMR(CAN1) |= 1; //FINIT
+   CAN_FA1R(CAN1) &= ~mask;
+   CAN_FS1R(CAN1) &= ~mask;
+   CAN_FM1R(CAN1) |= mask;
+   CAN_FiR1(CAN1, nr) = ((uint32_t)id2 << 16) | id1;
+   CAN_FiR2(CAN1, nr) = ((uint32_t)id4 << 16) | id3;
+
+   if (fifo)
+      CAN_FFA1R(CAN1) |= mask;
+   else
+      CAN_FFA1R(CAN1) &= ~mask;
+
+   if (enable)
+      CAN_FA1R(CAN1) |= mask;
+
+   CAN_FMR(CAN1) &= ~1;
+}
+
+void can_enable_irq(uint32_t canport, uint32_t irq)
+{
+   CAN_IER(canport) |= irq;
+}
+
+void can_disable_irq(uint32_t canport, uint32_t irq)
+{
+   CAN_IER(canport) &= ~irq;
+}
+
+int can_transmit(uint32_t canport, uint32_t id, bool ext, bool rtr,
+                 uint8_t length, uint8_t *data)
+{
+   (void)rtr;
+
+   //Frames leave the mailbox instantly, so one is always available
+   hostsim_model_can_tx(canport, id, ext, length, data);
+   return 0;
+}
+
+int can_receive(uint32_t canport, uint8_t fifo, bool release, uint32_t *id,
+                bool *ext, bool *rtr, uint8_t *fmi, uint8_t *length,
+                uint8_t *data, uint16_t *timestamp)
+{
+   struct can_fifo *f = &fifos[port_index(canport)][fifo & 1];
+
+   if (f->count == 0) return 0;
+
+   struct can_message *msg = &f->messages[0];
+
+   *id = msg->id;
+   *ext = msg->ext;
+   *rtr = false;
+   *fmi = msg->fmi;
+   *length = msg->length;
+   memcpy(data, msg->data, msg->length);
+
+   if (timestamp)
+      *timestamp = (uint16_t)hal_now;
+
+   if (release)
+   {
+      f->count--;
+      memmove(&f->messages[0], &f->messages[1], f->count * sizeof(struct can_message));
+      *rfr(canport, fifo & 1) = f->count;
+   }
+   return 1;
+}
+
+bool can_available_mailbox(uint32_t canport)
+{
+   return (CAN_TSR(canport) & CAN_TSR_TME0) != 0;
+}
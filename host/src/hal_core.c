@@ -0,0 +1,426 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
+#include <libopencm3/cm3/dwt.h>
+#include <libopencm3/cm3/cortex.h>
+#include "hal_internal.h"
+
+#define DEFAULT_MAX_STEP   HOSTSIM_US(100)
+#define EOF_GRACE_TIME     HOSTSIM_MS(100)
+#define THREAD_PRIORITY    0x100
+#define IRQ_STORM_LIMIT    100000
+
+uint64_t hal_now = 0;
+int hal_isr_depth = 0;
+
+static uint32_t maxStep = DEFAULT_MAX_STEP;
+static uint64_t endTime = HAL_NEVER;
+static bool endOnEof = true;
+static bool realtime = false;
+static struct timespec wallStart;
+static int activePriority = THREAD_PRIORITY;
+static bool primask = false;
+static volatile sig_atomic_t interrupted = 0;
+
+/* Interrupt vector table. Handlers not defined by the firmware fall back
+ * to hal_default_handler, just like the weak aliases of libopencm3. */
+void hal_default_handler(void) {}
+
+#define WEAK_ISR(name) void name(void) __attribute__((weak, alias("hal_default_handler")));
+WEAK_ISR(exti0_isr)
+WEAK_ISR(exti1_isr)
+WEAK_ISR(exti2_isr)
+WEAK_ISR(exti3_isr)
+WEAK_ISR(exti4_isr)
+WEAK_ISR(dma1_channel1_isr)
+WEAK_ISR(dma1_channel2_isr)
+WEAK_ISR(dma1_channel3_isr)
+WEAK_ISR(dma1_channel4_isr)
+WEAK_ISR(dma1_channel5_isr)
+WEAK_ISR(dma1_channel6_isr)
+WEAK_ISR(dma1_channel7_isr)
+WEAK_ISR(adc1_2_isr)
+WEAK_ISR(usb_hp_can_tx_isr)
+WEAK_ISR(usb_lp_can_rx0_isr)
+WEAK_ISR(can_rx1_isr)
+WEAK_ISR(can_sce_isr)
+WEAK_ISR(exti9_5_isr)
+WEAK_ISR(tim1_brk_isr)
+WEAK_ISR(tim1_up_isr)
+WEAK_ISR(tim1_trg_com_isr)
+WEAK_ISR(tim1_cc_isr)
+WEAK_ISR(tim2_isr)
+WEAK_ISR(tim3_isr)
+WEAK_ISR(tim4_isr)
+WEAK_ISR(spi1_isr)
+WEAK_ISR(spi2_isr)
+WEAK_ISR(usart1_isr)
+WEAK_ISR(usart2_isr)
+WEAK_ISR(usart3_isr)
+WEAK_ISR(exti15_10_isr)
+WEAK_ISR(can2_tx_isr)
+WEAK_ISR(can2_rx0_isr)
+WEAK_ISR(can2_rx1_isr)
+WEAK_ISR(can2_sce_isr)
+
+static void (*const vectors[NVIC_IRQ_COUNT])(void) = {
+   [NVIC_EXTI0_IRQ] = exti0_isr,
+   [NVIC_EXTI1_IRQ] = exti1_isr,
+   [NVIC_EXTI2_IRQ] = exti2_isr,
+   [NVIC_EXTI3_IRQ] = exti3_isr,
+   [NVIC_EXTI4_IRQ] = exti4_isr,
+   [NVIC_DMA1_CHANNEL1_IRQ] = dma1_channel1_isr,
+   [NVIC_DMA1_CHANNEL2_IRQ] = dma1_channel2_isr,
+   [NVIC_DMA1_CHANNEL3_IRQ] = dma1_channel3_isr,
+   [NVIC_DMA1_CHANNEL4_IRQ] = dma1_channel4_isr,
+   [NVIC_DMA1_CHANNEL5_IRQ] = dma1_channel5_isr,
+   [NVIC_DMA1_CHANNEL6_IRQ] = dma1_channel6_isr,
+   [NVIC_DMA1_CHANNEL7_IRQ] = dma1_channel7_isr,
+   [NVIC_ADC1_2_IRQ] = adc1_2_isr,
+   [NVIC_USB_HP_CAN_TX_IRQ] = usb_hp_can_tx_isr,
+   [NVIC_USB_LP_CAN_RX0_IRQ] = usb_lp_can_rx0_isr,
+   [NVIC_CAN_RX1_IRQ] = can_rx1_isr,
+   [NVIC_CAN_SCE_IRQ] = can_sce_isr,
+   [NVIC_EXTI9_5_IRQ] = exti9_5_isr,
+   [NVIC_TIM1_BRK_IRQ] = tim1_brk_isr,
+   [NVIC_TIM1_UP_IRQ] = tim1_up_isr,
+   [NVIC_TIM1_TRG_COM_IRQ] = tim1_trg_com_isr,
+   [NVIC_TIM1_CC_IRQ] = tim1_cc_isr,
+   [NVIC_TIM2_IRQ] = tim2_isr,
+   [NVIC_TIM3_IRQ] = tim3_isr,
+   [NVIC_TIM4_IRQ] = tim4_isr,
+   [NVIC_SPI1_IRQ] = spi1_isr,
+   [NVIC_SPI2_IRQ] = spi2_isr,
+   [NVIC_USART1_IRQ] = usart1_isr,
+   [NVIC_USART2_IRQ] = usart2_isr,
+   [NVIC_USART3_IRQ] = usart3_isr,
+   [NVIC_EXTI15_10_IRQ] = exti15_10_isr,
+   [NVIC_CAN2_TX_IRQ] = can2_tx_isr,
+   [NVIC_CAN2_RX0_IRQ] = can2_rx0_isr,
+   [NVIC_CAN2_RX1_IRQ] = can2_rx1_isr,
+   [NVIC_CAN2_SCE_IRQ] = can2_sce_isr,
+};
+
+/* Default model hooks, overridden by linking a model */
+__attribute__((weak)) void hostsim_model_init(void) {}
+__attribute__((weak)) void hostsim_model_step(uint64_t now, uint32_t dt) { (void)now; (void)dt; }
+__attribute__((weak)) void hostsim_model_exit(void) {}
+
+static void map_region(uint32_t base, uint32_t size)
+{
+   void *addr = mmap((void*)(uintptr_t)base, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+   if (addr != (void*)(uintptr_t)base)
+   {
+      fprintf(stderr, "hostsim: cannot map peripheral region at 0x%08x\n", base);
+      exit(1);
+   }
+}
+
+static void on_sigint(int sig)
+{
+   (void)sig;
+   interrupted = 1;
+}
+
+static void read_environment(void)
+{
+   const char *env = getenv("HOSTSIM_SECONDS");
+
+   if (env != NULL)
+   {
+      endTime = (uint64_t)(strtod(env, NULL) * HOSTSIM_CLOCK);
+      endOnEof = false;
+   }
+
+   env = getenv("HOSTSIM_REALTIME");
+
+   if (env != NULL)
+      realtime = atoi(env) != 0;
+   else
+      realtime = isatty(0);
+
+   clock_gettime(CLOCK_MONOTONIC, &wallStart);
+}
+
+/** Runs before any C++ constructor of the firmware */
+__attribute__((constructor(101))) static void hal_init(void)
+{
+   map_region(PERIPH_BASE, PERIPH_SIZE);
+   map_region(PPBI_BASE, PPBI_SIZE);
+   map_region(INFO_BASE, INFO_SIZE);
+   hal_flash_init();
+
+   SCB_CPUID = 0x411FC231; //Cortex-M3 r1p1
+   MMIO16(DESIG_FLASH_SIZE_BASE) = FLASH_SIZE / 1024;
+   DESIG_UNIQUE_ID0 = 0x0669ff48;
+   DESIG_UNIQUE_ID1 = 0x48545750;
+   DESIG_UNIQUE_ID2 = 0x87122447;
+
+   read_environment();
+   hal_gpio_init();
+   hal_timer_init();
+   hal_usart_init();
+   signal(SIGINT, on_sigint);
+   hostsim_model_init();
+}
+
+static bool irq_pending(int irqn)
+{
+   if (NVIC_ISPR(irqn / 32) & (1U << (irqn % 32)))
+      return true;
+
+   return hal_timer_irq_pending(irqn) || hal_exti_irq_pending(irqn) ||
+          hal_can_irq_pending(irqn) || hal_dma_irq_pending(irqn) ||
+          hal_adc_irq_pending(irqn);
+}
+
+/** Run all enabled and pending interrupt handlers with a priority higher
+ * than the currently active one, highest priority first */
+void hal_dispatch(void)
+{
+   int lastIrq = -1, repeat = 0;
+
+   if (primask) return;
+
+   for (;;)
+   {
+      int best = -1;
+      int bestPriority = activePriority;
+
+      for (int irqn = 0; irqn < NVIC_IRQ_COUNT; irqn++)
+      {
+         if (!(NVIC_ISER(irqn / 32) & (1U << (irqn % 32)))) continue;
+
+         int priority = NVIC_IPR(irqn) & 0xF0;
+
+         if (priority < bestPriority && irq_pending(irqn))
+         {
+            best = irqn;
+            bestPriority = priority;
+         }
+      }
+
+      if (best < 0) break;
+
+      if (vectors[best] == hal_default_handler || vectors[best] == NULL)
+      {
+         fprintf(stderr, "hostsim: no handler for enabled IRQ %d, disabling it\n", best);
+         nvic_disable_irq(best);
+         continue;
+      }
+
+      repeat = best == lastIrq ? repeat + 1 : 0;
+      lastIrq = best;
+
+      if (repeat > IRQ_STORM_LIMIT)
+      {
+         fprintf(stderr, "hostsim: IRQ %d keeps firing without clearing its flag\n", best);
+         hostsim_exit(2);
+      }
+
+      int savedPriority = activePriority;
+      NVIC_ISPR(best / 32) &= ~(1U << (best % 32));
+      activePriority = bestPriority;
+      hal_isr_depth++;
+      vectors[best]();
+      hal_isr_depth--;
+      activePriority = savedPriority;
+   }
+}
+
+static void pace_realtime(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   int64_t wallNs = (now.tv_sec - wallStart.tv_sec) * 1000000000LL + (now.tv_nsec - wallStart.tv_nsec);
+   int64_t simNs = (int64_t)(hal_now * 1000 / (HOSTSIM_CLOCK / 1000000));
+   int64_t ahead = simNs - wallNs;
+
+   if (ahead > 1000000)
+   {
+      struct timespec ts = { (time_t)(ahead / 1000000000LL), (long)(ahead % 1000000000LL) };
+      nanosleep(&ts, NULL);
+   }
+}
+
+/** Advance simulated time to the next peripheral event and run the
+ * interrupts that became pending. Only thread mode code advances time. */
+void hal_poll(void)
+{
+   if (hal_isr_depth > 0) return;
+
+   uint64_t next = hal_now + maxStep;
+   uint64_t event = hal_timer_next_event();
+
+   if (event < next) next = event;
+   event = hal_usart_next_event();
+   if (event < next) next = event;
+   if (endTime < next) next = endTime > hal_now ? endTime : hal_now;
+
+   uint32_t dt = (uint32_t)(next - hal_now);
+
+   if (dt > 0)
+   {
+      hostsim_model_step(hal_now, dt);
+      hal_timer_advance(dt);
+      hal_adc_advance(dt);
+      hal_now += dt;
+   }
+
+   hal_usart_advance();
+   hal_gpio_sync();
+   hal_timer_check_break();
+   hal_dispatch();
+
+   if (endOnEof && hal_usart_at_eof())
+   {
+      endTime = hal_now + EOF_GRACE_TIME;
+      endOnEof = false;
+   }
+
+   if (hal_now >= endTime || interrupted)
+      hostsim_exit(0);
+
+   if (realtime)
+      pace_realtime();
+}
+
+uint64_t hostsim_cycles(void)
+{
+   return hal_now;
+}
+
+double hostsim_time(void)
+{
+   return (double)hal_now / HOSTSIM_CLOCK;
+}
+
+void hostsim_set_max_step(uint32_t cycles)
+{
+   if (cycles > 0 && cycles < maxStep)
+      maxStep = cycles;
+}
+
+void hostsim_exit(int status)
+{
+   hal_usart_finish();
+   hostsim_model_exit();
+   fflush(stderr);
+   exit(status);
+}
+
+/* NVIC */
+void nvic_enable_irq(uint8_t irqn)
+{
+   NVIC_ISER(irqn / 32) |= 1U << (irqn % 32);
+}
+
+void nvic_disable_irq(uint8_t irqn)
+{
+   NVIC_ISER(irqn / 32) &= ~(1U << (irqn % 32));
+}
+
+uint8_t nvic_get_pending_irq(uint8_t irqn)
+{
+   return irq_pending(irqn) ? 1 : 0;
+}
+
+void nvic_set_pending_irq(uint8_t irqn)
+{
+   NVIC_ISPR(irqn / 32) |= 1U << (irqn % 32);
+}
+
+void nvic_clear_pending_irq(uint8_t irqn)
+{
+   NVIC_ISPR(irqn / 32) &= ~(1U << (irqn % 32));
+}
+
+uint8_t nvic_get_irq_enabled(uint8_t irqn)
+{
+   return (NVIC_ISER(irqn / 32) >> (irqn % 32)) & 1;
+}
+
+void nvic_set_priority(uint8_t irqn, uint8_t priority)
+{
+   NVIC_IPR(irqn) = priority;
+}
+
+/* SCB */
+void scb_reset_system(void)
+{
+   fprintf(stderr, "hostsim: system reset requested at %.3fs\n", hostsim_time());
+   hostsim_exit(0);
+}
+
+/* PRIMASK */
+void cm_enable_interrupts(void)
+{
+   primask = false;
+}
+
+void cm_disable_interrupts(void)
+{
+   primask = true;
+}
+
+bool cm_is_masked_interrupts(void)
+{
+   return primask;
+}
+
+uint32_t cm_mask_interrupts(uint32_t mask)
+{
+   uint32_t old = primask;
+   primask = mask != 0;
+   return old;
+}
+
+/* DWT. On the host the cycle counter is the time stamp counter of the host
+ * CPU (nanoseconds where there is none), so code can be profiled with the
+ * same calls. The figures compare code paths but are not target cycles. */
+bool dwt_enable_cycle_counter(void)
+{
+   DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+   return true;
+}
+
+uint32_t dwt_read_cycle_counter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return (uint32_t)__rdtsc();
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
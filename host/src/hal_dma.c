@@ -0,0 +1,285 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/usart.h>
+#include <libopencm3/cm3/nvic.h>
+#include "hal_internal.h"
+
+#define NUM_CHANNELS   7
+
+/** Internal channel state that is not visible in the registers */
+struct channel_state
+{
+   uint16_t reload;    //number of data at enable time, used in circular mode
+   uint16_t index;     //items transferred since the last reload
+};
+
+static struct channel_state channels[NUM_CHANNELS + 1];
+
+static int item_size(uint32_t ccr, bool memory)
+{
+   uint32_t size = memory ? (ccr & DMA_CCR_MSIZE_MASK) >> 10 : (ccr & DMA_CCR_PSIZE_MASK) >> 8;
+   return 1 << size;
+}
+
+static bool is_usart_dr(uint32_t addr)
+{
+   return addr == (uint32_t)(uintptr_t)&USART_DR(USART1) ||
+          addr == (uint32_t)(uintptr_t)&USART_DR(USART2) ||
+          addr == (uint32_t)(uintptr_t)&USART_DR(USART3);
+}
+
+uint32_t hal_bus_read(uint32_t addr, int size)
+{
+   if (is_usart_dr(addr))
+      return hal_usart_read_dr(addr - 0x04);
+
+   switch (size)
+   {
+   case 1: return MMIO8(addr);
+   case 2: return MMIO16(addr);
+   default: return MMIO32(addr);
+   }
+}
+
+void hal_bus_write(uint32_t addr, uint32_t value, int size)
+{
+   if (is_usart_dr(addr))
+   {
+      hal_usart_write_dr(addr - 0x04, value);
+      return;
+   }
+
+   switch (size)
+   {
+   case 1: MMIO8(addr) = value; break;
+   case 2: MMIO16(addr) = value; break;
+   default: MMIO32(addr) = value; break;
+   }
+}
+
+static void set_flags(uint8_t channel, uint32_t flags)
+{
+   DMA_ISR(DMA1) |= (flags | DMA_GIF) << DMA_FLAG_OFFSET(channel);
+}
+
+/** Move one item as requested by a peripheral */
+void hal_dma_request(uint8_t channel)
+{
+   if (channel < 1 || channel > NUM_CHANNELS) return;
+
+   struct channel_state *cs = &channels[channel];
+   uint32_t ccr = DMA_CCR(DMA1, channel);
+   uint32_t count = DMA_CNDTR(DMA1, channel) & 0xFFFF;
+
+   if (!(ccr & DMA_CCR_EN) || count == 0) return;
+
+   int psize = item_size(ccr, false);
+   int msize = item_size(ccr, true);
+   uint32_t paddr = DMA_CPAR(DMA1, channel) + ((ccr & DMA_CCR_PINC) ? cs->index * psize : 0);
+   uint32_t maddr = DMA_CMAR(DMA1, channel) + ((ccr & DMA_CCR_MINC) ? cs->index * msize : 0);
+
+   if (ccr & DMA_CCR_DIR)
+      hal_bus_write(paddr, hal_bus_read(maddr, msize), psize);
+   else
+      hal_bus_write(maddr, hal_bus_read(paddr, psize), msize);
+
+   count--;
+   cs->index++;
+
+   if (count == cs->reload / 2)
+      set_flags(channel, DMA_HTIF);
+
+   if (count == 0)
+   {
+      set_flags(channel, DMA_TCIF);
+
+      if (ccr & DMA_CCR_CIRC)
+      {
+         count = cs->reload;
+         cs->index = 0;
+      }
+   }
+
+   DMA_CNDTR(DMA1, channel) = count;
+}
+
+bool hal_dma_irq_pending(int irqn)
+{
+   if (irqn < NVIC_DMA1_CHANNEL1_IRQ || irqn > NVIC_DMA1_CHANNEL7_IRQ) return false;
+
+   uint8_t channel = irqn - NVIC_DMA1_CHANNEL1_IRQ + 1;
+   uint32_t flags = (DMA_ISR(DMA1) >> DMA_FLAG_OFFSET(channel)) & DMA_IFLAGS;
+   uint32_t enabled = DMA_CCR(DMA1, channel) & (DMA_CCR_TCIE | DMA_CCR_HTIE | DMA_CCR_TEIE);
+
+   //TCIE, HTIE and TEIE line up with TCIF, HTIF and TEIF
+   return (flags & enabled) != 0;
+}
+
+/* libopencm3 API */
+void dma_channel_reset(uint32_t dma, uint8_t channel)
+{
+   DMA_CCR(dma, channel) = 0;
+   DMA_CNDTR(dma, channel) = 0;
+   DMA_CPAR(dma, channel) = 0;
+   DMA_CMAR(dma, channel) = 0;
+   DMA_ISR(dma) &= ~(DMA_IFLAGS << DMA_FLAG_OFFSET(channel));
+}
+
+void dma_clear_interrupt_flags(uint32_t dma, uint8_t channel, uint32_t interrupts)
+{
+   //IFCR is write-only, clearing is applied to ISR directly
+   DMA_ISR(dma) &= ~(interrupts << DMA_FLAG_OFFSET(channel));
+}
+
+bool dma_get_interrupt_flag(uint32_t dma, uint8_t channel, uint32_t interrupts)
+{
+   hal_poll();
+   return ((DMA_ISR(dma) >> DMA_FLAG_OFFSET(channel)) & interrupts) != 0;
+}
+
+static void ccr_modify(uint32_t dma, uint8_t channel, uint32_t mask, uint32_t value)
+{
+   DMA_CCR(dma, channel) = (DMA_CCR(dma, channel) & ~mask) | value;
+}
+
+void dma_enable_mem2mem_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_MEM2MEM | DMA_CCR_CIRC, DMA_CCR_MEM2MEM);
+}
+
+void dma_set_priority(uint32_t dma, uint8_t channel, uint32_t prio)
+{
+   ccr_modify(dma, channel, DMA_CCR_PL_MASK, prio);
+}
+
+void dma_set_memory_size(uint32_t dma, uint8_t channel, uint32_t mem_size)
+{
+   ccr_modify(dma, channel, DMA_CCR_MSIZE_MASK, mem_size);
+}
+
+void dma_set_peripheral_size(uint32_t dma, uint8_t channel, uint32_t peripheral_size)
+{
+   ccr_modify(dma, channel, DMA_CCR_PSIZE_MASK, peripheral_size);
+}
+
+void dma_enable_memory_increment_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_MINC);
+}
+
+void dma_disable_memory_increment_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_MINC, 0);
+}
+
+void dma_enable_peripheral_increment_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_PINC);
+}
+
+void dma_disable_peripheral_increment_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_PINC, 0);
+}
+
+void dma_enable_circular_mode(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_MEM2MEM, DMA_CCR_CIRC);
+}
+
+void dma_set_read_from_peripheral(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_DIR, 0);
+}
+
+void dma_set_read_from_memory(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_DIR);
+}
+
+void dma_enable_transfer_error_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_TEIE);
+}
+
+void dma_disable_transfer_error_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_TEIE, 0);
+}
+
+void dma_enable_half_transfer_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_HTIE);
+}
+
+void dma_disable_half_transfer_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_HTIE, 0);
+}
+
+void dma_enable_transfer_complete_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, 0, DMA_CCR_TCIE);
+}
+
+void dma_disable_transfer_complete_interrupt(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_TCIE, 0);
+}
+
+void dma_enable_channel(uint32_t dma, uint8_t channel)
+{
+   channels[channel].reload = DMA_CNDTR(dma, channel) & 0xFFFF;
+   channels[channel].index = 0;
+   ccr_modify(dma, channel, 0, DMA_CCR_EN);
+
+   //Memory to USART transfers are drained right away
+   if ((DMA_CCR(dma, channel) & DMA_CCR_DIR) && is_usart_dr(DMA_CPAR(dma, channel)))
+      hal_usart_kick_tx_dma(channel);
+}
+
+void dma_disable_channel(uint32_t dma, uint8_t channel)
+{
+   ccr_modify(dma, channel, DMA_CCR_EN, 0);
+}
+
+void dma_set_peripheral_address(uint32_t dma, uint8_t channel, uint32_t address)
+{
+   if (!(DMA_CCR(dma, channel) & DMA_CCR_EN))
+      DMA_CPAR(dma, channel) = address;
+}
+
+void dma_set_memory_address(uint32_t dma, uint8_t channel, uint32_t address)
+{
+   if (!(DMA_CCR(dma, channel) & DMA_CCR_EN))
+      DMA_CMAR(dma, channel) = address;
+}
+
+uint16_t dma_get_number_of_data(uint32_t dma, uint8_t channel)
+{
+   hal_poll();
+   return DMA_CNDTR(dma, channel);
+}
+
+void dma_set_number_of_data(uint32_t dma, uint8_t channel, uint16_t number)
+{
+   DMA_CNDTR(dma, channel) = number;
+}
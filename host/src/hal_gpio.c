@@ -0,0 +1,370 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/cm3/nvic.h>
+#include "hal_internal.h"
+
+#define NUM_PORTS    5
+
+/** Externally visible state of the pins of one port */
+struct port_state
+{
+   uint16_t driven;     //pins driven by external circuitry
+   uint16_t level;      //level of the driven pins
+   uint16_t removed;    //pins that do not exist on the board
+};
+
+/** Pin strapping that lets detect_hw() find a specific board */
+struct board
+{
+   const char *name;
+   uint16_t removedC;   //GPIOC pins that do not exist
+   uint16_t floatingC;  //GPIOC pins left floating
+   uint16_t floatingB;  //GPIOB pins left floating
+   uint16_t floatingA;  //GPIOA pins left floating
+   bool prechargeTied;  //B1 tied to Vcc
+   bool breakActiveLow; //Level of B12 that means "no fault" is high
+};
+
+static const struct board boards[] =
+{
+   { "bluepill", GPIO12, 0, 0, 0, false, true },
+   { "teslam3", 0, 0, 0, 0, true, true },
+   { "rev1", 0, GPIO9, 0, 0, false, false },
+   { "prius", 0, 0, GPIO5, 0, false, true },
+   { "rev3", 0, 0, 0, GPIO0, false, false },
+   { "tesla", 0, GPIO8, 0, 0, false, false },
+   { "rev2", 0, 0, 0, 0, false, false },
+};
+
+static struct port_state ports[NUM_PORTS];
+static const struct board *activeBoard = &boards[sizeof(boards) / sizeof(boards[0]) - 1];
+
+static int port_index(uint32_t gpioport)
+{
+   return (gpioport - GPIOA) / (GPIOB - GPIOA);
+}
+
+static uint32_t pin_config(uint32_t gpioport, int pin)
+{
+   uint32_t reg = pin < 8 ? GPIO_CRL(gpioport) : GPIO_CRH(gpioport);
+   return (reg >> ((pin & 7) * 4)) & 0xF;
+}
+
+/** Compute the input data register from output latch, pin mode and board */
+static uint16_t compute_idr(uint32_t gpioport)
+{
+   struct port_state *ps = &ports[port_index(gpioport)];
+   uint16_t odr = GPIO_ODR(gpioport);
+   uint16_t idr = 0;
+
+   for (int pin = 0; pin < 16; pin++)
+   {
+      uint16_t mask = 1 << pin;
+      uint32_t cfg = pin_config(gpioport, pin);
+      uint32_t mode = cfg & 0x3;
+      uint32_t cnf = cfg >> 2;
+
+      if (ps->removed & mask)
+         continue;
+      else if (ps->driven & mask)
+         idr |= ps->level & mask;
+      else if (mode != GPIO_MODE_INPUT)
+         idr |= odr & mask;
+      else if (cnf == GPIO_CNF_INPUT_PULL_UPDOWN)
+         idr |= odr & mask;
+      //Floating and analog inputs read 0
+   }
+   return idr;
+}
+
+/** Recompute IDR and generate EXTI events for changed pins */
+static void update_port(uint32_t gpioport)
+{
+   uint16_t old = GPIO_IDR(gpioport);
+   uint16_t idr = compute_idr(gpioport);
+
+   GPIO_IDR(gpioport) = idr;
+
+   if (old & ~idr)
+      hal_exti_event(gpioport, old & ~idr, false);
+   if (~old & idr)
+      hal_exti_event(gpioport, ~old & idr, true);
+}
+
+/** Apply writes to the bit set/reset registers done without the API */
+void hal_gpio_sync(void)
+{
+   for (int i = 0; i < NUM_PORTS; i++)
+   {
+      uint32_t gpioport = GPIOA + i * (GPIOB - GPIOA);
+      uint32_t bsrr = GPIO_BSRR(gpioport);
+      uint32_t brr = GPIO_BRR(gpioport);
+
+      if (bsrr | brr)
+      {
+         GPIO_ODR(gpioport) = (GPIO_ODR(gpioport) & ~((bsrr >> 16) | brr)) | (bsrr & 0xFFFF);
+         GPIO_BSRR(gpioport) = 0;
+         GPIO_BRR(gpioport) = 0;
+      }
+      update_port(gpioport);
+   }
+}
+
+void hal_gpio_init(void)
+{
+   const char *name = getenv("HOSTSIM_HWREV");
+   const struct board *board = activeBoard;
+
+   if (name != NULL)
+   {
+      size_t i;
+
+      for (i = 0; i < sizeof(boards) / sizeof(boards[0]); i++)
+      {
+         if (strcmp(boards[i].name, name) == 0)
+            break;
+      }
+
+      if (i < sizeof(boards) / sizeof(boards[0]))
+      {
+         board = &boards[i];
+         activeBoard = board;
+      }
+      else
+      {
+         fprintf(stderr, "hostsim: unknown HOSTSIM_HWREV %s, using %s\n", name, board->name);
+      }
+   }
+
+   for (int i = 0; i < NUM_PORTS; i++)
+   {
+      uint32_t gpioport = GPIOA + i * (GPIOB - GPIOA);
+      GPIO_CRL(gpioport) = 0x44444444;
+      GPIO_CRH(gpioport) = 0x44444444;
+   }
+
+   //Inputs that are inactive when high: desat, emergency stop, motor protection
+   hostsim_drive_pins(GPIOC, (GPIO9 | GPIO7) & ~board->floatingC, true);
+   hostsim_drive_pins(GPIOA, GPIO3, true);
+   //Pins that are driven on boards that have them
+   hostsim_drive_pins(GPIOA, GPIO0 & ~board->floatingA, true);
+   hostsim_drive_pins(GPIOB, GPIO5 & ~board->floatingB, false);
+   hostsim_drive_pins(GPIOC, GPIO8 & ~board->floatingC, false);
+   hostsim_drive_pins(GPIOB, GPIO12, board->breakActiveLow);
+   hostsim_remove_pins(GPIOC, board->removedC);
+
+   if (board->prechargeTied)
+      hostsim_drive_pins(GPIOB, GPIO1, true);
+}
+
+/* Model interface */
+const char *hostsim_board(void)
+{
+   return activeBoard->name;
+}
+
+void hostsim_drive_pins(uint32_t port, uint16_t pins, bool level)
+{
+   struct port_state *ps = &ports[port_index(port)];
+
+   ps->driven |= pins;
+   if (level)
+      ps->level |= pins;
+   else
+      ps->level &= ~pins;
+   update_port(port);
+}
+
+void hostsim_release_pins(uint32_t port, uint16_t pins)
+{
+   ports[port_index(port)].driven &= ~pins;
+   update_port(port);
+}
+
+void hostsim_remove_pins(uint32_t port, uint16_t pins)
+{
+   ports[port_index(port)].removed |= pins;
+   update_port(port);
+}
+
+bool hostsim_get_pin(uint32_t port, uint16_t pin)
+{
+   return (compute_idr(port) & pin) != 0;
+}
+
+/* libopencm3 GPIO API */
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios)
+{
+   uint32_t crl = GPIO_CRL(gpioport);
+   uint32_t crh = GPIO_CRH(gpioport);
+
+   for (int pin = 0; pin < 16; pin++)
+   {
+      if (!(gpios & (1 << pin))) continue;
+
+      uint32_t shift = (pin & 7) * 4;
+      uint32_t value = ((uint32_t)(cnf << 2) | mode) << shift;
+
+      if (pin < 8)
+         crl = (crl & ~(0xFU << shift)) | value;
+      else
+         crh = (crh & ~(0xFU << shift)) | value;
+   }
+
+   GPIO_CRL(gpioport) = crl;
+   GPIO_CRH(gpioport) = crh;
+   update_port(gpioport);
+}
+
+void gpio_set(uint32_t gpioport, uint16_t gpios)
+{
+   GPIO_ODR(gpioport) |= gpios;
+   update_port(gpioport);
+}
+
+void gpio_clear(uint32_t gpioport, uint16_t gpios)
+{
+   GPIO_ODR(gpioport) &= ~gpios;
+   update_port(gpioport);
+}
+
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios)
+{
+   update_port(gpioport);
+   return GPIO_IDR(gpioport) & gpios;
+}
+
+void gpio_toggle(uint32_t gpioport, uint16_t gpios)
+{
+   GPIO_ODR(gpioport) ^= gpios;
+   update_port(gpioport);
+}
+
+uint16_t gpio_port_read(uint32_t gpioport)
+{
+   update_port(gpioport);
+   return GPIO_IDR(gpioport);
+}
+
+void gpio_port_write(uint32_t gpioport, uint16_t data)
+{
+   GPIO_ODR(gpioport) = data;
+   update_port(gpioport);
+}
+
+void gpio_primary_remap(uint32_t swjenable, uint32_t maps)
+{
+   AFIO_MAPR = (AFIO_MAPR & ~AFIO_MAPR_SWJ_MASK) | swjenable | maps;
+}
+
+/* EXTI */
+static uint32_t exti_port(int line)
+{
+   volatile uint32_t *exticr = &AFIO_EXTICR1 + line / 4;
+   return GPIOA + ((*exticr >> ((line % 4) * 4)) & 0xF) * (GPIOB - GPIOA);
+}
+
+void hal_exti_event(uint32_t port, uint16_t pins, bool rising)
+{
+   uint32_t trigger = rising ? EXTI_RTSR : EXTI_FTSR;
+
+   for (int line = 0; line < 16; line++)
+   {
+      uint32_t mask = 1 << line;
+
+      if ((pins & mask) && (trigger & mask) && exti_port(line) == port)
+         EXTI_PR |= mask;
+   }
+}
+
+bool hal_exti_irq_pending(int irqn)
+{
+   uint32_t pending = EXTI_PR & EXTI_IMR;
+
+   switch (irqn)
+   {
+   case NVIC_EXTI0_IRQ: return pending & EXTI0;
+   case NVIC_EXTI1_IRQ: return pending & EXTI1;
+   case NVIC_EXTI2_IRQ: return pending & EXTI2;
+   case NVIC_EXTI3_IRQ: return pending & EXTI3;
+   case NVIC_EXTI4_IRQ: return pending & EXTI4;
+   case NVIC_EXTI9_5_IRQ: return pending & 0x03E0;
+   case NVIC_EXTI15_10_IRQ: return pending & 0xFC00;
+   default: return false;
+   }
+}
+
+void exti_set_trigger(uint32_t extis, enum exti_trigger_type trig)
+{
+   switch (trig)
+   {
+   case EXTI_TRIGGER_RISING:
+      EXTI_RTSR |= extis;
+      EXTI_FTSR &= ~extis;
+      break;
+   case EXTI_TRIGGER_FALLING:
+      EXTI_RTSR &= ~extis;
+      EXTI_FTSR |= extis;
+      break;
+   case EXTI_TRIGGER_BOTH:
+      EXTI_RTSR |= extis;
+      EXTI_FTSR |= extis;
+      break;
+   }
+}
+
+void exti_enable_request(uint32_t extis)
+{
+   EXTI_IMR |= extis;
+}
+
+void exti_disable_request(uint32_t extis)
+{
+   EXTI_IMR &= ~extis;
+}
+
+void exti_reset_request(uint32_t extis)
+{
+   //Write 1 to clear on the real hardware
+   EXTI_PR &= ~extis;
+}
+
+uint32_t exti_get_flag_status(uint32_t exti)
+{
+   return EXTI_PR & exti;
+}
+
+void exti_select_source(uint32_t exti, uint32_t gpioport)
+{
+   uint32_t index = port_index(gpioport);
+
+   for (int line = 0; line < 16; line++)
+   {
+      if (!(exti & (1 << line))) continue;
+
+      volatile uint32_t *exticr = &AFIO_EXTICR1 + line / 4;
+      uint32_t shift = (line % 4) * 4;
+      *exticr = (*exticr & ~(0xFU << shift)) | (index << shift);
+   }
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HAL_INTERNAL_H_INCLUDED
+#define HAL_INTERNAL_H_INCLUDED
+
+#include "hostsim.h"
+
+/* Shared state of the simulated peripherals, not for use by models */
+
+#define HAL_NEVER           UINT64_MAX
+#define MIN_U32(a, b)       ((a) < (b) ? (a) : (b))
+
+extern uint64_t hal_now;
+extern int hal_isr_depth;
+
+/* Called by polling functions. Advances simulated time to the next event
+ * when called from thread mode, does nothing inside an interrupt handler. */
+void hal_poll(void);
+void hal_dispatch(void);
+
+void hal_gpio_init(void);
+void hal_gpio_sync(void);
+void hal_timer_init(void);
+void hal_timer_reset(uint32_t timer);
+uint64_t hal_timer_next_event(void);
+void hal_timer_advance(uint32_t cycles);
+bool hal_timer_irq_pending(int irqn);
+
+void hal_adc_advance(uint32_t cycles);
+void hal_adc_trigger_injected(uint32_t jextsel);
+bool hal_adc_injected_trigger(uint32_t adc, uint32_t *jextsel);
+void hal_adc_trigger_regular(uint32_t extsel);
+bool hal_adc_irq_pending(int irqn);
+
+void hal_dma_request(uint8_t channel);
+bool hal_dma_irq_pending(int irqn);
+uint32_t hal_bus_read(uint32_t addr, int size);
+void hal_bus_write(uint32_t addr, uint32_t value, int size);
+
+void hal_usart_init(void);
+uint64_t hal_usart_next_event(void);
+void hal_usart_advance(void);
+void hal_usart_flush(void);
+void hal_usart_finish(void);
+bool hal_usart_at_eof(void);
+uint32_t hal_usart_read_dr(uint32_t usart);
+void hal_usart_write_dr(uint32_t usart, uint32_t value);
+void hal_usart_kick_tx_dma(uint8_t channel);
+
+bool hal_exti_irq_pending(int irqn);
+void hal_exti_event(uint32_t port, uint16_t pins, bool rising);
+void hal_timer_check_break(void);
+
+bool hal_can_irq_pending(int irqn);
+
+void hal_flash_init(void);
+
+#endif // HAL_INTERNAL_H_INCLUDED
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/rtc.h>
+#include <libopencm3/stm32/iwdg.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/crc.h>
+#include <libopencm3/stm32/timer.h>
+#include "hal_internal.h"
+
+#define FLASH_PAGE     1024
+#define RTC_CLOCK      62500  //HSE/128
+
+/* RCC */
+uint32_t rcc_ahb_frequency = 8000000;
+uint32_t rcc_apb1_frequency = 8000000;
+uint32_t rcc_apb2_frequency = 8000000;
+
+void rcc_clock_setup_in_hse_8mhz_out_72mhz(void)
+{
+   rcc_ahb_frequency = HOSTSIM_CLOCK;
+   rcc_apb1_frequency = HOSTSIM_CLOCK / 2;
+   rcc_apb2_frequency = HOSTSIM_CLOCK;
+}
+
+void rcc_set_adcpre(uint32_t adcpre)
+{
+   RCC_CFGR = (RCC_CFGR & ~RCC_CFGR_ADCPRE) | (adcpre << RCC_CFGR_ADCPRE_SHIFT);
+}
+
+void rcc_periph_clock_enable(enum rcc_periph_clken clken)
+{
+   MMIO32(RCC_BASE + (clken >> 5)) |= 1U << (clken & 0x1F);
+}
+
+void rcc_periph_clock_disable(enum rcc_periph_clken clken)
+{
+   MMIO32(RCC_BASE + (clken >> 5)) &= ~(1U << (clken & 0x1F));
+}
+
+void rcc_periph_reset_pulse(enum rcc_periph_rst rst)
+{
+   switch (rst)
+   {
+   case RST_TIM1: hal_timer_reset(TIM1); break;
+   case RST_TIM2: hal_timer_reset(TIM2); break;
+   case RST_TIM3: hal_timer_reset(TIM3); break;
+   case RST_TIM4: hal_timer_reset(TIM4); break;
+   default: break; //Not needed by the firmware
+   }
+}
+
+/* RTC, counts from simulated time */
+static uint64_t rtcCyclesPerTick = HOSTSIM_CLOCK / 100;
+static uint64_t rtcStart = 0;
+static uint32_t rtcStartValue = 0;
+
+void rtc_auto_awake(enum rcc_osc clock_source, uint32_t prescale_val)
+{
+   (void)clock_source;
+   rtc_set_prescale_val(prescale_val);
+}
+
+void rtc_set_prescale_val(uint32_t prescale_val)
+{
+   rtcStartValue = rtc_get_counter_val();
+   rtcStart = hal_now;
+   rtcCyclesPerTick = (uint64_t)HOSTSIM_CLOCK * (prescale_val + 1) / RTC_CLOCK;
+}
+
+uint32_t rtc_get_counter_val(void)
+{
+   return rtcStartValue + (uint32_t)((hal_now - rtcStart) / rtcCyclesPerTick);
+}
+
+void rtc_set_counter_val(uint32_t counter_val)
+{
+   rtcStartValue = counter_val;
+   rtcStart = hal_now;
+}
+
+/* IWDG, never bites */
+void iwdg_start(void) {}
+void iwdg_set_period_ms(uint32_t period) { (void)period; }
+void iwdg_reset(void) {}
+
+/* Flash, optionally backed by the file given in HOSTSIM_FLASH */
+void hal_flash_init(void)
+{
+   const char *file = getenv("HOSTSIM_FLASH");
+   void *addr;
+
+   if (file != NULL)
+   {
+      int fd = open(file, O_RDWR | O_CREAT, 0644);
+      struct stat st;
+
+      if (fd < 0 || fstat(fd, &st) < 0)
+      {
+         fprintf(stderr, "hostsim: cannot open flash image %s\n", file);
+         exit(1);
+      }
+
+      //A new image starts out erased
+      if (st.st_size < (off_t)FLASH_SIZE)
+      {
+         uint8_t erased[FLASH_PAGE];
+
+         memset(erased, 0xFF, sizeof(erased));
+         lseek(fd, st.st_size, SEEK_SET);
+         for (off_t ofs = st.st_size; ofs < (off_t)FLASH_SIZE; ofs += FLASH_PAGE)
+         {
+            size_t len = FLASH_SIZE - ofs < FLASH_PAGE ? FLASH_SIZE - ofs : FLASH_PAGE;
+            if (write(fd, erased, len) != (ssize_t)len) break;
+         }
+      }
+
+      addr = mmap((void*)(uintptr_t)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+      close(fd);
+   }
+   else
+   {
+      addr = mmap((void*)(uintptr_t)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+      if (addr == (void*)(uintptr_t)FLASH_BASE)
+         memset(addr, 0xFF, FLASH_SIZE);
+   }
+
+   if (addr != (void*)(uintptr_t)FLASH_BASE)
+   {
+      fprintf(stderr, "hostsim: cannot map flash at 0x%08x\n", FLASH_BASE);
+      exit(1);
+   }
+
+   FLASH_CR = FLASH_CR_LOCK;
+}
+
+static bool in_flash(uint32_t address, uint32_t size)
+{
+   return address >= FLASH_BASE && address + size <= FLASH_BASE + FLASH_SIZE;
+}
+
+void flash_set_ws(uint32_t ws)
+{
+   FLASH_ACR = (FLASH_ACR & ~0x7) | ws;
+}
+
+void flash_unlock(void)
+{
+   FLASH_CR &= ~FLASH_CR_LOCK;
+}
+
+void flash_lock(void)
+{
+   FLASH_CR |= FLASH_CR_LOCK;
+}
+
+void flash_erase_page(uint32_t page_address)
+{
+   page_address &= ~(FLASH_PAGE - 1);
+
+   if (!(FLASH_CR & FLASH_CR_LOCK) && in_flash(page_address, FLASH_PAGE))
+      memset((void*)(uintptr_t)page_address, 0xFF, FLASH_PAGE);
+}
+
+void flash_program_half_word(uint32_t address, uint16_t data)
+{
+   if (FLASH_CR & FLASH_CR_LOCK || !in_flash(address, 2)) return;
+
+   //Programming can only clear bits
+   MMIO16(address) &= data;
+}
+
+void flash_program_word(uint32_t address, uint32_t data)
+{
+   flash_program_half_word(address, (uint16_t)data);
+   flash_program_half_word(address + 2, (uint16_t)(data >> 16));
+}
+
+/* CRC unit: CRC-32 polynomial, MSB first, processes whole words */
+void crc_reset(void)
+{
+   CRC_DR = 0xFFFFFFFF;
+}
+
+uint32_t crc_calculate(uint32_t data)
+{
+   uint32_t crc = CRC_DR ^ data;
+
+   for (int i = 0; i < 32; i++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+
+   CRC_DR = crc;
+   return crc;
+}
+
+uint32_t crc_calculate_block(uint32_t *datap, int size)
+{
+   for (int i = 0; i < size; i++)
+      crc_calculate(datap[i]);
+
+   return CRC_DR;
+}
@@ -0,0 +1,923 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/stm32/adc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/cm3/nvic.h>
+#include "hal_internal.h"
+
+#define NUM_TIMERS         4
+#define NUM_CHANNELS       4
+#define TIMER_REG_SIZE     0x50
+#define DMA_UP             4
+#define TRGO_NONE          0xFF
+
+/** Simulated state that is not visible in the register file */
+struct timer_state
+{
+   uint32_t base;
+   uint32_t psc;                  //active prescaler
+   uint32_t pscCount;             //cycles counted towards the next tick
+   uint32_t arr;                  //active (shadow) auto reload value
+   uint32_t ccr[NUM_CHANNELS];    //active (shadow) compare values
+   uint32_t rep;                  //repetition down counter
+   uint8_t dmaChannel[NUM_CHANNELS + 1]; //DMA1 channel of CC1..CC4 and UP request
+   uint8_t trgoInjected;          //JEXTSEL value that TRGO triggers
+   uint8_t ccInjected[NUM_CHANNELS]; //JEXTSEL value triggered by CCx
+   uint8_t ccRegular[NUM_CHANNELS];  //EXTSEL value triggered by CCx
+};
+
+static struct timer_state timers[NUM_TIMERS] =
+{
+   { TIM1, 0, 0, 0, { 0 }, 0, { 2, 3, 6, 4, 5 }, 0, { TRGO_NONE, TRGO_NONE, TRGO_NONE, 1 }, { 0, 1, 2, TRGO_NONE } },
+   { TIM2, 0, 0, 0, { 0 }, 0, { 5, 7, 1, 7, 2 }, 2, { 3, TRGO_NONE, TRGO_NONE, TRGO_NONE }, { TRGO_NONE, 3, TRGO_NONE, TRGO_NONE } },
+   { TIM3, 0, 0, 0, { 0 }, 0, { 6, 0, 2, 3, 3 }, TRGO_NONE, { TRGO_NONE, TRGO_NONE, TRGO_NONE, 4 }, { TRGO_NONE, TRGO_NONE, TRGO_NONE, TRGO_NONE } },
+   { TIM4, 0, 0, 0, { 0 }, 0, { 1, 4, 5, 0, 7 }, 5, { TRGO_NONE, TRGO_NONE, TRGO_NONE, TRGO_NONE }, { TRGO_NONE, TRGO_NONE, TRGO_NONE, 5 } },
+};
+
+static struct timer_state* get_timer(uint32_t base)
+{
+   for (int i = 0; i < NUM_TIMERS; i++)
+   {
+      if (timers[i].base == base)
+         return &timers[i];
+   }
+   return 0;
+}
+
+static int oc_channel(enum tim_oc_id oc)
+{
+   return oc == TIM_OC4 ? 3 : oc / 2;
+}
+
+static volatile uint32_t* ccr_reg(uint32_t base, int ch)
+{
+   return &TIM_CCR1(base) + ch;
+}
+
+/** The 8 bit CCMR field belonging to a channel */
+static uint32_t ccmr_get(uint32_t base, int ch)
+{
+   uint32_t reg = ch < 2 ? TIM_CCMR1(base) : TIM_CCMR2(base);
+   return (reg >> ((ch & 1) * 8)) & 0xFF;
+}
+
+static void ccmr_modify(uint32_t base, int ch, uint32_t mask, uint32_t value)
+{
+   volatile uint32_t *reg = ch < 2 ? &TIM_CCMR1(base) : &TIM_CCMR2(base);
+   int shift = (ch & 1) * 8;
+   *reg = (*reg & ~(mask << shift)) | ((value & mask) << shift);
+}
+
+static bool is_input(uint32_t base, int ch)
+{
+   return (ccmr_get(base, ch) & 0x3) != 0;
+}
+
+static bool is_center(uint32_t base)
+{
+   return (TIM_CR1(base) & TIM_CR1_CMS_MASK) != 0;
+}
+
+static bool is_external_clock(uint32_t base)
+{
+   uint32_t sms = TIM_SMCR(base) & TIM_SMCR_SMS_MASK;
+   return (sms >= TIM_SMCR_SMS_EM1 && sms <= TIM_SMCR_SMS_EM3) || sms == TIM_SMCR_SMS_ECM1;
+}
+
+static uint32_t active_arr(struct timer_state *s)
+{
+   return (TIM_CR1(s->base) & TIM_CR1_ARPE) ? s->arr : TIM_ARR(s->base) & 0xFFFF;
+}
+
+static uint32_t active_ccr(struct timer_state *s, int ch)
+{
+   if (ccmr_get(s->base, ch) & TIM_CCMR1_OC1PE)
+      return s->ccr[ch];
+   return *ccr_reg(s->base, ch) & 0xFFFF;
+}
+
+/** Ticks of one full counting cycle */
+static uint32_t period(struct timer_state *s)
+{
+   uint32_t arr = active_arr(s);
+
+   if (arr == 0) return 0; //Counter is blocked
+   return is_center(s->base) ? 2 * arr : arr + 1;
+}
+
+/** Position of the counter within its counting cycle.
+ * Center aligned: 0..arr-1 counting up, arr..2*arr-1 counting down
+ * Edge aligned: number of ticks since the last update event */
+static uint32_t get_phase(struct timer_state *s)
+{
+   uint32_t arr = active_arr(s);
+   uint32_t cnt = TIM_CNT(s->base) & 0xFFFF;
+   bool down = (TIM_CR1(s->base) & TIM_CR1_DIR_DOWN) != 0;
+
+   //Counter was written beyond the period, approximate by restarting at the end
+   if (cnt > arr) cnt = arr;
+
+   if (is_center(s->base))
+      return down ? (2 * arr - cnt) % (2 * arr) : cnt;
+   return down ? arr - cnt : cnt;
+}
+
+static void set_phase(struct timer_state *s, uint32_t p)
+{
+   uint32_t arr = active_arr(s);
+   uint32_t base = s->base;
+
+   if (is_center(base))
+   {
+      if (p < arr)
+      {
+         TIM_CNT(base) = p;
+         TIM_CR1(base) &= ~TIM_CR1_DIR_DOWN;
+      }
+      else
+      {
+         TIM_CNT(base) = 2 * arr - p;
+         TIM_CR1(base) |= TIM_CR1_DIR_DOWN;
+      }
+   }
+   else if (TIM_CR1(base) & TIM_CR1_DIR_DOWN)
+   {
+      TIM_CNT(base) = arr - p;
+   }
+   else
+   {
+      TIM_CNT(base) = p;
+   }
+}
+
+/** Distance from phase p to phase q in 1..per ticks */
+static uint32_t distance(uint32_t p, uint32_t q, uint32_t per)
+{
+   return ((q + per - p - 1) % per) + 1;
+}
+
+static uint32_t ticks_to_event(struct timer_state *s)
+{
+   uint32_t per = period(s);
+   uint32_t arr = active_arr(s);
+   uint32_t p = get_phase(s);
+   bool center = is_center(s->base);
+   bool down = (TIM_CR1(s->base) & TIM_CR1_DIR_DOWN) != 0;
+   uint32_t best = distance(p, 0, per);
+
+   if (center)
+      best = MIN_U32(best, distance(p, arr, per));
+
+   for (int ch = 0; ch < NUM_CHANNELS; ch++)
+   {
+      uint32_t ccr = active_ccr(s, ch);
+
+      if (is_input(s->base, ch) || ccr > arr) continue;
+
+      if (center)
+      {
+         best = MIN_U32(best, distance(p, ccr, per));
+         best = MIN_U32(best, distance(p, (2 * arr - ccr) % per, per));
+      }
+      else
+      {
+         best = MIN_U32(best, distance(p, down ? arr - ccr : ccr, per));
+      }
+   }
+   return best;
+}
+
+static void trigger_adc(uint8_t injected, uint8_t regular)
+{
+   if (injected != TRGO_NONE)
+      hal_adc_trigger_injected(injected);
+   if (regular != TRGO_NONE)
+      hal_adc_trigger_regular(regular);
+}
+
+static void trgo(struct timer_state *s)
+{
+   trigger_adc(s->trgoInjected, s->base == TIM3 ? 4 : TRGO_NONE);
+}
+
+/** Load shadow registers and raise update flag */
+static void update_event(struct timer_state *s, bool fromCounter)
+{
+   uint32_t base = s->base;
+
+   s->psc = TIM_PSC(base) & 0xFFFF;
+   s->arr = TIM_ARR(base) & 0xFFFF;
+
+   for (int ch = 0; ch < NUM_CHANNELS; ch++)
+      s->ccr[ch] = *ccr_reg(base, ch) & 0xFFFF;
+
+   if (!fromCounter && (TIM_CR1(base) & TIM_CR1_URS))
+      return;
+
+   TIM_SR(base) |= TIM_SR_UIF;
+
+   if (TIM_DIER(base) & TIM_DIER_UDE)
+      hal_dma_request(s->dmaChannel[DMA_UP]);
+   if ((TIM_DIER(base) & 0x1E00) && (TIM_CR2(base) & TIM_CR2_CCDS))
+   {
+      for (int ch = 0; ch < NUM_CHANNELS; ch++)
+         if (TIM_DIER(base) & (TIM_DIER_CC1DE << ch))
+            hal_dma_request(s->dmaChannel[ch]);
+   }
+   if ((TIM_CR2(base) & TIM_CR2_MMS_MASK) == TIM_CR2_MMS_UPDATE)
+      trgo(s);
+
+   if (fromCounter && (TIM_CR1(base) & TIM_CR1_OPM))
+      TIM_CR1(base) &= ~TIM_CR1_CEN;
+}
+
+static void counter_wrap(struct timer_state *s)
+{
+   if (TIM_CR1(s->base) & TIM_CR1_UDIS) return;
+
+   if (s->rep > 0)
+   {
+      s->rep--;
+      return;
+   }
+
+   s->rep = s->base == TIM1 ? TIM_RCR(s->base) & 0xFF : 0;
+   update_event(s, true);
+}
+
+static void compare_event(struct timer_state *s, int ch)
+{
+   uint32_t base = s->base;
+
+   TIM_SR(base) |= TIM_SR_CC1IF << ch;
+
+   if ((TIM_DIER(base) & (TIM_DIER_CC1DE << ch)) && !(TIM_CR2(base) & TIM_CR2_CCDS))
+      hal_dma_request(s->dmaChannel[ch]);
+
+   trigger_adc(s->ccInjected[ch], s->ccRegular[ch]);
+
+   if (((TIM_CR2(base) & TIM_CR2_MMS_MASK) >> 4) == (uint32_t)(4 + ch))
+      trgo(s);
+}
+
+/** Process all events that happen when the counter arrives at phase p */
+static void arrive(struct timer_state *s, uint32_t p)
+{
+   uint32_t arr = active_arr(s);
+   uint32_t cnt = TIM_CNT(s->base) & 0xFFFF;
+   bool center = is_center(s->base);
+   uint32_t cms = (TIM_CR1(s->base) & TIM_CR1_CMS_MASK) >> 5;
+   bool countingUp = p > 0 && p <= arr;
+
+   for (int ch = 0; ch < NUM_CHANNELS; ch++)
+   {
+      if (is_input(s->base, ch) || active_ccr(s, ch) != cnt) continue;
+
+      //Center aligned mode 1 flags only counting down, mode 2 only counting up
+      if (center && ((cms == 1 && countingUp) || (cms == 2 && !countingUp))) continue;
+
+      compare_event(s, ch);
+   }
+
+   if (p == 0 || (center && p == arr))
+      counter_wrap(s);
+}
+
+static void advance(struct timer_state *s, uint32_t cycles)
+{
+   uint32_t base = s->base;
+
+   if (!(TIM_CR1(base) & TIM_CR1_CEN) || is_external_clock(base))
+      return;
+
+   uint64_t total = (uint64_t)s->pscCount + cycles;
+   uint64_t ticks = total / (s->psc + 1);
+   s->pscCount = total % (s->psc + 1);
+
+   while (ticks > 0 && (TIM_CR1(base) & TIM_CR1_CEN))
+   {
+      uint32_t per = period(s);
+
+      if (per == 0) break;
+
+      uint32_t p = get_phase(s);
+      uint32_t d = ticks_to_event(s);
+
+      if (ticks < d)
+      {
+         set_phase(s, (p + ticks) % per);
+         break;
+      }
+
+      ticks -= d;
+      p = (p + d) % per;
+      set_phase(s, p);
+      arrive(s, p);
+   }
+}
+
+/** Only timers that interrupt, request DMA, trigger the ADC or drive the
+ * power stage limit the step size. */
+static bool is_relevant(struct timer_state *s)
+{
+   static const uint32_t adcs[] = { ADC1, ADC2 };
+   bool adcTrigger = false;
+
+   for (unsigned i = 0; i < sizeof(adcs) / sizeof(adcs[0]); i++)
+   {
+      uint32_t jextsel;
+
+      if (!hal_adc_injected_trigger(adcs[i], &jextsel)) continue;
+
+      for (int ch = 0; ch < NUM_CHANNELS; ch++)
+         adcTrigger |= s->ccInjected[ch] == jextsel;
+      adcTrigger |= s->trgoInjected == jextsel;
+   }
+
+   return s->base == TIM1 || adcTrigger || (TIM_DIER(s->base) & 0x1FFF) != 0;
+}
+
+void hal_timer_reset(uint32_t base)
+{
+   struct timer_state *s = get_timer(base);
+
+   for (uint32_t ofs = 0; ofs < TIMER_REG_SIZE; ofs += 4)
+      MMIO32(base + ofs) = 0;
+
+   TIM_ARR(base) = 0xFFFF;
+
+   if (s)
+   {
+      s->psc = 0;
+      s->pscCount = 0;
+      s->arr = 0xFFFF;
+      s->rep = 0;
+      for (int ch = 0; ch < NUM_CHANNELS; ch++)
+         s->ccr[ch] = 0;
+   }
+}
+
+void hal_timer_init(void)
+{
+   for (int i = 0; i < NUM_TIMERS; i++)
+      hal_timer_reset(timers[i].base);
+}
+
+uint64_t hal_timer_next_event(void)
+{
+   uint64_t next = HAL_NEVER;
+
+   for (int i = 0; i < NUM_TIMERS; i++)
+   {
+      struct timer_state *s = &timers[i];
+
+      if (!(TIM_CR1(s->base) & TIM_CR1_CEN) || is_external_clock(s->base) ||
+          period(s) == 0 || !is_relevant(s))
+         continue;
+
+      uint64_t cycles = (uint64_t)ticks_to_event(s) * (s->psc + 1) - s->pscCount;
+
+      if (hal_now + cycles < next)
+         next = hal_now + cycles;
+   }
+   return next;
+}
+
+void hal_timer_advance(uint32_t cycles)
+{
+   for (int i = 0; i < NUM_TIMERS; i++)
+      advance(&timers[i], cycles);
+}
+
+bool hal_timer_irq_pending(int irqn)
+{
+   switch (irqn)
+   {
+   case NVIC_TIM1_UP_IRQ:
+      return TIM_SR(TIM1) & TIM_DIER(TIM1) & TIM_SR_UIF;
+   case NVIC_TIM1_BRK_IRQ:
+      return TIM_SR(TIM1) & TIM_DIER(TIM1) & TIM_SR_BIF;
+   case NVIC_TIM1_CC_IRQ:
+      return TIM_SR(TIM1) & TIM_DIER(TIM1) & 0x1E;
+   case NVIC_TIM1_TRG_COM_IRQ:
+      return TIM_SR(TIM1) & TIM_DIER(TIM1) & (TIM_SR_COMIF | TIM_SR_TIF);
+   case NVIC_TIM2_IRQ:
+      return TIM_SR(TIM2) & TIM_DIER(TIM2) & 0xFF;
+   case NVIC_TIM3_IRQ:
+      return TIM_SR(TIM3) & TIM_DIER(TIM3) & 0xFF;
+   case NVIC_TIM4_IRQ:
+      return TIM_SR(TIM4) & TIM_DIER(TIM4) & 0xFF;
+   default:
+      return false;
+   }
+}
+
+/** The break input of TIM1 is PB12, it disables the outputs as long as it is active */
+void hal_timer_check_break(void)
+{
+   if (!(TIM_BDTR(TIM1) & TIM_BDTR_BKE)) return;
+
+   bool activeLevel = (TIM_BDTR(TIM1) & TIM_BDTR_BKP) != 0;
+
+   if (hostsim_get_pin(GPIOB, GPIO12) == activeLevel)
+   {
+      TIM_SR(TIM1) |= TIM_SR_BIF;
+      TIM_BDTR(TIM1) &= ~TIM_BDTR_MOE;
+   }
+}
+
+/* Model interface */
+void hostsim_timer_count(uint32_t timer, int steps)
+{
+   struct timer_state *s = get_timer(timer);
+   uint32_t sms = TIM_SMCR(timer) & TIM_SMCR_SMS_MASK;
+   static int halfSteps[NUM_TIMERS];
+
+   if (!s || !(TIM_CR1(timer) & TIM_CR1_CEN) || !is_external_clock(timer)) return;
+
+   if (sms == TIM_SMCR_SMS_EM1 || sms == TIM_SMCR_SMS_EM2)
+   {
+      //Only edges of one input are counted
+      int *half = &halfSteps[s - timers];
+      *half += steps;
+      steps = *half / 2;
+      *half -= steps * 2;
+   }
+
+   if (steps == 0) return;
+
+   int32_t modulus = (int32_t)active_arr(s) + 1;
+   int32_t cnt = (int32_t)(TIM_CNT(timer) & 0xFFFF) + steps;
+
+   if (steps < 0)
+      TIM_CR1(timer) |= TIM_CR1_DIR_DOWN;
+   else
+      TIM_CR1(timer) &= ~TIM_CR1_DIR_DOWN;
+
+   while (cnt >= modulus)
+   {
+      cnt -= modulus;
+      counter_wrap(s);
+   }
+   while (cnt < 0)
+   {
+      cnt += modulus;
+      counter_wrap(s);
+   }
+   TIM_CNT(timer) = cnt;
+}
+
+void hostsim_timer_capture(uint32_t timer, enum tim_ic_id ic)
+{
+   struct timer_state *s = get_timer(timer);
+   int ch = ic;
+
+   if (!s) return;
+
+   if (is_input(timer, ch) && (TIM_CCER(timer) & (TIM_CCER_CC1E << (4 * ch))))
+   {
+      *ccr_reg(timer, ch) = TIM_CNT(timer) & 0xFFFF;
+
+      if (TIM_SR(timer) & (TIM_SR_CC1IF << ch))
+         TIM_SR(timer) |= TIM_SR_CC1OF << ch;
+
+      TIM_SR(timer) |= TIM_SR_CC1IF << ch;
+
+      if ((TIM_DIER(timer) & (TIM_DIER_CC1DE << ch)) && !(TIM_CR2(timer) & TIM_CR2_CCDS))
+         hal_dma_request(s->dmaChannel[ch]);
+   }
+
+   if ((TIM_SMCR(timer) & TIM_SMCR_SMS_MASK) == TIM_SMCR_SMS_RM)
+   {
+      uint32_t ts = TIM_SMCR(timer) & TIM_SMCR_TS_MASK;
+
+      //ETR is treated as being connected to the capture input that is used
+      if ((ts == TIM_SMCR_TS_TI1FP1 && ic == TIM_IC1) ||
+          (ts == TIM_SMCR_TS_TI2FP2 && ic == TIM_IC2) ||
+          ts == TIM_SMCR_TS_ETRF)
+      {
+         TIM_CNT(timer) = 0;
+         s->pscCount = 0;
+         TIM_SR(timer) |= TIM_SR_TIF;
+         update_event(s, false);
+      }
+   }
+}
+
+int hostsim_timer_ocref(uint32_t timer, enum tim_oc_id oc)
+{
+   struct timer_state *s = get_timer(timer);
+   int ch = oc_channel(oc);
+
+   if (!s) return 0;
+
+   uint32_t mode = (ccmr_get(timer, ch) >> 4) & 0x7;
+   uint32_t cnt = TIM_CNT(timer) & 0xFFFF;
+   uint32_t ccr = active_ccr(s, ch);
+   //Return the level that holds until the next event. Counting down the
+   //compare event happens at cnt == ccr but the output toggles one tick later
+   bool down = is_center(timer) && get_phase(s) >= active_arr(s);
+   bool active = down ? cnt <= ccr : cnt < ccr;
+
+   switch (mode)
+   {
+   case TIM_OCM_PWM1:
+      return active;
+   case TIM_OCM_PWM2:
+      return !active;
+   case TIM_OCM_FORCE_HIGH:
+      return 1;
+   default:
+      return 0;
+   }
+}
+
+uint32_t hostsim_timer_compare(uint32_t timer, enum tim_oc_id oc)
+{
+   struct timer_state *s = get_timer(timer);
+   return s ? active_ccr(s, oc_channel(oc)) : 0;
+}
+
+uint32_t hostsim_timer_period(uint32_t timer)
+{
+   struct timer_state *s = get_timer(timer);
+   return s ? active_arr(s) : 0;
+}
+
+bool hostsim_timer_outputs_enabled(uint32_t timer)
+{
+   return (TIM_BDTR(timer) & TIM_BDTR_MOE) != 0;
+}
+
+/* libopencm3 API */
+void timer_enable_irq(uint32_t timer_peripheral, uint32_t irq)
+{
+   TIM_DIER(timer_peripheral) |= irq;
+}
+
+void timer_disable_irq(uint32_t timer_peripheral, uint32_t irq)
+{
+   TIM_DIER(timer_peripheral) &= ~irq;
+}
+
+bool timer_interrupt_source(uint32_t timer_peripheral, uint32_t flag)
+{
+   return (TIM_SR(timer_peripheral) & TIM_DIER(timer_peripheral) & flag) != 0;
+}
+
+bool timer_get_flag(uint32_t timer_peripheral, uint32_t flag)
+{
+   return (TIM_SR(timer_peripheral) & flag) != 0;
+}
+
+void timer_clear_flag(uint32_t timer_peripheral, uint32_t flag)
+{
+   //The hardware register is rc_w0, plain memory needs an explicit and
+   TIM_SR(timer_peripheral) &= ~flag;
+}
+
+void timer_set_mode(uint32_t timer_peripheral, uint32_t clock_div,
+                    uint32_t alignment, uint32_t direction)
+{
+   uint32_t cr1 = TIM_CR1(timer_peripheral);
+   cr1 &= ~(TIM_CR1_CKD_CK_INT_MASK | TIM_CR1_CMS_MASK | TIM_CR1_DIR_DOWN);
+   TIM_CR1(timer_peripheral) = cr1 | clock_div | alignment | direction;
+}
+
+void timer_set_clock_division(uint32_t timer_peripheral, uint32_t clock_div)
+{
+   TIM_CR1(timer_peripheral) = (TIM_CR1(timer_peripheral) & ~TIM_CR1_CKD_CK_INT_MASK) | (clock_div & TIM_CR1_CKD_CK_INT_MASK);
+}
+
+void timer_enable_preload(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) |= TIM_CR1_ARPE;
+}
+
+void timer_disable_preload(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) &= ~TIM_CR1_ARPE;
+}
+
+void timer_set_alignment(uint32_t timer_peripheral, uint32_t alignment)
+{
+   TIM_CR1(timer_peripheral) = (TIM_CR1(timer_peripheral) & ~TIM_CR1_CMS_MASK) | (alignment & TIM_CR1_CMS_MASK);
+}
+
+void timer_direction_up(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) &= ~TIM_CR1_DIR_DOWN;
+}
+
+void timer_direction_down(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) |= TIM_CR1_DIR_DOWN;
+}
+
+void timer_one_shot_mode(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) |= TIM_CR1_OPM;
+}
+
+void timer_continuous_mode(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) &= ~TIM_CR1_OPM;
+}
+
+void timer_set_master_mode(uint32_t timer_peripheral, uint32_t mode)
+{
+   TIM_CR2(timer_peripheral) = (TIM_CR2(timer_peripheral) & ~TIM_CR2_MMS_MASK) | mode;
+}
+
+void timer_set_dma_on_compare_event(uint32_t timer_peripheral)
+{
+   TIM_CR2(timer_peripheral) &= ~TIM_CR2_CCDS;
+}
+
+void timer_set_dma_on_update_event(uint32_t timer_peripheral)
+{
+   TIM_CR2(timer_peripheral) |= TIM_CR2_CCDS;
+}
+
+void timer_enable_counter(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) |= TIM_CR1_CEN;
+}
+
+void timer_disable_counter(uint32_t timer_peripheral)
+{
+   TIM_CR1(timer_peripheral) &= ~TIM_CR1_CEN;
+}
+
+void timer_set_prescaler(uint32_t timer_peripheral, uint32_t value)
+{
+   TIM_PSC(timer_peripheral) = value;
+}
+
+void timer_set_repetition_counter(uint32_t timer_peripheral, uint32_t value)
+{
+   TIM_RCR(timer_peripheral) = value;
+}
+
+void timer_set_period(uint32_t timer_peripheral, uint32_t period)
+{
+   TIM_ARR(timer_peripheral) = period;
+}
+
+static uint32_t ccer_enable_bit(enum tim_oc_id oc_id)
+{
+   //OC1 -> CC1E, OC1N -> CC1NE, OC2 -> CC2E ... OC4 -> CC4E
+   return oc_id == TIM_OC4 ? TIM_CCER_CC4E : TIM_CCER_CC1E << (2 * oc_id);
+}
+
+void timer_enable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CCER(timer_peripheral) |= ccer_enable_bit(oc_id);
+}
+
+void timer_disable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CCER(timer_peripheral) &= ~ccer_enable_bit(oc_id);
+}
+
+static bool is_complementary(enum tim_oc_id oc_id)
+{
+   return oc_id == TIM_OC1N || oc_id == TIM_OC2N || oc_id == TIM_OC3N;
+}
+
+void timer_set_oc_mode(uint32_t timer_peripheral, enum tim_oc_id oc_id,
+                       enum tim_oc_mode oc_mode)
+{
+   if (is_complementary(oc_id)) return; //Applies to the whole channel
+
+   int ch = oc_channel(oc_id);
+   ccmr_modify(timer_peripheral, ch, 0x3, 0); //Output
+   ccmr_modify(timer_peripheral, ch, 0x70, oc_mode << 4);
+}
+
+void timer_enable_oc_preload(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   if (is_complementary(oc_id)) return;
+   ccmr_modify(timer_peripheral, oc_channel(oc_id), TIM_CCMR1_OC1PE, TIM_CCMR1_OC1PE);
+}
+
+void timer_disable_oc_preload(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   if (is_complementary(oc_id)) return;
+   ccmr_modify(timer_peripheral, oc_channel(oc_id), TIM_CCMR1_OC1PE, 0);
+}
+
+void timer_set_oc_polarity_high(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CCER(timer_peripheral) &= ~(ccer_enable_bit(oc_id) << 1);
+}
+
+void timer_set_oc_polarity_low(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CCER(timer_peripheral) |= ccer_enable_bit(oc_id) << 1;
+}
+
+void timer_set_oc_idle_state_set(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CR2(timer_peripheral) |= 1 << (8 + oc_id);
+}
+
+void timer_set_oc_idle_state_unset(uint32_t timer_peripheral, enum tim_oc_id oc_id)
+{
+   TIM_CR2(timer_peripheral) &= ~(1 << (8 + oc_id));
+}
+
+void timer_set_oc_value(uint32_t timer_peripheral, enum tim_oc_id oc_id, uint32_t value)
+{
+   if (is_complementary(oc_id)) return;
+   *ccr_reg(timer_peripheral, oc_channel(oc_id)) = value;
+}
+
+void timer_enable_break_main_output(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_MOE;
+}
+
+void timer_disable_break_main_output(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_MOE;
+}
+
+void timer_enable_break_automatic_output(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_AOE;
+}
+
+void timer_disable_break_automatic_output(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_AOE;
+}
+
+void timer_set_break_polarity_high(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_BKP;
+}
+
+void timer_set_break_polarity_low(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_BKP;
+}
+
+void timer_enable_break(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_BKE;
+}
+
+void timer_disable_break(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_BKE;
+}
+
+void timer_set_enabled_off_state_in_run_mode(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_OSSR;
+}
+
+void timer_set_disabled_off_state_in_run_mode(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_OSSR;
+}
+
+void timer_set_enabled_off_state_in_idle_mode(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) |= TIM_BDTR_OSSI;
+}
+
+void timer_set_disabled_off_state_in_idle_mode(uint32_t timer_peripheral)
+{
+   TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_OSSI;
+}
+
+void timer_set_deadtime(uint32_t timer_peripheral, uint32_t deadtime)
+{
+   TIM_BDTR(timer_peripheral) = (TIM_BDTR(timer_peripheral) & ~TIM_BDTR_DTG_MASK) | (deadtime & TIM_BDTR_DTG_MASK);
+}
+
+void timer_generate_event(uint32_t timer_peripheral, uint32_t event)
+{
+   struct timer_state *s = get_timer(timer_peripheral);
+
+   if (!s) return;
+
+   if (event & TIM_EGR_UG)
+   {
+      bool down = !is_center(timer_peripheral) && (TIM_CR1(timer_peripheral) & TIM_CR1_DIR_DOWN);
+      TIM_CNT(timer_peripheral) = down ? TIM_ARR(timer_peripheral) & 0xFFFF : 0;
+      if (is_center(timer_peripheral))
+         TIM_CR1(timer_peripheral) &= ~TIM_CR1_DIR_DOWN;
+      s->pscCount = 0;
+      s->rep = timer_peripheral == TIM1 ? TIM_RCR(timer_peripheral) & 0xFF : 0;
+      update_event(s, false);
+   }
+
+   for (int ch = 0; ch < NUM_CHANNELS; ch++)
+   {
+      if (event & (TIM_EGR_CC1G << ch))
+      {
+         if (is_input(timer_peripheral, ch))
+            *ccr_reg(timer_peripheral, ch) = TIM_CNT(timer_peripheral) & 0xFFFF;
+         TIM_SR(timer_peripheral) |= TIM_SR_CC1IF << ch;
+      }
+   }
+
+   if (event & TIM_EGR_BG)
+   {
+      TIM_SR(timer_peripheral) |= TIM_SR_BIF;
+      TIM_BDTR(timer_peripheral) &= ~TIM_BDTR_MOE;
+   }
+}
+
+uint32_t timer_get_counter(uint32_t timer_peripheral)
+{
+   return TIM_CNT(timer_peripheral) & 0xFFFF;
+}
+
+uint32_t timer_get_ic_value(uint32_t timer_peripheral, enum tim_ic_id ic)
+{
+   return *ccr_reg(timer_peripheral, ic) & 0xFFFF;
+}
+
+void timer_set_counter(uint32_t timer_peripheral, uint32_t count)
+{
+   TIM_CNT(timer_peripheral) = count & 0xFFFF;
+}
+
+void timer_ic_set_filter(uint32_t timer_peripheral, enum tim_ic_id ic, enum tim_ic_filter flt)
+{
+   ccmr_modify(timer_peripheral, ic, 0xF0, flt << 4);
+}
+
+void timer_ic_set_prescaler(uint32_t timer_peripheral, enum tim_ic_id ic, enum tim_ic_psc psc)
+{
+   ccmr_modify(timer_peripheral, ic, 0x0C, psc << 2);
+}
+
+void timer_ic_set_input(uint32_t timer_peripheral, enum tim_ic_id ic, enum tim_ic_input in)
+{
+   uint32_t sel = in & 3;
+
+   //CCxS=01 always selects the channel's own input, the neighbour is 10
+   if ((ic == TIM_IC2 || ic == TIM_IC4) && (in == TIM_IC_IN_TI1 || in == TIM_IC_IN_TI2))
+      sel ^= 3;
+   else if ((ic == TIM_IC3 && in == TIM_IC_IN_TI3) || (ic == TIM_IC4 && in == TIM_IC_IN_TI4))
+      sel = 1;
+   else if ((ic == TIM_IC3 && in == TIM_IC_IN_TI4) || (ic == TIM_IC4 && in == TIM_IC_IN_TI3))
+      sel = 2;
+
+   ccmr_modify(timer_peripheral, ic, 0x3, sel);
+}
+
+void timer_ic_enable(uint32_t timer_peripheral, enum tim_ic_id ic)
+{
+   TIM_CCER(timer_peripheral) |= TIM_CCER_CC1E << (4 * ic);
+}
+
+void timer_ic_disable(uint32_t timer_peripheral, enum tim_ic_id ic)
+{
+   TIM_CCER(timer_peripheral) &= ~(TIM_CCER_CC1E << (4 * ic));
+}
+
+void timer_slave_set_filter(uint32_t timer_peripheral, enum tim_ic_filter flt)
+{
+   TIM_SMCR(timer_peripheral) = (TIM_SMCR(timer_peripheral) & ~TIM_SMCR_ETF_MASK) | (flt << 8);
+}
+
+void timer_slave_set_polarity(uint32_t timer_peripheral, enum tim_et_pol pol)
+{
+   if (pol == TIM_ET_FALLING)
+      TIM_SMCR(timer_peripheral) |= TIM_SMCR_ETP;
+   else
+      TIM_SMCR(timer_peripheral) &= ~TIM_SMCR_ETP;
+}
+
+void timer_slave_set_mode(uint32_t timer_peripheral, uint8_t mode)
+{
+   TIM_SMCR(timer_peripheral) = (TIM_SMCR(timer_peripheral) & ~TIM_SMCR_SMS_MASK) | mode;
+}
+
+void timer_slave_set_trigger(uint32_t timer_peripheral, uint8_t trigger)
+{
+   TIM_SMCR(timer_peripheral) = (TIM_SMCR(timer_peripheral) & ~TIM_SMCR_TS_MASK) | trigger;
+}
@@ -0,0 +1,364 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <libopencm3/stm32/usart.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/rcc.h>
+#include "hal_internal.h"
+
+/* The terminal USART is connected to stdin/stdout. The firmware provides its
+ * own putchar()/printf(), so everything here uses write() directly. */
+
+#define RX_DMA_CHANNEL   3
+#define OUT_BUFSIZE      4096
+#define IN_BUFSIZE       256
+#define DEFAULT_BAUD     115200
+#define LINE_IDLE_TIME   HOSTSIM_MS(10)
+
+static char outBuf[OUT_BUFSIZE];
+static int outLen = 0;
+static char inBuf[IN_BUFSIZE];
+static int inLen = 0, inPos = 0;
+static bool inEof = false;
+static uint64_t nextRx = 0;        //earliest time the next byte can be received
+static uint64_t txBusyUntil = 0;   //end of the last byte in the shift register
+static uint8_t txDmaChannel = 0;   //channel waiting for its transfer complete flag
+static bool lineHold = false;      //wait for the answer before sending the next line
+static uint64_t lineEnd = 0;
+static bool pacedInput = false;
+static bool flushAlways = false;
+static bool rawMode = false;
+static struct termios savedTermios;
+
+static void restore_terminal(void)
+{
+   if (rawMode)
+      tcsetattr(0, TCSANOW, &savedTermios);
+}
+
+void hal_usart_init(void)
+{
+   flushAlways = isatty(1);
+   pacedInput = !isatty(0);
+
+   if (isatty(0) && tcgetattr(0, &savedTermios) == 0)
+   {
+      struct termios raw = savedTermios;
+
+      //Characters are passed on immediately and echoed by the firmware, Ctrl-C still works
+      raw.c_lflag &= ~(ICANON | ECHO);
+      raw.c_iflag &= ~(ICRNL | IXON);
+      raw.c_cc[VMIN] = 1;
+      raw.c_cc[VTIME] = 0;
+      rawMode = tcsetattr(0, TCSANOW, &raw) == 0;
+      atexit(restore_terminal);
+   }
+}
+
+/** Duration of one frame in CPU cycles */
+static uint64_t byte_time(void)
+{
+   uint32_t brr = USART_BRR(USART3) & 0xFFFF;
+   uint32_t bits = 1 + ((USART_CR1(USART3) & USART_CR1_M) ? 9 : 8);
+
+   bits += (USART_CR2(USART3) & USART_CR2_STOPBITS_MASK) == USART_STOPBITS_2 ? 2 : 1;
+
+   if (brr == 0 || rcc_apb1_frequency == 0)
+      return (uint64_t)bits * HOSTSIM_CLOCK / DEFAULT_BAUD;
+
+   return (uint64_t)bits * brr * HOSTSIM_CLOCK / rcc_apb1_frequency;
+}
+
+void hal_usart_flush(void)
+{
+   int pos = 0;
+
+   while (pos < outLen)
+   {
+      ssize_t written = write(1, outBuf + pos, outLen - pos);
+
+      if (written < 0 && errno != EINTR && errno != EAGAIN) break;
+      if (written > 0) pos += written;
+   }
+   outLen = 0;
+}
+
+void hal_usart_finish(void)
+{
+   hal_usart_flush();
+   restore_terminal();
+}
+
+static void fill_input(void)
+{
+   struct pollfd pfd = { 0, POLLIN, 0 };
+
+   if (inEof || inPos < inLen) return;
+
+   if (poll(&pfd, 1, 0) > 0)
+   {
+      ssize_t n = read(0, inBuf, sizeof(inBuf));
+
+      inPos = 0;
+      inLen = n > 0 ? n : 0;
+      inEof = n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN);
+   }
+}
+
+static bool receiving(void)
+{
+   return (USART_CR1(USART3) & (USART_CR1_UE | USART_CR1_RE)) == (USART_CR1_UE | USART_CR1_RE);
+}
+
+/** Scripted input is sent line by line, each line is held back until
+ * the firmware has finished answering the previous one. */
+static uint64_t line_release_time(void)
+{
+   uint64_t release = lineEnd > txBusyUntil ? lineEnd : txBusyUntil;
+   return release + LINE_IDLE_TIME;
+}
+
+uint64_t hal_usart_next_event(void)
+{
+   uint64_t next = HAL_NEVER;
+
+   if (receiving() && inPos < inLen)
+   {
+      next = nextRx > hal_now ? nextRx : hal_now;
+      if (lineHold && line_release_time() > next)
+         next = line_release_time();
+   }
+   if (txBusyUntil > hal_now && txBusyUntil < next)
+      next = txBusyUntil;
+
+   return next;
+}
+
+static void update_tx_flags(void)
+{
+   uint64_t bt = byte_time();
+
+   //One byte may wait in the data register while another is being shifted out
+   if (txBusyUntil <= hal_now + bt)
+      USART_SR(USART3) |= USART_SR_TXE;
+   else
+      USART_SR(USART3) &= ~USART_SR_TXE;
+
+   if (txBusyUntil <= hal_now)
+      USART_SR(USART3) |= USART_SR_TC;
+   else
+      USART_SR(USART3) &= ~USART_SR_TC;
+}
+
+void hal_usart_advance(void)
+{
+   if (receiving())
+   {
+      fill_input();
+
+      if (lineHold && hal_now >= line_release_time())
+         lineHold = false;
+
+      if (inPos < inLen && hal_now >= nextRx && !lineHold)
+      {
+         char c = inBuf[inPos];
+
+         if (pacedInput && (c == '\n' || c == '\r'))
+         {
+            lineHold = true;
+            lineEnd = hal_now;
+         }
+
+         if (USART_SR(USART3) & USART_SR_RXNE)
+            USART_SR(USART3) |= USART_SR_ORE;
+
+         USART_DR(USART3) = (uint8_t)inBuf[inPos++];
+         USART_SR(USART3) |= USART_SR_RXNE;
+         nextRx = hal_now + byte_time();
+
+         if (USART_CR3(USART3) & USART_CR3_DMAR)
+            hal_dma_request(RX_DMA_CHANNEL);
+      }
+   }
+
+   update_tx_flags();
+
+   if (txDmaChannel != 0 && txBusyUntil <= hal_now)
+   {
+      DMA_ISR(DMA1) |= (DMA_TCIF | DMA_GIF) << DMA_FLAG_OFFSET(txDmaChannel);
+      txDmaChannel = 0;
+   }
+
+   if (flushAlways && outLen > 0)
+      hal_usart_flush();
+}
+
+bool hal_usart_at_eof(void)
+{
+   return inEof && inPos >= inLen && txBusyUntil <= hal_now;
+}
+
+uint32_t hal_usart_read_dr(uint32_t usart)
+{
+   USART_SR(usart) &= ~USART_SR_RXNE;
+   return USART_DR(usart) & 0x1FF;
+}
+
+void hal_usart_write_dr(uint32_t usart, uint32_t value)
+{
+   if (usart != USART3 || !(USART_CR1(usart) & USART_CR1_TE)) return;
+
+   if (outLen >= OUT_BUFSIZE)
+      hal_usart_flush();
+
+   outBuf[outLen++] = value;
+   txBusyUntil = (txBusyUntil > hal_now ? txBusyUntil : hal_now) + byte_time();
+   update_tx_flags();
+}
+
+/** The bytes are output immediately, the transfer complete flag
+ * is set once they would have been sent on the wire */
+void hal_usart_kick_tx_dma(uint8_t channel)
+{
+   if (!(USART_CR3(USART3) & USART_CR3_DMAT)) return;
+
+   while (DMA_CNDTR(DMA1, channel) > 0 && (DMA_CCR(DMA1, channel) & DMA_CCR_EN))
+   {
+      uint32_t count = DMA_CNDTR(DMA1, channel);
+      hal_dma_request(channel);
+      if (DMA_CNDTR(DMA1, channel) >= count) break; //Circular mode would never end
+   }
+
+   DMA_ISR(DMA1) &= ~((DMA_TCIF | DMA_HTIF | DMA_GIF) << DMA_FLAG_OFFSET(channel));
+   txDmaChannel = channel;
+}
+
+/* libopencm3 API */
+void usart_set_baudrate(uint32_t usart, uint32_t baud)
+{
+   uint32_t clock = usart == USART1 ? rcc_apb2_frequency : rcc_apb1_frequency;
+   USART_BRR(usart) = (clock + baud / 2) / baud;
+}
+
+void usart_set_databits(uint32_t usart, uint32_t bits)
+{
+   if (bits == 8)
+      USART_CR1(usart) &= ~USART_CR1_M;
+   else
+      USART_CR1(usart) |= USART_CR1_M;
+}
+
+void usart_set_stopbits(uint32_t usart, uint32_t stopbits)
+{
+   USART_CR2(usart) = (USART_CR2(usart) & ~USART_CR2_STOPBITS_MASK) | stopbits;
+}
+
+void usart_set_parity(uint32_t usart, uint32_t parity)
+{
+   USART_CR1(usart) = (USART_CR1(usart) & ~USART_PARITY_MASK) | parity;
+}
+
+void usart_set_mode(uint32_t usart, uint32_t mode)
+{
+   USART_CR1(usart) = (USART_CR1(usart) & ~USART_MODE_MASK) | mode;
+}
+
+void usart_set_flow_control(uint32_t usart, uint32_t flowcontrol)
+{
+   USART_CR3(usart) = (USART_CR3(usart) & ~USART_FLOWCONTROL_MASK) | flowcontrol;
+}
+
+void usart_enable(uint32_t usart)
+{
+   USART_CR1(usart) |= USART_CR1_UE;
+   USART_SR(usart) |= USART_SR_TXE | USART_SR_TC;
+}
+
+void usart_disable(uint32_t usart)
+{
+   USART_CR1(usart) &= ~USART_CR1_UE;
+}
+
+void usart_send(uint32_t usart, uint16_t data)
+{
+   hal_usart_write_dr(usart, data);
+}
+
+uint16_t usart_recv(uint32_t usart)
+{
+   return hal_usart_read_dr(usart);
+}
+
+void usart_wait_send_ready(uint32_t usart)
+{
+   //Time does not advance inside interrupt handlers, send right away
+   if (hal_isr_depth > 0) return;
+
+   while (!(USART_SR(usart) & USART_SR_TXE))
+      hal_poll();
+}
+
+void usart_wait_recv_ready(uint32_t usart)
+{
+   while (!(USART_SR(usart) & USART_SR_RXNE))
+      hal_poll();
+}
+
+void usart_send_blocking(uint32_t usart, uint16_t data)
+{
+   usart_wait_send_ready(usart);
+   usart_send(usart, data);
+}
+
+uint16_t usart_recv_blocking(uint32_t usart)
+{
+   usart_wait_recv_ready(usart);
+   return usart_recv(usart);
+}
+
+void usart_enable_rx_dma(uint32_t usart)
+{
+   USART_CR3(usart) |= USART_CR3_DMAR;
+}
+
+void usart_disable_rx_dma(uint32_t usart)
+{
+   USART_CR3(usart) &= ~USART_CR3_DMAR;
+}
+
+void usart_enable_tx_dma(uint32_t usart)
+{
+   USART_CR3(usart) |= USART_CR3_DMAT;
+}
+
+void usart_disable_tx_dma(uint32_t usart)
+{
+   USART_CR3(usart) &= ~USART_CR3_DMAT;
+}
+
+bool usart_get_flag(uint32_t usart, uint32_t flag)
+{
+   hal_poll();
+   return (USART_SR(usart) & flag) != 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MODEL_H_INCLUDED
+#define MODEL_H_INCLUDED
+
+#include <stdbool.h>
+
+/** \file model.h
+ * Motor plants that can be attached to the test bench in model_bench.c.
+ *
+ * The bench converts the TIM1 outputs into stator voltages, integrates the
+ * mechanical system and feeds currents and rotor position back to the ADC
+ * and encoder inputs. A plant only models the electrical machine.
+ * All quantities are SI units, angles in rad, stator voltage and current in
+ * the stationary alpha/beta frame (amplitude invariant Clarke transform).
+ */
+
+struct motor_state
+{
+   double ialpha, ibeta;   //!< stator current
+   double id, iq;          //!< stator current in rotor flux oriented frame
+   double torque;          //!< air gap torque in Nm
+   double fluxAngle;       //!< electrical angle of the d axis
+};
+
+struct motor_model
+{
+   const char *name;
+   /** \brief Read parameters and reset state */
+   void (*init)(void);
+   /** \brief Integrate the machine for h seconds
+    * \param ualpha stator voltage, alpha axis
+    * \param ubeta stator voltage, beta axis
+    * \param theta mechanical rotor angle
+    * \param omega mechanical rotor speed in rad/s
+    */
+   void (*step)(double h, double ualpha, double ubeta, double theta, double omega);
+   /** \brief Stator current is zero for h seconds because all switches are open */
+   void (*open)(double h, double omega);
+   const struct motor_state *state;
+};
+
+/** \brief Get a parameter of the HOSTSIM_MOTOR list "type,key=value,..." */
+double model_motor_param(const char *key, double def);
+
+extern const struct motor_model model_pmsm;
+extern const struct motor_model model_im;
+
+#endif // MODEL_H_INCLUDED
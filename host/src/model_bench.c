@@ -0,0 +1,718 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/can.h>
+#include "hostsim.h"
+#include "model.h"
+
+/** \file model_bench.c
+ * Closed loop test bench: inverter, current sensors, position sensors,
+ * mechanical load and the vehicle side (CAN torque request, start signal).
+ *
+ * The bench is enabled by selecting a motor with HOSTSIM_MOTOR=<type>,...
+ * and configured with HOSTSIM_BENCH=key=value,... (defaults in brackets)
+ *  - udc      DC link voltage in V (400)
+ *  - udcgain  divider gain in dig/V, must match parameter udcgain (6.175)
+ *  - ilgain   current sensor gain in dig/A, see il1gain/il2gain (4.7)
+ *  - torque   torque request in % sent via CAN 0x287 (0)
+ *  - tstep    time in s at which the request changes to torque2 (never),
+ *             must be after the drive has started switching at about 1.1 s
+ *  - torque2  torque request after tstep (0)
+ *  - rpm      hold the rotor at this speed like a dyno (free running)
+ *  - rpm0     initial speed when free running (0)
+ *  - j        inertia in kgm² (0.05)
+ *  - b        viscous friction in Nm/(rad/s) (0.001)
+ *  - load     load torque in Nm that opposes the rotation (0)
+ *  - pulses   pulses per turn of the single channel speed sensor (60)
+ *  - resolver 1: resolver that needs excitation, 0: sin/cos sensor (0)
+ *  - respp    pole pairs of resolver/sin-cos sensor (1)
+ *  - resamp   resolver/sin-cos amplitude in dig (1500)
+ *  - sinofs   offset of the sin signal in dig, not modulated by the exciter (0)
+ *  - cosofs   offset of the cos signal in dig (0)
+ *  - cosgain  amplitude of the cos signal relative to sin (1)
+ *  - cosphase phase error of the cos signal in  (0)
+ *  - eccerr1  once per turn angle error of the resolver/sin-cos sensor in  (0)
+ *  - eccerr2  twice per turn angle error in  (0)
+ *  - swap     1: motor leads of phase 2 and 3 exchanged, reverses the phase
+ *             sequence seen by the motor (0)
+ *  - tmeas    start of the window for the steady state statistics (half of the run)
+ *  - trace    file that receives one CSV line per PWM period, phase currents
+ *             are instantaneous, id, iq and torque averaged over the period
+ *
+ * In SPI mode an AD2S chip with 8.192 MHz crystal is attached: it latches
+ * angle or velocity (RDVEL on PC6 low) when a frame starts and shifts out one
+ * bit per clock on PA7, the bits are presented in step with the DMA requests
+ * of TIM3 channel 1 that sample them.
+ *
+ * The inverter is modelled on switch level from the OCxREF signals of TIM1:
+ * during dead time and with the outputs disabled the phase potential is
+ * defined by the freewheeling diode that carries the current. The AB encoder
+ * counts, the north marker and the sin/cos or resolver signals are all
+ * generated at the same time, so any encmode can be selected.
+ */
+
+#define MAX_SUBSTEP       1e-6
+#define SENSOR_STEP       HOSTSIM_US(5) //Encoder edges are time stamped at step boundaries
+#define CAN_PERIOD        HOSTSIM_MS(100)
+#define CAN_TORQUE_OFS    10000
+#define CAN_TORQUE_SCALE  (10 * 32) //10000 + 10 * FP_FROMINT(torque)
+#define ADC_OFS           2048
+#define EXC_TIMEOUT       1e-3
+#define OPEN_CURRENT      0.05
+#define STEP_BAND         0.05
+#define STEP_BASE         10e-3 //Window before the torque step that gives the initial iq
+#define SQRT3             1.7320508075688772
+#define SPI_DMACHAN       6
+#define SPI_BITS          16
+#define SPI_VEL_FULLSCALE 1000 //rps
+
+struct sample
+{
+   float t, id, iq, torque, rpm;
+   bool driven; //All three phases were switched during the whole period
+};
+
+static const struct motor_model *const motors[] = { &model_pmsm, &model_im };
+static const struct motor_model *motor;
+
+static double udc, udcGain, ilGain;
+static double torqueRequest, torqueStepTime, torqueStep;
+static double fixedRpm, inertia, friction, load;
+static double resPolePairs, resAmp, tmeas, pulsesPerRev;
+static double sinOfs, cosOfs, cosGain, cosPhase, eccErr1, eccErr2;
+static double sequence;
+static bool resolver;
+static FILE *trace;
+
+static double theta, omega;
+static int lastRef[3];
+static double edgeTime[3];
+static uint64_t nextCan;
+static double nextSample;
+static uint32_t edgesPerRev;
+static int64_t lastEdge, lastTurn, lastPulse;
+static bool northHigh;
+static bool spiSelected, spiDriven;
+static uint16_t spiFrame;
+static bool excLevel;
+static double excToggle = -1;
+
+static double avgTime, avgId, avgIq, avgTorque;
+static bool periodDriven = true;
+static struct sample *samples;
+static size_t numSamples, maxSamples;
+
+/** Find key in a comma separated list of key=value pairs */
+static const char *find_value(const char *list, const char *key)
+{
+   size_t len = strlen(key);
+
+   while (list != NULL && *list)
+   {
+      if (strncmp(list, key, len) == 0 && list[len] == '=')
+         return list + len + 1;
+
+      list = strchr(list, ',');
+      if (list) list++;
+   }
+   return NULL;
+}
+
+static double bench_param(const char *key, double def)
+{
+   const char *value = find_value(getenv("HOSTSIM_BENCH"), key);
+   return value ? strtod(value, NULL) : def;
+}
+
+double model_motor_param(const char *key, double def)
+{
+   const char *value = find_value(getenv("HOSTSIM_MOTOR"), key);
+   return value ? strtod(value, NULL) : def;
+}
+
+static void open_trace(void)
+{
+   const char *value = find_value(getenv("HOSTSIM_BENCH"), "trace");
+   char name[256];
+
+   if (value == NULL) return;
+
+   size_t len = strcspn(value, ",");
+   len = len < sizeof(name) - 1 ? len : sizeof(name) - 1;
+   memcpy(name, value, len);
+   name[len] = 0;
+
+   trace = fopen(name, "w");
+
+   if (trace == NULL)
+   {
+      perror(name);
+      exit(1);
+   }
+   fprintf(trace, "t,ia,ib,id,iq,torque,rpm,angle,dc1,dc2,dc3\n");
+}
+
+static int clamp_adc(double digits)
+{
+   long rounded = lround(digits);
+   return rounded < 0 ? 0 : rounded > HOSTSIM_ADC_MAX ? HOSTSIM_ADC_MAX : rounded;
+}
+
+static uint32_t north_port(void)
+{
+   return strcmp(hostsim_board(), "bluepill") == 0 ? GPIOC : GPIOD;
+}
+
+static uint16_t north_pin(void)
+{
+   return strcmp(hostsim_board(), "bluepill") == 0 ? GPIO14 : GPIO2;
+}
+
+static bool is_output(uint32_t port, uint16_t pin)
+{
+   int n = __builtin_ctz(pin);
+   uint32_t reg = n < 8 ? GPIO_CRL(port) : GPIO_CRH(port);
+   return ((reg >> ((n & 7) * 4)) & 0x3) != GPIO_MODE_INPUT;
+}
+
+/** Dead time inserted by TIM1 on every edge of OCxREF, see DTG in TIMx_BDTR */
+static double dead_time(void)
+{
+   uint32_t dtg = TIM_BDTR(TIM1) & 0xFF;
+   uint32_t ckd = (TIM_CR1(TIM1) >> 8) & 0x3;
+   double tdts = (1 << ckd) / (double)HOSTSIM_CLOCK;
+
+   if ((dtg & 0x80) == 0)
+      return dtg * tdts;
+   else if ((dtg & 0xC0) == 0x80)
+      return (64 + (dtg & 0x3F)) * 2 * tdts;
+   else if ((dtg & 0xE0) == 0xC0)
+      return (32 + (dtg & 0x1F)) * 8 * tdts;
+   return (32 + (dtg & 0x1F)) * 16 * tdts;
+}
+
+static double pwm_period(void)
+{
+   uint32_t arr = hostsim_timer_period(TIM1);
+   return arr > 0 ? 2.0 * arr * (TIM_PSC(TIM1) + 1) / HOSTSIM_CLOCK : 1e-4;
+}
+
+static void phase_currents(double i[3])
+{
+   const struct motor_state *s = motor->state;
+
+   i[0] = s->ialpha;
+   i[1] = -0.5 * s->ialpha + 0.5 * SQRT3 * sequence * s->ibeta;
+   i[2] = -i[0] - i[1];
+}
+
+static void send_torque_request(double t)
+{
+   double torque = t >= torqueStepTime ? torqueStep : torqueRequest;
+   long raw = lround(CAN_TORQUE_OFS + torque * CAN_TORQUE_SCALE);
+   uint8_t data[8] = { 0 };
+
+   raw = raw < 0 ? 0 : raw > 0xFFFF ? 0xFFFF : raw;
+   data[2] = raw >> 8;
+   data[3] = raw & 0xFF;
+   data[6] = 3; //run
+
+   hostsim_can_receive(CAN1, 0x287, false, sizeof(data), data);
+}
+
+/** Integrate inverter, machine and mechanics over one step of constant OCxREF */
+static void run_plant(double t, double h)
+{
+   static const enum tim_oc_id oc[3] = { TIM_OC1, TIM_OC2, TIM_OC3 };
+   static const uint32_t ccxe[3] = { TIM_CCER_CC1E, TIM_CCER_CC2E, TIM_CCER_CC3E };
+   bool moe = hostsim_timer_outputs_enabled(TIM1) && (TIM_CR1(TIM1) & TIM_CR1_CEN);
+   bool enabled[3];
+   bool allEnabled = true;
+   double td = dead_time();
+   double end = t + h;
+
+   for (int ph = 0; ph < 3; ph++)
+   {
+      int ref = hostsim_timer_ocref(TIM1, oc[ph]);
+
+      if (ref != lastRef[ph])
+      {
+         edgeTime[ph] = t;
+         lastRef[ph] = ref;
+      }
+      enabled[ph] = moe && (TIM_CCER(TIM1) & ccxe[ph]);
+      allEnabled &= enabled[ph];
+   }
+   periodDriven &= allEnabled;
+
+   while (t < end)
+   {
+      double hs = fmin(end - t, MAX_SUBSTEP);
+      double i[3], v[3];
+
+      phase_currents(i);
+
+      for (int ph = 0; ph < 3; ph++)
+      {
+         double deadEnd = edgeTime[ph] + td;
+
+         if (enabled[ph] && t >= deadEnd)
+         {
+            v[ph] = lastRef[ph] ? udc : 0;
+         }
+         else
+         {
+            //Freewheeling diode: low side for positive, high side for negative current
+            v[ph] = i[ph] > 0 ? 0 : udc;
+
+            if (enabled[ph] && deadEnd - t < hs)
+               hs = deadEnd - t;
+         }
+      }
+
+      double before = fabs(i[0]) + fabs(i[1]);
+
+      if (!allEnabled && before < OPEN_CURRENT)
+      {
+         motor->open(hs, omega);
+      }
+      else
+      {
+         double ualpha = (2 * v[0] - v[1] - v[2]) / 3;
+         double ubeta = sequence * (v[1] - v[2]) / SQRT3;
+
+         motor->step(hs, ualpha, ubeta, theta, omega);
+
+         phase_currents(i);
+
+         //Diodes block as soon as the current reaches zero
+         if (!allEnabled && fabs(i[0]) + fabs(i[1]) >= before)
+            motor->open(hs, omega);
+      }
+
+      if (fixedRpm >= 0)
+         omega = fixedRpm * 2 * M_PI / 60;
+      else
+         omega += hs * (motor->state->torque - load * tanh(omega) - friction * omega) / inertia;
+
+      avgTime += hs;
+      avgId += hs * motor->state->id;
+      avgIq += hs * motor->state->iq;
+      avgTorque += hs * motor->state->torque;
+
+      theta += hs * omega;
+      t += hs;
+   }
+}
+
+/** AD2S frame DATA[11:0], RDVEL, odd parity, DOS, LOT, no faults */
+static uint16_t spi_frame(double thetaSensor, bool velocity)
+{
+   int data;
+
+   if (velocity)
+   {
+      data = lround(resPolePairs * omega / (2 * M_PI) * 2048 / SPI_VEL_FULLSCALE);
+      data = data < -2048 ? -2048 : data > 2047 ? 2047 : data;
+   }
+   else
+   {
+      double rev = thetaSensor / (2 * M_PI);
+      data = (int)floor((rev - floor(rev)) * 4096);
+   }
+
+   uint16_t frame = ((data & 0xFFF) << 4) | (velocity ? 0 : 8) | 3;
+
+   if (!__builtin_parity(frame))
+      frame |= 4;
+   return frame;
+}
+
+/** Drive the data pin of the AD2S chip while read is low in SPI mode.
+ * Read only goes high for a moment within the PWM interrupt, so a restarted
+ * DMA transfer marks the beginning of the next frame as well. */
+static void spi_chip(uint32_t port, uint16_t pin, double thetaSensor)
+{
+   static int lastBit;
+   bool spi = (TIM_DIER(TIM3) & TIM_DIER_CC1DE) && (TIM_SMCR(TIM3) & TIM_SMCR_SMS_MASK) == 0;
+   bool selected = spi && is_output(port, pin) && !(GPIO_ODR(port) & pin);
+   int bit = SPI_BITS - (int)(DMA_CNDTR(DMA1, SPI_DMACHAN) & 0xFFFF);
+
+   if (selected && (!spiSelected || bit < lastBit))
+   {
+      bool velocity = is_output(GPIOC, GPIO6) && !(GPIO_ODR(GPIOC) & GPIO6);
+      spiFrame = spi_frame(thetaSensor, velocity);
+   }
+   spiSelected = selected;
+   lastBit = bit;
+
+   if (selected)
+   {
+      bool level = bit >= 0 && bit < SPI_BITS && ((spiFrame >> (SPI_BITS - 1 - bit)) & 1);
+
+      hostsim_drive_pins(GPIOA, GPIO6, level);
+      spiDriven = true;
+   }
+   else if (spiDriven)
+   {
+      hostsim_release_pins(GPIOA, GPIO6);
+      spiDriven = false;
+   }
+}
+
+static void update_sensors(double t)
+{
+   double i[3];
+
+   phase_currents(i);
+   hostsim_set_analog(GPIOA, 5, clamp_adc(ADC_OFS + ilGain * i[0]));
+   hostsim_set_analog(GPIOB, 0, clamp_adc(ADC_OFS + ilGain * i[1]));
+
+   //AB encoder, TIM3 is configured for 4 edges per line. Channel A is high
+   //in the first half of each line so its rising edge is captured on channel 1.
+   //In reset mode TIM3 is connected to the single channel sensor instead
+   bool singleChannel = (TIM_SMCR(TIM3) & TIM_SMCR_SMS_MASK) == TIM_SMCR_SMS_RM;
+   uint32_t edges = hostsim_timer_period(TIM3) + 1;
+   int64_t edge = (int64_t)floor(theta / (2 * M_PI) * edges);
+
+   if (edges != edgesPerRev)
+      edgesPerRev = edges;
+   else while (edge != lastEdge)
+   {
+      int step = edge > lastEdge ? 1 : -1;
+
+      lastEdge += step;
+      hostsim_timer_count(TIM3, step);
+
+      if (!singleChannel && (lastEdge & 3) == (step > 0 ? 0 : 1))
+         hostsim_timer_capture(TIM3, TIM_IC1);
+   }
+   lastEdge = edge;
+
+   //Single channel sensor, rev1 captures it on channel 3
+   int64_t pulse = (int64_t)floor(theta / (2 * M_PI) * pulsesPerRev);
+
+   if (pulse != lastPulse && singleChannel)
+      hostsim_timer_capture(TIM3, strcmp(hostsim_board(), "rev1") == 0 ? TIM_IC3 : TIM_IC1);
+   lastPulse = pulse;
+
+   //North marker, one short pulse per mechanical turn
+   uint32_t port = north_port();
+   uint16_t pin = north_pin();
+   int64_t turn = (int64_t)floor(theta / (2 * M_PI));
+
+   if (is_output(port, pin))
+   {
+      bool level = (GPIO_ODR(port) & pin) != 0;
+
+      if (level != excLevel)
+      {
+         excLevel = level;
+         excToggle = t;
+      }
+      northHigh = false;
+   }
+   else if (turn != lastTurn)
+   {
+      hostsim_drive_pins(port, pin, true);
+      northHigh = true;
+   }
+   else if (northHigh)
+   {
+      hostsim_drive_pins(port, pin, false);
+      northHigh = false;
+   }
+   lastTurn = turn;
+
+   //Sin/cos sensor or resolver. The filtered resolver signal is in
+   //opposite phase to the exciting square wave and vanishes without it
+   double amp = resAmp;
+
+   if (resolver)
+   {
+      if (excToggle < 0 || t - excToggle > EXC_TIMEOUT)
+         amp = 0;
+      else if (excLevel)
+         amp = -amp;
+   }
+
+   double thetaSensor = resPolePairs * theta + eccErr1 * sin(theta) + eccErr2 * sin(2 * theta + 1);
+
+   spi_chip(port, pin, thetaSensor);
+
+   hostsim_set_analog(GPIOA, 6, clamp_adc(ADC_OFS + sinOfs + amp * sin(thetaSensor)));
+   hostsim_set_analog(GPIOA, 7, clamp_adc(ADC_OFS + cosOfs + cosGain * amp * cos(thetaSensor + cosPhase)));
+}
+
+/** Store the averages of the PWM period that just ended */
+static void record(double t)
+{
+   const struct motor_state *s = motor->state;
+   double rpm = omega * 60 / (2 * M_PI);
+   struct sample avg = { t, s->id, s->iq, s->torque, rpm, periodDriven };
+   double i[3];
+
+   if (avgTime > 0)
+   {
+      avg.id = avgId / avgTime;
+      avg.iq = avgIq / avgTime;
+      avg.torque = avgTorque / avgTime;
+   }
+   avgTime = avgId = avgIq = avgTorque = 0;
+   periodDriven = true;
+
+   if (numSamples == maxSamples)
+   {
+      maxSamples = maxSamples ? 2 * maxSamples : 65536;
+      samples = realloc(samples, maxSamples * sizeof(struct sample));
+   }
+   samples[numSamples++] = avg;
+
+   if (trace)
+   {
+      double arr = hostsim_timer_period(TIM1);
+      double angle = fmod(s->fluxAngle, 2 * M_PI) * 180 / M_PI;
+
+      phase_currents(i);
+      fprintf(trace, "%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.4f,%.4f,%.4f\n",
+              t, i[0], i[1], avg.id, avg.iq, avg.torque, rpm, angle < 0 ? angle + 360 : angle,
+              hostsim_timer_compare(TIM1, TIM_OC1) / arr,
+              hostsim_timer_compare(TIM1, TIM_OC2) / arr,
+              hostsim_timer_compare(TIM1, TIM_OC3) / arr);
+   }
+}
+
+/** Mean of iq over samples in [from, to) */
+static double mean_iq(double from, double to)
+{
+   double sum = 0;
+   int n = 0;
+
+   for (size_t k = 0; k < numSamples; k++)
+   {
+      if (samples[k].t >= from && samples[k].t < to)
+      {
+         sum += samples[k].iq;
+         n++;
+      }
+   }
+   return n > 0 ? sum / n : 0;
+}
+
+/** True if the power stage was switching in every period of [from, to) */
+static bool driven(double from, double to)
+{
+   int n = 0;
+
+   for (size_t k = 0; k < numSamples; k++)
+   {
+      if (samples[k].t >= from && samples[k].t < to)
+      {
+         if (!samples[k].driven) return false;
+         n++;
+      }
+   }
+   return n > 0;
+}
+
+static void print_step_response(double end)
+{
+   double before = mean_iq(torqueStepTime - STEP_BASE, torqueStepTime);
+   double after = mean_iq(tmeas, end);
+   double delta = after - before;
+   double t10 = -1, t90 = -1, settled = torqueStepTime, peak = 0;
+
+   //A step during the startup transient would give meaningless figures
+   if (!driven(torqueStepTime - STEP_BASE, torqueStepTime))
+   {
+      fprintf(stderr, "bench: no step response, the drive was not running during the %.0fms "
+                      "before tstep, choose a later tstep\n", STEP_BASE * 1000);
+      return;
+   }
+
+   if (fabs(delta) < 1) return;
+
+   for (size_t k = 0; k < numSamples; k++)
+   {
+      const struct sample *s = &samples[k];
+      double progress = (s->iq - before) / delta;
+
+      if (s->t < torqueStepTime) continue;
+      if (t10 < 0 && progress >= 0.1) t10 = s->t;
+      if (t90 < 0 && progress >= 0.9) t90 = s->t;
+      if (fabs(progress - 1) > STEP_BAND) settled = s->t;
+      peak = fmax(peak, progress - 1);
+   }
+
+   fprintf(stderr, "bench: iq step %.1fA -> %.1fA", before, after);
+
+   if (t10 >= 0 && t90 >= 0)
+   {
+      double rise = t90 - t10;
+      fprintf(stderr, ", rise time %.2fms (bandwidth ~%.0fHz)", rise * 1000, rise > 0 ? 0.35 / rise : 0);
+   }
+   fprintf(stderr, ", overshoot %.1f%%", peak * 100);
+
+   if (settled < samples[numSamples - 1].t)
+      fprintf(stderr, ", settling %.2fms\n", (settled - torqueStepTime) * 1000);
+   else
+      fprintf(stderr, ", not settled to %.0f%%\n", STEP_BAND * 100);
+}
+
+static void print_statistics(double end)
+{
+   double sum = 0, sumSq = 0, min = INFINITY, max = -INFINITY;
+   double idSum = 0, iqSum = 0, rpmSum = 0;
+   double isSum = 0, isMin = INFINITY, isMax = 0;
+   int n = 0;
+
+   for (size_t k = 0; k < numSamples; k++)
+   {
+      const struct sample *s = &samples[k];
+      double is = hypot(s->id, s->iq);
+
+      if (s->t < tmeas) continue;
+
+      sum += s->torque;
+      sumSq += s->torque * s->torque;
+      min = fmin(min, s->torque);
+      max = fmax(max, s->torque);
+      idSum += s->id;
+      iqSum += s->iq;
+      rpmSum += s->rpm;
+      //Oscillating current limiting shows up as a wide range of amplitudes
+      isSum += is;
+      isMin = fmin(isMin, is);
+      isMax = fmax(isMax, is);
+      n++;
+   }
+
+   if (n == 0) return;
+
+   double mean = sum / n;
+   double rms = sqrt(fmax(0, sumSq / n - mean * mean));
+
+   fprintf(stderr, "bench: %.3fs-%.3fs speed %.0frpm id %.2fA iq %.2fA torque %.3fNm "
+                   "ripple %.3fNm pk-pk %.3fNm rms (%.2f%%)\n",
+           tmeas, end, rpmSum / n, idSum / n, iqSum / n, mean,
+           max - min, rms, fabs(mean) > 1e-6 ? 100 * rms / fabs(mean) : 0);
+   fprintf(stderr, "bench: stator current amplitude %.2fA, min %.2fA max %.2fA\n",
+           isSum / n, isMin, isMax);
+
+   if (torqueStepTime < end)
+      print_step_response(end);
+}
+
+void hostsim_model_init(void)
+{
+   const char *type = getenv("HOSTSIM_MOTOR");
+
+   if (type == NULL) return;
+
+   for (size_t k = 0; k < sizeof(motors) / sizeof(motors[0]); k++)
+   {
+      size_t len = strlen(motors[k]->name);
+
+      if (strncmp(type, motors[k]->name, len) == 0 && (type[len] == ',' || type[len] == 0))
+         motor = motors[k];
+   }
+
+   if (motor == NULL)
+   {
+      fprintf(stderr, "hostsim: unknown motor type in HOSTSIM_MOTOR=%s\n", type);
+      exit(1);
+   }
+
+   udc = bench_param("udc", 400);
+   udcGain = bench_param("udcgain", 6.175);
+   ilGain = bench_param("ilgain", 4.7);
+   torqueRequest = bench_param("torque", 0);
+   torqueStepTime = bench_param("tstep", INFINITY);
+   torqueStep = bench_param("torque2", 0);
+   fixedRpm = bench_param("rpm", -1);
+   inertia = bench_param("j", 0.05);
+   friction = bench_param("b", 0.001);
+   load = bench_param("load", 0);
+   pulsesPerRev = bench_param("pulses", 60);
+   resPolePairs = bench_param("respp", 1);
+   resAmp = bench_param("resamp", 1500);
+   sinOfs = bench_param("sinofs", 0);
+   cosOfs = bench_param("cosofs", 0);
+   cosGain = bench_param("cosgain", 1);
+   cosPhase = bench_param("cosphase", 0) * M_PI / 180;
+   eccErr1 = bench_param("eccerr1", 0) * M_PI / 180;
+   eccErr2 = bench_param("eccerr2", 0) * M_PI / 180;
+   resolver = bench_param("resolver", 0) != 0;
+   tmeas = bench_param("tmeas", -1);
+   sequence = bench_param("swap", 0) != 0 ? -1 : 1;
+   open_trace();
+
+   motor->init();
+   theta = 0;
+   omega = bench_param("rpm0", 0) * 2 * M_PI / 60;
+
+   hostsim_set_max_step(SENSOR_STEP);
+   hostsim_set_analog(GPIOC, 3, clamp_adc(udc * udcGain));
+   hostsim_drive_pins(GPIOB, GPIO6, true); //start
+   update_sensors(0);
+}
+
+void hostsim_model_step(uint64_t now, uint32_t dt)
+{
+   double t = now / (double)HOSTSIM_CLOCK;
+
+   if (motor == NULL) return;
+
+   if (now >= nextCan)
+   {
+      send_torque_request(t);
+      nextCan = now + CAN_PERIOD;
+   }
+
+   if (t >= nextSample)
+   {
+      record(t);
+      nextSample = t + pwm_period();
+   }
+
+   run_plant(t, dt / (double)HOSTSIM_CLOCK);
+   update_sensors(t + dt / (double)HOSTSIM_CLOCK);
+}
+
+void hostsim_model_exit(void)
+{
+   double end = hostsim_time();
+
+   if (motor == NULL) return;
+
+   if (tmeas < 0)
+      tmeas = torqueStepTime < end ? (torqueStepTime + end) / 2 : end / 2;
+
+   print_statistics(end);
+
+   if (trace)
+      fclose(trace);
+   free(samples);
+}
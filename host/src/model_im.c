@@ -0,0 +1,99 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "model.h"
+
+/** Squirrel cage induction machine in the stator (alpha/beta) frame with
+ * stator current and rotor flux as state variables
+ *
+ * dpsir/dt = Lm/Tr is - psir/Tr + j we psir
+ * dis/dt   = (us - Rs is - Lm/Lr dpsir/dt) / (sigma Ls)
+ * T        = 3/2 p Lm/Lr (psira isb - psirb isa)
+ *
+ * with Ls = Lm + Lls, Lr = Lm + Llr, Tr = Lr/Rr and sigma = 1 - Lm²/(Ls Lr)
+ *
+ * Parameters (HOSTSIM_MOTOR=im,key=value,...):
+ *  - pp   pole pairs (2)
+ *  - rs   stator resistance in Ohm (0.05)
+ *  - rr   rotor resistance referred to the stator in Ohm (0.04)
+ *  - lm   magnetising inductance in H (0.01)
+ *  - lls  stator leakage inductance in H (0.0005)
+ *  - llr  rotor leakage inductance in H (0.0005)
+ */
+
+static double pp, rs, rr, lm, ls, lr, tr, sigmaLs;
+static double psiAlpha, psiBeta;
+static struct motor_state state;
+
+static void im_init(void)
+{
+   pp = model_motor_param("pp", 2);
+   rs = model_motor_param("rs", 0.05);
+   rr = model_motor_param("rr", 0.04);
+   lm = model_motor_param("lm", 0.01);
+   ls = lm + model_motor_param("lls", 0.0005);
+   lr = lm + model_motor_param("llr", 0.0005);
+   tr = lr / rr;
+   sigmaLs = (1 - lm * lm / (ls * lr)) * ls;
+   psiAlpha = psiBeta = 0;
+   state = (struct motor_state){ 0 };
+}
+
+static void im_step(double h, double ualpha, double ubeta, double theta, double omega)
+{
+   double we = pp * omega;
+   double ia = state.ialpha, ib = state.ibeta;
+   double dPsiAlpha = (lm * ia - psiAlpha) / tr - we * psiBeta;
+   double dPsiBeta = (lm * ib - psiBeta) / tr + we * psiAlpha;
+
+   state.ialpha = ia + h * (ualpha - rs * ia - lm / lr * dPsiAlpha) / sigmaLs;
+   state.ibeta = ib + h * (ubeta - rs * ib - lm / lr * dPsiBeta) / sigmaLs;
+   psiAlpha += h * dPsiAlpha;
+   psiBeta += h * dPsiBeta;
+   (void)theta;
+
+   //Rotor flux oriented currents
+   double psi = sqrt(psiAlpha * psiAlpha + psiBeta * psiBeta);
+   double cosine = psi > 0 ? psiAlpha / psi : 1;
+   double sine = psi > 0 ? psiBeta / psi : 0;
+
+   state.id = cosine * state.ialpha + sine * state.ibeta;
+   state.iq = cosine * state.ibeta - sine * state.ialpha;
+   state.torque = 1.5 * pp * lm / lr * (psiAlpha * state.ibeta - psiBeta * state.ialpha);
+   state.fluxAngle = atan2(psiBeta, psiAlpha);
+}
+
+/** With the stator open the rotor flux decays with the rotor time constant */
+static void im_open(double h, double omega)
+{
+   double we = pp * omega;
+   double dPsiAlpha = -psiAlpha / tr - we * psiBeta;
+   double dPsiBeta = -psiBeta / tr + we * psiAlpha;
+
+   psiAlpha += h * dPsiAlpha;
+   psiBeta += h * dPsiBeta;
+   state.ialpha = state.ibeta = 0;
+   state.id = state.iq = 0;
+   state.torque = 0;
+}
+
+const struct motor_model model_im =
+{
+   "im", im_init, im_step, im_open, &state
+};
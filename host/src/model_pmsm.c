@@ -0,0 +1,81 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include "model.h"
+
+/** Permanent magnet synchronous machine in the rotor (dq) frame
+ *
+ * ud = Rs id + Ld did/dt - we Lq iq
+ * uq = Rs iq + Lq diq/dt + we (Ld id + psi)
+ * T  = 3/2 p (psi iq + (Ld - Lq) id iq)
+ *
+ * Parameters (HOSTSIM_MOTOR=pmsm,key=value,...):
+ *  - pp   pole pairs (2)
+ *  - rs   stator resistance in Ohm (0.05)
+ *  - ld   d axis inductance in H (0.002)
+ *  - lq   q axis inductance in H (0.003)
+ *  - psi  permanent magnet flux linkage in Vs (0.09)
+ *  - ofs  electrical angle of the d axis at encoder position 0 in ° (0)
+ */
+
+static double pp, rs, ld, lq, psi, ofs;
+static struct motor_state state;
+
+static void pmsm_init(void)
+{
+   pp = model_motor_param("pp", 2);
+   rs = model_motor_param("rs", 0.05);
+   ld = model_motor_param("ld", 0.002);
+   lq = model_motor_param("lq", 0.003);
+   psi = model_motor_param("psi", 0.09);
+   ofs = model_motor_param("ofs", 0) * M_PI / 180;
+   state = (struct motor_state){ 0 };
+}
+
+static void pmsm_step(double h, double ualpha, double ubeta, double theta, double omega)
+{
+   double thetaEl = pp * theta + ofs;
+   double we = pp * omega;
+   double sine = sin(thetaEl);
+   double cosine = cos(thetaEl);
+   double ud = cosine * ualpha + sine * ubeta;
+   double uq = cosine * ubeta - sine * ualpha;
+   double id = state.id, iq = state.iq;
+
+   state.id = id + h * (ud - rs * id + we * lq * iq) / ld;
+   state.iq = iq + h * (uq - rs * iq - we * (ld * id + psi)) / lq;
+   state.ialpha = cosine * state.id - sine * state.iq;
+   state.ibeta = sine * state.id + cosine * state.iq;
+   state.torque = 1.5 * pp * (psi * state.iq + (ld - lq) * state.id * state.iq);
+   state.fluxAngle = thetaEl;
+}
+
+static void pmsm_open(double h, double omega)
+{
+   (void)h;
+   (void)omega;
+   state.id = state.iq = 0;
+   state.ialpha = state.ibeta = 0;
+   state.torque = 0;
+}
+
+const struct motor_model model_pmsm =
+{
+   "pmsm", pmsm_init, pmsm_step, pmsm_open, &state
+};
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include <stdint.h>
+
+/** \brief CPU load from the time the main loop spends idle
+ *
+ * At startup the idle loop runs with interrupts masked, so its speed can be
+ * measured against the 100 kHz scheduler timer. Afterwards every idle pass of
+ * the main loop is counted. The time that is missing from the idle count is
+ * load, whatever priority it ran at.
+ */
+class CpuLoad
+{
+   public:
+      /** \brief Measure the speed of the idle loop
+       * \pre Scheduler timer is set up and no scheduler task is added yet
+       */
+      static void Calibrate();
+
+      /** \brief Run the terminal and count idle passes, never returns */
+      static void Run();
+
+      /** \brief Compute the load since the last call and publish it with peak values
+       * \param pwmLoad load of the PWM interrupt in 0.1%
+       * \param taskLoad load of the scheduler tasks in 0.1%
+       */
+      static void Update(int pwmLoad, int taskLoad);
+
+      /** \brief Restart the peak values */
+      static void ResetPeaks();
+
+   private:
+      static void IdlePass();
+
+      static volatile uint32_t idleCount;
+      static uint32_t calibCount;
+      static uint32_t calibTicks;
+      static int peaks[3];
+};
+
+#endif // CPULOAD_H
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EMFOBSERVER_H
+#define EMFOBSERVER_H
+
+#include <stdint.h>
+#include "my_fp.h"
+
+/** \brief Rotor angle estimation from the back EMF of a synchronous motor
+ *
+ * The back EMF is integrated to the stator flux in the stationary frame using
+ * the voltage output since the last current sample and the measured current:
+ *
+ * psi = integral(u - Rs i) - Lq i
+ *
+ * Subtracting Lq i yields the "active flux" which is aligned with the d axis
+ * of the rotor for salient and non-salient machines. Its angle is the
+ * measurement the encoder module feeds into its angle tracking loop.
+ * The integrator leaks so that offsets cannot accumulate, the resulting phase
+ * lead is corrected. As the flux starts at zero the motor must be started from
+ * standstill with open loop rotation, catching a spinning motor isn't supported.
+ */
+class EmfObserver
+{
+   public:
+      /** \brief Set the machine model
+       * \param rs stator resistance in mOhm
+       * \param lq q axis inductance in mH
+       * \param fluxLinkage permanent magnet flux linkage in mWeber
+       */
+      static void SetMotorParameters(s32fp rs, s32fp lq, s32fp fluxLinkage);
+
+      /** \brief Set the electrical frequency below which the EMF is too small to be evaluated */
+      static void SetMinFrequency(s32fp frq);
+
+      /** \brief Set the calling frequency of Run() */
+      static void SetPwmFrequency(uint32_t frq);
+
+      /** \brief Clear flux and voltage history, e.g. because the outputs were disabled */
+      static void Reset();
+
+      /** \brief Estimate the rotor angle, called once per PWM cycle
+       * \param angle electrical angle of the frame id and iq were measured in
+       * \param advance angle ud and uq are applied ahead of angle
+       * \param frq signed electrical frequency in Hz
+       * \param id measured d current in A
+       * \param iq measured q current in A
+       * \param ud d voltage commanded for the next cycle in digits
+       * \param uq q voltage commanded for the next cycle in digits
+       * \param udc DC link voltage in V
+       */
+      static void Run(uint16_t angle, int16_t advance, s32fp frq, s32fp id, s32fp iq, int32_t ud, int32_t uq, s32fp udc);
+
+      /** \brief Electrical rotor angle at the time the currents were sampled */
+      static uint16_t GetAngle();
+
+      /** \brief true when the flux was large enough to calculate GetAngle() */
+      static bool IsValid();
+};
+
+#endif // EMFOBSERVER_H
@@ -22,5 +22,11 @@
    ERROR_MESSAGE_ENTRY(HIRESOFS, ERROR_DISPLAY) \
    ERROR_MESSAGE_ENTRY(LORESAMP, ERROR_DISPLAY) \
    ERROR_MESSAGE_ENTRY(TMPMMAX, ERROR_DERATE) \
+   ERROR_MESSAGE_ENTRY(SPIPARITY, ERROR_DISPLAY) \
+   ERROR_MESSAGE_ENTRY(RESDOS, ERROR_DISPLAY) \
+   ERROR_MESSAGE_ENTRY(RESLOT, ERROR_DISPLAY) \
+   ERROR_MESSAGE_ENTRY(WRONGIMAGE, ERROR_STOP) \
+   ERROR_MESSAGE_ENTRY(TASKOVERRUN, ERROR_DISPLAY) \
+   ERROR_MESSAGE_ENTRY(PWMSTALL, ERROR_STOP) \
 
 #endif // ERRORMESSAGE_PRJ_H_INCLUDED
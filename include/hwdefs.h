@@ -28,33 +28,57 @@
 #define TERM_USART_TXPIN   GPIO_USART3_TX
 #define TERM_USART_TXPORT  GPIOB
 #define TERM_USART_DMARX   DMA_CHANNEL3
-#define TERM_USART_DMATX   DMA_CHANNEL2 //this means we can not use it on rev1 hardware (TIM3_CH3)
+#define TERM_USART_DMATX   DMA_CHANNEL2 //shared with TIM3_CH3, so the encoder polls that channel on rev1 hardware
 #define TERM_USART_DR      USART3_DR
 #define TERM_BUFSIZE       128
-#define UARTDMABLOCKED //enables special code for Rev1 boards
 //Address of parameter block in flash
 #define FLASH_PAGE_SIZE 1024
 #define PARAM_ADDRESS 0x0801FC00
 #define PARAM_BLKSIZE FLASH_PAGE_SIZE
 #define CANMAP_ADDRESS 0x0801F800
+#define ANGLECOMP_ADDRESS 0x0801F000 //Below the bootloader pin init page
 
 #define REV_CNT_IC         hwRev == HW_REV1 ? TIM_IC3 : TIM_IC1
 #define REV_CNT_OC         hwRev == HW_REV1 ? TIM_OC3 : TIM_OC1
 #define REV_CNT_CCR        hwRev == HW_REV1 ? TIM3_CCR3 : TIM3_CCR1
-#define REV_CNT_CCR_PTR    hwRev == HW_REV1 ? (uint32_t)&TIM3_CCR3 : (uint32_t)&TIM3_CCR1
+#define REV_CNT_CCR_PTR    hwRev == HW_REV1 ? (uintptr_t)&TIM3_CCR3 : (uintptr_t)&TIM3_CCR1
 #define REV_CNT_SR         hwRev == HW_REV1 ? TIM_SR_CC3IF : TIM_SR_CC1IF
-#define REV_CNT_DMAEN      hwRev == HW_REV1 ? TIM_DIER_CC3DE : TIM_DIER_CC1DE
-#define REV_CNT_DMACHAN    hwRev == HW_REV1 ? DMA_CHANNEL2 : DMA_CHANNEL6
+//Capture DMA of channel 1, not used on rev1
+#define REV_CNT_DMAEN      TIM_DIER_CC1DE
+#define REV_CNT_DMACHAN    DMA_CHANNEL6
+#define REV_CNT_DMA_IRQ    NVIC_DMA1_CHANNEL6_IRQ
+#define rev_dma_isr        dma1_channel6_isr
+//In AB/ABZ mode edges of channel 1 are time stamped with the scheduler timer
+#define SCHED_TIMER        hwRev == HW_BLUEPILL ? TIM4 : TIM2
+#define SCHED_TIMER_FRQ    100000
 
 #define NORTH_EXC_PORT     hwRev == HW_BLUEPILL ? GPIOC : GPIOD
 #define NORTH_EXC_PIN      hwRev == HW_BLUEPILL ? GPIO14 : GPIO2
 #define NORTH_EXC_EXTI     hwRev == HW_BLUEPILL ? EXTI14 : EXTI2
+//Velocity register select of the AD2S chip in SPI mode, rev_in terminal (no bluepill)
+#define SPI_RDVEL_PORT     GPIOC
+#define SPI_RDVEL_PIN      GPIO6
+
+//Phase currents are converted by ADC2 on the PWM timer update event and the end
+//of that conversion runs the control step. Revisions without their bit read them
+//from the regular ADC1 scan in the timer update interrupt instead
+#define CUR_SYNC_REVS      ((1 << HW_REV1) | (1 << HW_REV2) | (1 << HW_REV3) | (1 << HW_TESLA) | \
+                            (1 << HW_TESLAM3) | (1 << HW_BLUEPILL) | (1 << HW_PRIUS))
+#define CUR_SYNC           ((CUR_SYNC_REVS >> hwRev) & 1)
+#define CUR_SYNC_ADC       ADC2
+#define CUR_SYNC_IRQ       NVIC_ADC1_2_IRQ
+#define cur_sync_isr       adc1_2_isr
 
 typedef enum
 {
    HW_REV1, HW_REV2, HW_REV3, HW_TESLA, HW_TESLAM3, HW_BLUEPILL, HW_PRIUS
 } HWREV;
 
+#ifdef HWREV_FIXED
+//Image built for one variant, the compiler removes the code of all others
+#define hwRev ((HWREV)HWREV_FIXED)
+#else
 extern HWREV hwRev;
+#endif
 
 #endif // HWDEFS_H_INCLUDED
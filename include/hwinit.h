@@ -33,6 +33,7 @@ void usart_setup(void);
 void nvic_setup(void);
 void rtc_setup(void);
 void tim_setup(void);
+void current_adc_setup(uint8_t il1Channel, uint8_t il2Channel);
 HWREV detect_hw(void);
 void write_bootloader_pininit();
 
@@ -4,17 +4,104 @@
 #include <stdint.h>
 #include "my_fp.h"
 
+#define PLL_DIGITS        16
+#define TWO_PI_PLL        411775 //2 Pi with PLL_DIGITS fractional digits
+
 class Encoder
 {
 public:
    enum mode
    {
-      SINGLE, AB, ABZ, SPI, RESOLVER, SINCOS, INVALID
+      SINGLE, AB, ABZ, SPI, RESOLVER, SINCOS, SENSORLESS, INVALID
+   };
+
+   enum anglecomp
+   {
+      COMP_OFF, COMP_ON, COMP_LEARN
+   };
+
+   /** Converts counter values to angles by multiplication and shift */
+   struct CountScale
+   {
+      uint32_t factor; //0 when counts per turn is a power of two and shifting is sufficient
+      uint32_t shift;
    };
 
+   /** Calculate the scale for a counter with the given number of counts per turn.
+    * ScaleCount() then returns count * 65536 / counts for every count < counts.
+    * Exact for multiples of 4 up to 32768, i.e. quadrature encoders with up to 8192 ppr.
+    */
+   static CountScale CalcCountScale(uint32_t counts)
+   {
+      CountScale scale = { 0, 0 };
+
+      if (counts == 0) return scale;
+
+      uint32_t log2 = 31 - __builtin_clz(counts);
+
+      if (counts == (1u << log2))
+      {
+         scale.shift = 16 - log2;
+      }
+      else
+      {
+         //Rounding up the reciprocal and 15 extra digits keep the error below one count
+         scale.factor = ((1ull << (31 + log2)) + counts - 1) / counts;
+         scale.shift = 15 + log2;
+      }
+      return scale;
+   }
+
+   static uint16_t ScaleCount(const CountScale& scale, uint32_t count)
+   {
+      if (scale.factor == 0) return count << scale.shift;
+      return ((uint64_t)count * scale.factor) >> scale.shift;
+   }
+
+   /** Gains of the angle tracking loop with PLL_DIGITS fractional digits */
+   struct PllGains
+   {
+      int32_t kp;
+      int32_t ki;
+   };
+
+   /** Critically damped loop: kp = 2 omega T, ki = (omega T)^2.
+    * omega T is limited to 0.5, beyond that the discrete loop loses its damping
+    * and kp times an angle error of half a turn no longer fits 32 bits.
+    * @param bandwidth natural frequency in Hz
+    * @param pwmFrq frequency the loop is run at in Hz
+    */
+   static PllGains CalcPllGains(int bandwidth, uint32_t pwmFrq)
+   {
+      PllGains gains;
+      int32_t omegaT = (TWO_PI_PLL * bandwidth) / pwmFrq;
+
+      if (omegaT > (1 << (PLL_DIGITS - 1)))
+         omegaT = 1 << (PLL_DIGITS - 1);
+
+      gains.kp = 2 * omegaT;
+      gains.ki = ((int64_t)omegaT * omegaT) >> PLL_DIGITS;
+      return gains;
+   }
+
+   /** Advance the angle tracking loop by one cycle
+    * @param[in,out] angle loop angle with PLL_DIGITS fractional digits
+    * @param[in,out] speed angle increment per cycle with PLL_DIGITS fractional digits
+    * @param gains gains calculated by CalcPllGains()
+    * @param measuredAngle sensor angle of this cycle
+    */
+   static void StepPll(uint32_t& angle, int32_t& speed, const PllGains& gains, uint16_t measuredAngle)
+   {
+      angle += speed;
+      int32_t err = (int16_t)(measuredAngle - (angle >> PLL_DIGITS));
+      speed += err * gains.ki;
+      angle += err * gains.kp;
+   }
+
    static void Reset();
    static void SetMode(enum mode encMode);
    static bool SeenNorthSignal();
+   static bool IsSensorless();
    static void UpdateRotorAngle();
    static void UpdateRotorFrequency(int callingFrequency);
    static void SetPwmFrequency(uint32_t frq);
@@ -24,18 +111,36 @@ public:
    static u32fp GetRotorFrequency();
    static int GetRotorDirection();
    static void SetImpulsesPerTurn(uint16_t imp);
+   static void SetPllBandwidth(int bandwidth);
+   static void SetCalibration(s32fp sinOfs, s32fp cosOfs, s32fp gain, s32fp quadrature, bool learn);
+   static void UpdateCalibration();
+   static void SetAngleCompensation(enum anglecomp comp);
+   static void UpdateAngleCompensation();
+   static void SaveAngleCompensation();
+   static bool LoadAngleCompensation();
    static void SwapSinCos(bool swap);
+   static void SetSpiVelocity(bool velocity);
+   static void SetHandoverFrequency(u32fp frq);
 
 private:
    static void UpdateTurns(uint16_t angle, uint16_t lastAngle);
+   static uint16_t GetAngleAB();
+   static uint16_t TrackAngle(uint16_t measuredAngle);
+   static void UpdatePllGains();
+   static void LearnCalibration(uint16_t angle);
+   static uint16_t CompensateAngle(uint16_t rawAngle);
+   static void LearnAngleError(uint16_t rawAngle);
    static void InitTimerSingleChannelMode();
    static void InitTimerABZMode();
    static void InitSPIMode();
    static void InitResolverMode();
+   static void InitSensorlessMode();
    static uint16_t GetAngleSPI();
+   static bool DecodeFrameSPI(uint16_t frame, bool velocity);
    static uint16_t GetAngleResolver();
    static uint16_t GetAngleSinCos();
    static uint16_t DecodeAngle(bool invert);
+   static int PollPulseTime();
    static int GetPulseTimeFiltered();
    static void GetMinMaxTime(int& min, int& max);
 };
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ISRBENCH_H
+#define ISRBENCH_H
+
+#include <stdint.h>
+#include <libopencm3/cm3/dwt.h>
+
+/** \brief Cycle counting micro benchmark of the PWM interrupt kernels
+ *
+ * Uses the DWT cycle counter. In the host build the counter is the host
+ * time stamp counter, so the figures only compare kernels with each other.
+ */
+class IsrBench
+{
+   public:
+      struct Stats
+      {
+         uint32_t min;
+         uint32_t max;
+         uint32_t count;
+         uint64_t sum;
+
+         void Reset();
+         void Add(uint32_t cycles);
+         uint32_t Mean() const { return count > 0 ? sum / count : 0; }
+      };
+
+      /** \brief Enable the cycle counter */
+      static void Init();
+
+      /** \brief Current value of the free running cycle counter */
+      static uint32_t Cycles() { return dwt_read_cycle_counter(); }
+
+      /** \brief Account one run of PwmGeneration::Run(), called from the PWM ISR
+       * \param cycles execution time in cycles
+       */
+      static void RecordPwmRun(uint32_t cycles) { pwmRun.Add(cycles); }
+
+      /** \brief Account one run of Encoder::UpdateRotorAngle(), called from the PWM ISR
+       * \param cycles execution time in cycles
+       */
+      static void RecordEncoder(uint32_t cycles) { encoder.Add(cycles); }
+
+      /** \brief Measure each kernel in isolation and print min/mean/max cycles.
+       * Also prints the statistics of PwmGeneration::Run() and
+       * Encoder::UpdateRotorAngle() since the last call.
+       * \param iterations number of calls per kernel
+       */
+      static void Run(int iterations);
+
+   private:
+      static void PrintStats(const char* name, const Stats& stats);
+
+      static Stats pwmRun;
+      static Stats encoder;
+};
+
+#endif // ISRBENCH_H
@@ -24,14 +24,22 @@
    2. Temporary parameters (id = 0)
    3. Display values
  */
-//Next param id (increase when adding new parameter!): 128
-//Next value Id: 2048
+//Next param id (increase when adding new parameter!): 143
+//Next value Id: 2058
 /*              category     name         unit       min     max     default id */
 
 #define MOTOR_PARAMETERS_COMMON \
     PARAM_ENTRY(CAT_MOTOR,   polepairs,   "",        1,      16,     2,      32  ) \
     PARAM_ENTRY(CAT_MOTOR,   respolepairs,"",        1,      16,     1,      93  ) \
-    PARAM_ENTRY(CAT_MOTOR,   encmode,     ENCMODES,  0,      5,      0,      75  ) \
+    PARAM_ENTRY(CAT_MOTOR,   pllbw,       "Hz",      10,     1000,   300,    133 ) \
+    PARAM_ENTRY(CAT_MOTOR,   rescal,      ONOFF,     0,      1,      0,      134 ) \
+    PARAM_ENTRY(CAT_MOTOR,   ressinofs,   "dig",     -1000,  1000,   0,      135 ) \
+    PARAM_ENTRY(CAT_MOTOR,   rescosofs,   "dig",     -1000,  1000,   0,      136 ) \
+    PARAM_ENTRY(CAT_MOTOR,   rescosgain,  "%",       50,     200,    100,    137 ) \
+    PARAM_ENTRY(CAT_MOTOR,   resquad,     "mrad",    -500,   500,    0,      138 ) \
+    PARAM_ENTRY(CAT_MOTOR,   angcomp,     ANGCOMPS,  0,      2,      0,      139 ) \
+    PARAM_ENTRY(CAT_MOTOR,   spivel,      ONOFF,     0,      1,      0,      140 ) \
+    PARAM_ENTRY(CAT_MOTOR,   encmode,     ENCMODES,  0,      ENCMODEMAX, 0,     75  ) \
     PARAM_ENTRY(CAT_MOTOR,   fmax,        "Hz",      21,     1000,   200,    9   ) \
     PARAM_ENTRY(CAT_MOTOR,   numimp,      "ppr",     8,      8192,   60,     15  ) \
     PARAM_ENTRY(CAT_MOTOR,   dirchrpm,    "rpm",     0,      20000,  100,    87  ) \
@@ -53,7 +61,13 @@
     PARAM_ENTRY(CAT_MOTOR,   curkifrqgain,"dig/Hz",  0,      1000,   50,     120 ) \
     PARAM_ENTRY(CAT_MOTOR,   fwkp,        "",        -10000, 0,      -100,   118 ) \
     PARAM_ENTRY(CAT_MOTOR,   dmargin,     "Hz",      -10000, 0,      -2000,  113 ) \
-    PARAM_ENTRY(CAT_MOTOR,   syncofs,     "dig",     0,      65535,  0,      70  )
+    PARAM_ENTRY(CAT_MOTOR,   syncofs,     "dig",     0,      65535,  0,      70  ) \
+    PARAM_ENTRY(CAT_MOTOR,   modadvance,  "period",  0,      2,      0.5,    128 ) \
+    PARAM_ENTRY(CAT_MOTOR,   fluxlinkage, "mWeber",  0,      1000,   90,     129 ) \
+    PARAM_ENTRY(CAT_MOTOR,   ld,          "mH",      0,      1000,   2,      130 ) \
+    PARAM_ENTRY(CAT_MOTOR,   lq,          "mH",      0,      1000,   3.45,   131 ) \
+    PARAM_ENTRY(CAT_MOTOR,   rs,          "mOhm",    0,      10000,  50,     141 ) \
+    PARAM_ENTRY(CAT_MOTOR,   sensfrq,     "Hz",      1,      100,    10,     142 )
 
 #define INVERTER_PARAMETERS_COMMON \
     PARAM_ENTRY(CAT_INVERTER,pwmfrq,      PWMFRQS,   0,      2,      1,      13  ) \
@@ -135,6 +149,7 @@
     PARAM_ENTRY(CAT_PWM,     pwmofs,      "dig",     -65535, 65535,  0,      41  ) \
     PARAM_ENTRY(CAT_COMM,    canspeed,    CANSPEEDS, 0,      3,      1,      83  ) \
     PARAM_ENTRY(CAT_COMM,    canperiod,   CANPERIODS,0,      1,      0,      88  ) \
+    PARAM_ENTRY(CAT_COMM,    tlmperiod,   "ms",      10,     1000,   10,     132 ) \
 
 #define VALUE_BLOCK1 \
     VALUE_ENTRY(version,     VERSTR,  2039 ) \
@@ -173,7 +188,17 @@
     VALUE_ENTRY(din_ocur,    OKERR,   2030 ) \
     VALUE_ENTRY(din_desat,   OKERR,   2031 ) \
     VALUE_ENTRY(din_bms,     ONOFF,   2032 ) \
-    VALUE_ENTRY(cpuload,     "%",     2035 )
+    VALUE_ENTRY(cpuload,     "%",     2035 ) \
+    VALUE_ENTRY(cpuloadmax,  "%",     2053 ) \
+    VALUE_ENTRY(pwmload,     "%",     2054 ) \
+    VALUE_ENTRY(pwmloadmax,  "%",     2055 ) \
+    VALUE_ENTRY(tskload,     "%",     2056 ) \
+    VALUE_ENTRY(tskloadmax,  "%",     2057 ) \
+    VALUE_ENTRY(ms1max,      "us",    2048 ) \
+    VALUE_ENTRY(ms10max,     "us",    2049 ) \
+    VALUE_ENTRY(ms100max,    "us",    2050 ) \
+    VALUE_ENTRY(tskjitter,   "us",    2051 ) \
+    VALUE_ENTRY(tskmissed,   "",      2052 )
 
 #define VALUES_SINE \
     VALUE_ENTRY(ilmax,       "A",     2005 ) \
@@ -244,14 +269,21 @@
 #define ONOFF        "0=Off, 1=On, 2=na"
 #define OKERR        "0=Error, 1=Ok, 2=na"
 #define CHARGEMODS   "0=Off, 3=Boost, 4=Buck"
+#if CONTROL == CTRL_FOC
+#define ENCMODES     "0=Single, 1=AB, 2=ABZ, 3=SPI, 4=Resolver, 5=SinCos, 6=Sensorless"
+#define ENCMODEMAX   6
+#else
 #define ENCMODES     "0=Single, 1=AB, 2=ABZ, 3=SPI, 4=Resolver, 5=SinCos"
+#define ENCMODEMAX   5
+#endif // CONTROL
+#define ANGCOMPS     "0=Off, 1=On, 2=Learn"
 #define POTMODES     "0=SingleRegen, 1=DualChannel, 2=CAN"
 #define CANSPEEDS    "0=250k, 1=500k, 2=800k, 3=1M"
 #define CANIOS       "1=Cruise, 2=Start, 4=Brake, 8=Fwd, 16=Rev, 32=Bms"
 #define CANPERIODS   "0=100ms, 1=10ms"
 #define HWREVS       "0=Rev1, 1=Rev2, 2=Rev3, 3=Tesla, 4=TeslaM3, 5=BluePill, 6=Prius"
 #define SWAPS        "0=None, 1=Currents12, 2=SinCos, 4=PWMOutput13, 8=PWMOutput23"
-#define STATUS       "0=None, 1=UdcLow, 2=UdcHigh, 4=UdcBelowUdcSw, 8=UdcLim, 16=EmcyStop, 32=MProt, 64=PotPressed, 128=TmpHs, 256=WaitStart"
+#define STATUS       "0=None, 1=UdcLow, 2=UdcHigh, 4=UdcBelowUdcSw, 8=UdcLim, 16=EmcyStop, 32=MProt, 64=PotPressed, 128=TmpHs, 256=WaitStart, 512=WrongImage"
 #define CAT_MOTOR    "Motor"
 #define CAT_INVERTER "Inverter"
 #define CAT_THROTTLE "Throttle"
@@ -362,7 +394,8 @@ enum status
    STAT_MPROT = 32,
    STAT_POTPRESSED = 64,
    STAT_TMPHS = 128,
-   STAT_WAITSTART = 256
+   STAT_WAITSTART = 256,
+   STAT_WRONGIMAGE = 512
 };
 
 //Generated enum-string for possible errors
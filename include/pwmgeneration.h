@@ -37,12 +37,38 @@ class PwmGeneration
       static void SetCurrentLimitThreshold(s32fp ocurlim);
       static void SetControllerGains(int kp, int ki, int fwkp);
       static int GetCpuLoad();
+      static bool ControlStalled();
       static void SetChargeCurrent(s32fp cur);
       static void SetPolePairRatio(int ratio) { polePairRatio = ratio; }
+      static void PublishConfig();
+      static void SetUdc(s32fp udc);
+      static void SampleCurrents();
 
    private:
       enum EdgeType { NoEdge, PosEdge, NegEdge };
 
+      /** Parameters read by the PWM interrupt, copied from the parameter table by PublishConfig() */
+      struct Config
+      {
+         s32fp il1gain;
+         s32fp il2gain;
+         int chargeflt;
+         s32fp udc;
+#if CONTROL == CTRL_FOC
+         bool swapCurrents;
+         int curkifrqgain;
+         s32fp modadvance;
+         s32fp manualid;
+         s32fp manualiq;
+         uint16_t syncofs;
+#elif CONTROL == CTRL_SINE
+         s32fp fslipmin;
+         s32fp iacmax;
+         int ifltrise;
+         int ifltfall;
+#endif
+      };
+
       static void PwmInit();
       static void EnableOutput();
       static void DisableOutput();
@@ -56,7 +82,7 @@ class PwmGeneration
       static void Charge();
       static void AcHeat();
       static s32fp GetIlMax(s32fp il1, s32fp il2);
-      static s32fp GetCurrent(AnaIn& input, s32fp offset, s32fp gain);
+      static s32fp GetCurrent(int phase, s32fp gain);
       static s32fp LimitCurrent();
       static EdgeType CalcRms(s32fp il, EdgeType& lastEdge, s32fp& max, s32fp& rms, int& samples, s32fp prevRms);
 
@@ -69,7 +95,10 @@ class PwmGeneration
       static uint8_t shiftForTimer;
       static int opmode;
       static s32fp ilofs[2];
+      static int ilSamples[2]; //!< Raw phase current samples of the current PWM cycle
       static int polePairRatio;
+      static Config configBuffers[2];
+      static const Config* config; //!< Buffer the PWM interrupt reads, the other one is written
 };
 
 #endif // PWMGENERATION_H
@@ -0,0 +1,115 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "params.h"
+
+/* Display values produced by the PWM interrupt
+ * name must match a value in param_prj.h
+ * reduction: how the samples of one publishing period are combined
+ * format: FLT fixed point, INT integer, ANGLE 16-bit angle converted to degrees */
+#define TELEMETRY_COMMON \
+   TELEMETRY_ENTRY(fstat,  LAST,  FLT   ) \
+   TELEMETRY_ENTRY(angle,  LAST,  ANGLE ) \
+   TELEMETRY_ENTRY(amp,    LAST,  INT   ) \
+   TELEMETRY_ENTRY(idc,    AVG,   FLT   ) \
+   TELEMETRY_ENTRY(il1,    LAST,  FLT   ) \
+   TELEMETRY_ENTRY(il2,    LAST,  FLT   )
+
+#define TELEMETRY_FOC \
+   TELEMETRY_ENTRY(id,     AVG,   FLT   ) \
+   TELEMETRY_ENTRY(iq,     AVG,   FLT   ) \
+   TELEMETRY_ENTRY(ud,     AVG,   INT   ) \
+   TELEMETRY_ENTRY(uq,     AVG,   INT   )
+
+#define TELEMETRY_SINE \
+   TELEMETRY_ENTRY(ilmax,  MAX,   FLT   )
+
+#if CONTROL == CTRL_FOC
+#define TELEMETRY_LIST TELEMETRY_COMMON TELEMETRY_FOC
+#elif CONTROL == CTRL_SINE
+#define TELEMETRY_LIST TELEMETRY_COMMON TELEMETRY_SINE
+#endif
+
+/** \brief Decimated publishing of interrupt values to the parameter table
+ *
+ * The PWM interrupt adds one sample per channel and cycle. Every publishing
+ * period Publish() swaps the accumulator set the interrupt writes to and
+ * stores the reduced values of the other set in the parameter table.
+ */
+class Telemetry
+{
+   public:
+      enum Reduction { LAST, AVG, MIN, MAX };
+      enum Format { FLT, INT, ANGLE };
+
+      enum Channel
+      {
+         #define TELEMETRY_ENTRY(name, reduction, format) name,
+         TELEMETRY_LIST
+         #undef TELEMETRY_ENTRY
+         CHANNEL_COUNT
+      };
+
+      /** \brief Add a sample, call from the PWM interrupt
+       * \param channel display value
+       * \param value sample in the format given in TELEMETRY_LIST
+       */
+      static void Add(Channel channel, int32_t value)
+      {
+         Accumulator& a = acc[active][channel];
+
+         switch (reductions[channel])
+         {
+            case LAST: a.value = value; break;
+            case AVG: a.sum += value; break;
+            case MIN: a.value = a.count == 0 || value < a.value ? value : a.value; break;
+            case MAX: a.value = a.count == 0 || value > a.value ? value : a.value; break;
+         }
+         a.count++;
+      }
+
+      /** \brief Publish once every period, call from the 10 ms task
+       * \param period publishing period in 10 ms ticks
+       */
+      static void Publish(int period);
+
+   private:
+      struct Accumulator
+      {
+         int32_t value;
+         int32_t count;
+         int64_t sum;
+      };
+
+      static constexpr Reduction reductions[CHANNEL_COUNT] =
+      {
+         #define TELEMETRY_ENTRY(name, reduction, format) reduction,
+         TELEMETRY_LIST
+         #undef TELEMETRY_ENTRY
+      };
+
+      static Accumulator acc[2][CHANNEL_COUNT];
+      static volatile int active; //!< set the interrupt adds to
+      static int ticks;
+};
+
+#endif // TELEMETRY_H
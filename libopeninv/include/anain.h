@@ -28,6 +28,7 @@ public:
    void Configure(uint32_t port, uint8_t pin);
    uint16_t Get();
    uint16_t GetIndex() { return firstValue - values; }
+   uint8_t GetChannel() { return channel_array[GetIndex()]; }
 
 private:
    static uint16_t values[];
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DEFERREDWORK_H
+#define DEFERREDWORK_H
+#include <stdint.h>
+#include "errormessage.h"
+#include "params.h"
+#include "spscqueue.h"
+
+#define DEFERRED_QUEUE_LEN 16
+#define ERROR_WORDS ((ERROR_MESSAGE_LAST + 31) / 32)
+#define PARAM_WORDS ((Param::PARAM_LAST + 31) / 32)
+
+/** @brief Moves work out of interrupts into the scheduler.
+ *
+ * Each interrupt priority that produces work has its own single-producer
+ * single-consumer queue, so posting never blocks or disables interrupts.
+ * Interrupts of equal priority cannot preempt each other and may share a
+ * queue. Drain() runs the queued work and must always be called from the
+ * same context, which must not produce into a queue itself.
+ * Errors and parameter values don't go through the queues but set a pending
+ * flag, so an error raised on every PWM cycle or a burst of CAN frames costs
+ * no queue space and can't crowd out other work. Only the latest value of a
+ * parameter is applied.
+ */
+class DeferredWork
+{
+   public:
+      /** Producer contexts, in order of falling priority */
+      enum queue
+      {
+         FAULT,  //!< Break, encoder edge and DMA interrupts
+         PWM,    //!< PWM interrupt, including the encoder angle update
+         CAN,    //!< CAN receive interrupts
+         MAIN,   //!< Terminal in the main loop
+         QUEUE_LAST
+      };
+
+      /** @brief Post an error message from the draining context
+       * Posting the same error again before it was drained has no effect.
+       */
+      static void PostError(queue q, ERROR_MESSAGE_NUM err);
+
+      /** @brief Set a parameter incl. range check and parm_Change() from the draining context
+       * Setting it again before it was drained replaces the value. Pending values are
+       * applied before the queued calls of the same producer.
+       */
+      static void SetParam(queue q, Param::PARAM_NUM param, s32fp value);
+
+      /** @brief Call a function from the draining context
+       * @return false if the queue was full
+       */
+      static bool Call(queue q, void (*function)(int), int arg);
+
+      /** @brief Run all queued work, highest priority queue first */
+      static void Drain();
+
+      /** @brief Return number of items that were dropped because a queue was full */
+      static uint32_t GetDropped() { return dropped; }
+
+   private:
+      struct Item
+      {
+         void (*function)(int);
+         int32_t arg;
+      };
+
+      static bool Put(const Item& item, queue q);
+
+      static SpscQueue<Item, DEFERRED_QUEUE_LEN> queues[QUEUE_LAST];
+      static volatile uint32_t dropped;
+      //An error is pending while its bits differ, each side only toggles its own
+      static volatile uint32_t errRaised[QUEUE_LAST][ERROR_WORDS];
+      static volatile uint32_t errHandled[QUEUE_LAST][ERROR_WORDS];
+      //Same scheme for parameters, the value slot is shared by all producers
+      static volatile uint32_t paramRaised[QUEUE_LAST][PARAM_WORDS];
+      static volatile uint32_t paramHandled[QUEUE_LAST][PARAM_WORDS];
+      static volatile s32fp paramValues[Param::PARAM_LAST];
+};
+
+#endif // DEFERREDWORK_H
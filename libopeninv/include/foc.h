@@ -4,13 +4,20 @@
 #include <stdint.h>
 #include "my_fp.h"
 
+#define MTPA_POINTS    33
+#define MTPA_MAX_SHIFT 6
+
 class FOC
 {
    public:
-      static void ParkClarke(s32fp il1, s32fp il2, uint16_t angle);
+      static void SetAngle(uint16_t angle, int16_t advance = 0);
+      static void ParkClarke(s32fp il1, s32fp il2);
+      static void ParkClarke(s32fp il1, s32fp il2, uint16_t angle) { SetAngle(angle); ParkClarke(il1, il2); }
       static int32_t GetQLimit(int32_t maxVd);
       static int32_t GetTotalVoltage(int32_t ud, int32_t uq);
-      static void InvParkClarke(int32_t ud, int32_t uq, uint16_t angle);
+      static void InvParkClarke(int32_t ud, int32_t uq);
+      static void InvParkClarke(int32_t ud, int32_t uq, uint16_t angle) { SetAngle(angle); InvParkClarke(ud, uq); }
+      static void SetMotorParameters(s32fp fluxLinkage, s32fp ld, s32fp lq, int32_t maxCurrent);
       static void Mtpa(int32_t is, int32_t& idref, int32_t& iqref);
       static int32_t GetMaximumModulationIndex();
       static s32fp id;
@@ -19,6 +26,11 @@ class FOC
 
    protected:
    private:
+      static s32fp sin, cos;        //!< of the angle the currents were sampled at
+      static s32fp sinMod, cosMod;  //!< of the angle the voltage is applied at
+      static int32_t mtpaId[MTPA_POINTS]; //!< id for is = i << mtpaShift
+      static int32_t mtpaIq[MTPA_POINTS]; //!< iq for is = i << mtpaShift
+      static int mtpaShift;
       static uint32_t sqrt(uint32_t rad);
       static u32fp fpsqrt(u32fp rad);
 };
@@ -37,6 +37,8 @@ extern "C"
 char* fp_itoa(char * buf, s32fp a);
 s32fp fp_atoi(const char *str);
 u32fp fp_sqrt(u32fp rad);
+u32fp fp_sqrt_digits(u32fp rad, int digits);
+uint32_t fp_isqrt(uint32_t rad);
 s32fp fp_ln(unsigned int x);
 
 #ifdef __cplusplus
@@ -22,6 +22,16 @@
 #include "my_fp.h"
 #include "my_math.h"
 
+/** Integral gain fractional digits, ki / frequency is stored with this resolution */
+#define PI_KI_DIGITS 16
+
+/** PI controller without divisions in Run()
+ *
+ * The integrator holds the integral term (esum * ki / frequency) instead of
+ * the plain error sum. ki / frequency is precomputed from a reciprocal of the
+ * calling frequency, so changing ki every cycle for gain scheduling costs
+ * one multiply and the integral term stays continuous when it does.
+ */
 class PiController
 {
    public:
@@ -35,11 +45,19 @@ class PiController
       void SetGains(int kp, int ki)
       {
          this->kp = kp;
-         this->ki = ki;
+         SetIntegralGain(ki);
       }
 
       void SetProportionalGain(int kp) { this->kp = kp; }
-      void SetIntegralGain(int ki) { this->ki = ki; }
+
+      /** Set integral gain, cheap enough to be called every cycle
+       * \pre ki / frequency < 32768
+       */
+      void SetIntegralGain(int ki)
+      {
+         this->ki = ki;
+         kiScaled = ((int64_t)ki * frqRecip) >> (32 - PI_KI_DIGITS);
+      }
 
       /** Set regulator target set point
        * \param val regulator target
@@ -57,7 +75,7 @@ class PiController
       /** Set calling frequency
        * \param val New value to set
        */
-      void SetCallingFrequency(int val) { frequency = val; }
+      void SetCallingFrequency(int val) { frqRecip = 0xFFFFFFFFU / val; SetIntegralGain(ki); }
 
       /** Run regulator to obtain a new actuator value
        * \param curVal currently measured value
@@ -73,9 +91,10 @@ class PiController
    private:
       int32_t kp; //!< Member variable "kp"
       int32_t ki; //!< Member variable "ki"
-      s32fp esum; //!< Member variable "esum"
+      int32_t kiScaled; //!< ki / frequency with PI_KI_DIGITS fractional digits
+      int64_t esum; //!< Integral term with PI_KI_DIGITS fractional digits
       s32fp refVal;
-      int32_t frequency; //!< Calling frequency
+      uint32_t frqRecip; //!< 2^32 / calling frequency
       int32_t maxY;
       int32_t minY;
 };
@@ -27,6 +27,7 @@ class SineCore
       static void Calc(uint16_t angle);
       static s32fp Sine(uint16_t angle);
       static s32fp Cosine(uint16_t angle);
+      static void SinCos(uint16_t angle, s32fp& sin, s32fp& cos);
       static uint16_t Atan2(int32_t cos, int32_t sin);
       static void SetAmp(uint32_t amp);
       static uint32_t GetAmp();
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+#include <stdint.h>
+
+/** @brief Lock-free ring buffer for exactly one producer and one consumer context,
+ * e.g. an interrupt and a lower priority task.
+ *
+ * The producer only writes head, the consumer only writes tail. Both indexes
+ * run freely and are masked on access, so all N entries are usable.
+ * @tparam T item type, copied in and out
+ * @tparam N number of entries, must be a power of 2
+ */
+template<typename T, uint32_t N>
+class SpscQueue
+{
+   public:
+      constexpr SpscQueue() : items(), head(0), tail(0) {}
+
+      /** @brief Append an item, producer side
+       * @return false if the queue is full, the item is dropped
+       */
+      bool Put(const T& item)
+      {
+         uint32_t h = head;
+
+         if (h - tail >= N) return false;
+
+         items[h & (N - 1)] = item;
+         __sync_synchronize(); //Item must be complete before the consumer sees it
+         head = h + 1;
+         return true;
+      }
+
+      /** @brief Take the oldest item, consumer side
+       * @return false if the queue is empty
+       */
+      bool Get(T& item)
+      {
+         uint32_t t = tail;
+
+         if (head == t) return false;
+
+         item = items[t & (N - 1)];
+         __sync_synchronize(); //Item must be read before the producer may overwrite it
+         tail = t + 1;
+         return true;
+      }
+
+      /** @brief Return number of queued items */
+      uint32_t Count() const { return head - tail; }
+
+   private:
+      static_assert(N > 0 && (N & (N - 1)) == 0, "Queue length must be a power of 2");
+
+      T items[N];
+      volatile uint32_t head;
+      volatile uint32_t tail;
+};
+
+#endif // SPSCQUEUE_H
@@ -24,6 +24,7 @@
 #include <libopencm3/stm32/rcc.h>
 
 #define MAX_TASKS 4
+#define SCHED_US_PER_TICK 10
 
 /** @brief Schedules up to 4 tasks using a timer peripheral */
 class Stm32Scheduler
@@ -49,13 +50,48 @@ class Stm32Scheduler
        */
       int GetCpuLoad();
 
+      /** @brief Timing statistics of one task, all times in timer ticks of SCHED_US_PER_TICK */
+      struct TaskStats
+      {
+         uint16_t period;     //!< calling period
+         uint16_t lastTime;   //!< execution time of the last run
+         uint16_t minTime;    //!< shortest execution time
+         uint16_t maxTime;    //!< longest execution time
+         uint16_t avgTime;    //!< moving average of the execution time
+         uint16_t maxJitter;  //!< longest delay between due time and start of the task
+         uint16_t missed;     //!< number of runs that ended after the next due time
+      };
+
+      /** @brief Get timing statistics of a task
+       * @param task index in the order of AddTask calls
+       * @param[out] stats statistics since start or the last ResetStats()
+       * @return false if no task with that index was added
+       */
+      bool GetStats(int task, TaskStats& stats);
+
+      /** @brief Return the sum of missed deadlines of all tasks */
+      int GetMissedDeadlines();
+
+      /** @brief Restart min/max/jitter/missed statistics of all tasks */
+      void ResetStats();
+
+      /** @brief Return the scheduler that was constructed last, e.g. for the terminal */
+      static Stm32Scheduler* GetInstance() { return instance; }
+
    protected:
    private:
       static void nofunc(void);
       static const enum tim_oc_id ocMap[MAX_TASKS];
+      static Stm32Scheduler* instance;
       void (*functions[MAX_TASKS]) (void);
       uint16_t periods[MAX_TASKS];
       uint16_t execTicks[MAX_TASKS];
+      uint16_t minTicks[MAX_TASKS];
+      uint16_t maxTicks[MAX_TASKS];
+      uint32_t avgTicks[MAX_TASKS]; //Moving average with AVG_SHIFT fractional bits
+      uint16_t maxJitter[MAX_TASKS];
+      uint16_t missed[MAX_TASKS];
+      bool started[MAX_TASKS]; //First run is due at the initial compare value, not on schedule
       uint32_t timer;
       int nextTask;
 };
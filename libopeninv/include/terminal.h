@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef struct
 {
@@ -31,6 +32,7 @@ extern "C"
 
 void term_Init();
 void term_Run();
+bool term_Poll();
 void term_Send(char *str);
 
 #ifdef __cplusplus
@@ -0,0 +1,87 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+#include <stdint.h>
+
+#define WHEEL_SLOTS 16 //Must be a power of 2
+#ifndef WHEEL_MAX_TIMERS
+#define WHEEL_MAX_TIMERS 16
+#endif
+
+/** @brief Runs any number of periodic and one-shot software timers from a single
+ * periodic tick, e.g. one Stm32Scheduler task.
+ *
+ * Timers are hashed into WHEEL_SLOTS buckets by their due tick, so a tick only
+ * visits the timers of one bucket. Periodic timers are rescheduled relative
+ * to their due tick, so their period does not drift.
+ * Timers must be added and removed from the context that calls Tick() or
+ * before the tick source is started.
+ */
+class TimerWheel
+{
+   public:
+      TimerWheel();
+
+      /** @brief Add a periodic timer
+       * @param function the task function
+       * @param period calling period in ticks, 1..65535
+       * @param phase the task runs on ticks where tick % period == phase, used
+       *        to keep tasks with a common period from running on the same tick
+       * @return handle for Remove() or -1 if no timer is free
+       */
+      int AddPeriodic(void (*function)(void), uint16_t period, uint16_t phase = 0);
+
+      /** @brief Add a timer that runs once
+       * @param function the task function
+       * @param delay number of ticks from now, 1..65535
+       * @return handle for Remove() or -1 if no timer is free
+       */
+      int AddOneShot(void (*function)(void), uint16_t delay);
+
+      /** @brief Stop a timer, may be called from a timer function */
+      void Remove(int handle);
+
+      /** @brief Advance by one tick and run all timers that are due */
+      void Tick();
+
+      /** @brief Return number of ticks since construction */
+      uint32_t GetTicks() { return now; }
+
+   private:
+      struct Timer
+      {
+         void (*function)(void); //!< 0 for free or removed timers
+         uint16_t period;        //!< 0 for one-shot timers
+         uint16_t rounds;        //!< wheel turns until due
+         int8_t next;            //!< next timer in the same slot
+         bool linked;            //!< timer is in a slot list
+      };
+
+      int Allocate(void (*function)(void), uint16_t period);
+      void Schedule(int timer, uint16_t delay);
+      void Link(int timer, int slot);
+
+      Timer timers[WHEEL_MAX_TIMERS];
+      int8_t heads[WHEEL_SLOTS];
+      int8_t tails[WHEEL_SLOTS];
+      uint32_t now;
+};
+
+#endif // TIMERWHEEL_H
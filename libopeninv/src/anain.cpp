@@ -56,8 +56,8 @@ void AnaIn::Start()
    adc_set_regular_sequence(ADC1, ANA_IN_COUNT, channel_array);
    adc_enable_dma(ADC1);
 
-   dma_set_peripheral_address(DMA1, ADC_DMA_CHAN, (uint32_t)&ADC_DR(ADC1));
-   dma_set_memory_address(DMA1, ADC_DMA_CHAN, (uint32_t)values);
+   dma_set_peripheral_address(DMA1, ADC_DMA_CHAN, (uintptr_t)&ADC_DR(ADC1));
+   dma_set_memory_address(DMA1, ADC_DMA_CHAN, (uintptr_t)values);
    dma_set_peripheral_size(DMA1, ADC_DMA_CHAN, DMA_CCR_PSIZE_16BIT);
    dma_set_memory_size(DMA1, ADC_DMA_CHAN, DMA_CCR_MSIZE_16BIT);
    dma_set_number_of_data(DMA1, ADC_DMA_CHAN, NUM_SAMPLES * ANA_IN_COUNT);
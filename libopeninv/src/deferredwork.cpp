@@ -0,0 +1,102 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "deferredwork.h"
+
+SpscQueue<DeferredWork::Item, DEFERRED_QUEUE_LEN> DeferredWork::queues[DeferredWork::QUEUE_LAST];
+volatile uint32_t DeferredWork::dropped = 0;
+volatile uint32_t DeferredWork::errRaised[DeferredWork::QUEUE_LAST][ERROR_WORDS];
+volatile uint32_t DeferredWork::errHandled[DeferredWork::QUEUE_LAST][ERROR_WORDS];
+volatile uint32_t DeferredWork::paramRaised[DeferredWork::QUEUE_LAST][PARAM_WORDS];
+volatile uint32_t DeferredWork::paramHandled[DeferredWork::QUEUE_LAST][PARAM_WORDS];
+volatile s32fp DeferredWork::paramValues[Param::PARAM_LAST];
+
+void DeferredWork::PostError(queue q, ERROR_MESSAGE_NUM err)
+{
+   int word = err / 32;
+   uint32_t bit = 1u << (err % 32);
+
+   //Only the producer of this queue writes errRaised[q]
+   if (((errRaised[q][word] ^ errHandled[q][word]) & bit) == 0)
+      errRaised[q][word] = errRaised[q][word] ^ bit;
+}
+
+void DeferredWork::SetParam(queue q, Param::PARAM_NUM param, s32fp value)
+{
+   int word = param / 32;
+   uint32_t bit = 1u << (param % 32);
+
+   //Value first, so a drain that sees the flag also sees the value
+   paramValues[param] = value;
+
+   if (((paramRaised[q][word] ^ paramHandled[q][word]) & bit) == 0)
+      paramRaised[q][word] = paramRaised[q][word] ^ bit;
+}
+
+bool DeferredWork::Call(queue q, void (*function)(int), int arg)
+{
+   Item item = { function, arg };
+   return Put(item, q);
+}
+
+void DeferredWork::Drain()
+{
+   Item item;
+
+   for (int q = 0; q < QUEUE_LAST; q++)
+   {
+      for (int word = 0; word < ERROR_WORDS; word++)
+      {
+         uint32_t pending = errRaised[q][word] ^ errHandled[q][word];
+
+         //Acknowledge first, an error raised again while posting stays pending
+         errHandled[q][word] = errHandled[q][word] ^ pending;
+
+         for (int i = 0; pending != 0; i++, pending >>= 1)
+         {
+            if (pending & 1)
+               ErrorMessage::Post((ERROR_MESSAGE_NUM)(word * 32 + i));
+         }
+      }
+
+      for (int word = 0; word < PARAM_WORDS; word++)
+      {
+         uint32_t pending = paramRaised[q][word] ^ paramHandled[q][word];
+
+         //A value set again after this reads the slot stays pending and is applied next time
+         paramHandled[q][word] = paramHandled[q][word] ^ pending;
+
+         for (int i = 0; pending != 0; i++, pending >>= 1)
+         {
+            if (pending & 1)
+               Param::Set((Param::PARAM_NUM)(word * 32 + i), paramValues[word * 32 + i]);
+         }
+      }
+
+      while (queues[q].Get(item))
+         item.function(item.arg);
+   }
+}
+
+bool DeferredWork::Put(const Item& item, queue q)
+{
+   if (queues[q].Put(item)) return true;
+
+   dropped = dropped + 1; //Not atomic, a lost count does no harm
+   return false;
+}
@@ -23,17 +23,7 @@
 #include "sine_core.h"
 
 #define SQRT3 FP_FROMFLT(1.732050807568877293527446315059)
-#define R1 FP_FROMFLT(0.03)
-#define S1 FP_FROMFLT(0.15)
-#define R2 FP_FROMFLT(0.5)
-#define S2 FP_FROMFLT(0.5)
-#define S3 FP_FROMFLT(1)
-#define RADSTART(x) x < R1 ? S1 : (x < R2 ? S2 : S3)
-
-static const s32fp fluxLinkage = FP_FROMFLT(0.09);
-static const s32fp fluxLinkage2 = FP_MUL(fluxLinkage, fluxLinkage);
-static const s32fp lqminusldSquaredBs10 = FP_FROMFLT(0.01722); //additional 10-bit left shift because otherwise it can't be represented
-static const s32fp lqminusld = FP_FROMFLT(0.0058);
+
 static const u32fp sqrt3 = SQRT3;
 static const s32fp sqrt3inv1 = FP_FROMFLT(0.57735026919); //1/sqrt(3)
 static const s32fp sqrt3inv2 = 2*sqrt3inv1; //2/sqrt(2)
@@ -47,14 +37,42 @@ s32fp FOC::id;
 s32fp FOC::iq;
 s32fp FOC::DutyCycles[3];
 
+s32fp FOC::sin;
+s32fp FOC::cos;
+s32fp FOC::sinMod;
+s32fp FOC::cosMod;
+
+int32_t FOC::mtpaId[MTPA_POINTS];
+int32_t FOC::mtpaIq[MTPA_POINTS];
+int FOC::mtpaShift = 0;
+
+/** @brief Calculate the trigonometry of one PWM cycle for ParkClarke() and InvParkClarke()
+  * @param angle rotor angle at the time the currents were sampled
+  * @param advance rotor movement until the new voltage takes effect,
+  *        added to angle for the inverse transformation
+  */
+void FOC::SetAngle(uint16_t angle, int16_t advance)
+{
+   SineCore::SinCos(angle, sin, cos);
+
+   if (advance == 0)
+   {
+      sinMod = sin;
+      cosMod = cos;
+   }
+   else
+   {
+      SineCore::SinCos(angle + advance, sinMod, cosMod);
+   }
+}
+
 /** @brief Transform current to rotor system using Clarke and Park transformation
+  * @pre SetAngle() was called for the current PWM cycle
   * @post flux producing (id) and torque producing (iq) current are written
   *       to FOC::id and FOC::iq
   */
-void FOC::ParkClarke(s32fp il1, s32fp il2, uint16_t angle)
+void FOC::ParkClarke(s32fp il1, s32fp il2)
 {
-   s32fp sin = SineCore::Sine(angle);
-   s32fp cos = SineCore::Cosine(angle);
    //Clarke transformation
    s32fp ia = il1;
    s32fp ib = FP_MUL(sqrt3inv1, il1) + FP_MUL(sqrt3inv2, il2);
@@ -63,7 +81,48 @@ void FOC::ParkClarke(s32fp il1, s32fp il2, uint16_t angle)
    iq = FP_MUL(cos, ib) - FP_MUL(sin, ia);
 }
 
+/** \brief Calculate the MTPA table for the given motor
+ *
+ * For every stator current is the split with the most torque per amp is
+ * id = a - sqrt(a² + is²/2) with a = psi / (4 (Lq - Ld)), iq = sqrt(is² - id²).
+ * Table entries are spaced by a power of two amps so that Mtpa() can
+ * interpolate without dividing. Motors with Lq <= Ld get id = 0.
+ *
+ * \param fluxLinkage permanent magnet flux linkage in mWeber (FRAC_DIGITS)
+ * \param ld d axis inductance in mH (FRAC_DIGITS)
+ * \param lq q axis inductance in mH (FRAC_DIGITS)
+ * \param maxCurrent largest current in A the table must cover
+ */
+void FOC::SetMotorParameters(s32fp fluxLinkage, s32fp ld, s32fp lq, int32_t maxCurrent)
+{
+   const uint32_t aMax = 8192 << FRAC_DIGITS; //keeps a² + is²/2 within 32 bits
+   uint32_t a = aMax;
+
+   mtpaShift = 0;
+   while ((MTPA_POINTS - 1) << mtpaShift < maxCurrent && mtpaShift < MTPA_MAX_SHIFT)
+      mtpaShift++;
+
+   if (lq > ld)
+      a = MIN(((uint32_t)fluxLinkage << FRAC_DIGITS) / (4 * (lq - ld)), aMax);
+
+   for (int i = 0; i < MTPA_POINTS; i++)
+   {
+      uint32_t is = (i << mtpaShift) << FRAC_DIGITS;
+      uint32_t is2 = ((uint64_t)is * is) >> FRAC_DIGITS;
+      int32_t id = 0;
+
+      if (lq > ld)
+         id = a - fp_sqrt_digits((((uint64_t)a * a) >> FRAC_DIGITS) + is2 / 2, FRAC_DIGITS);
+
+      mtpaId[i] = id;
+      mtpaIq[i] = fp_sqrt_digits(is2 - (((int64_t)id * id) >> FRAC_DIGITS), FRAC_DIGITS);
+   }
+}
+
 /** \brief distribute motor current in magnetic torque and reluctance torque with the least total current
+ *
+ * Interpolates the table calculated by SetMotorParameters(), currents beyond
+ * its range are extrapolated from the last two entries.
  *
  * \param is int32_t total motor current
  * \param[out] idref int32_t& resulting direct current reference
@@ -73,11 +132,14 @@ void FOC::ParkClarke(s32fp il1, s32fp il2, uint16_t angle)
  */
 void FOC::Mtpa(int32_t is, int32_t& idref, int32_t& iqref)
 {
-   int32_t isSquared = is * is;
-   int32_t sign = is < 0 ? -1 : 1;
-   s32fp term1 = fpsqrt(fluxLinkage2 + ((lqminusldSquaredBs10 * isSquared) >> 10));
-   idref = FP_TOINT(FP_DIV(fluxLinkage - term1, lqminusld));
-   iqref = sign * (int32_t)sqrt(isSquared - idref * idref);
+   int32_t absIs = is < 0 ? -is : is;
+   int idx = MIN(absIs >> mtpaShift, MTPA_POINTS - 2);
+   int32_t frac = absIs - (idx << mtpaShift);
+   int32_t id = mtpaId[idx] + (((mtpaId[idx + 1] - mtpaId[idx]) * frac) >> mtpaShift);
+   int32_t iq = mtpaIq[idx] + (((mtpaIq[idx + 1] - mtpaIq[idx]) * frac) >> mtpaShift);
+
+   idref = id >> FRAC_DIGITS;
+   iqref = is < 0 ? -(iq >> FRAC_DIGITS) : iq >> FRAC_DIGITS;
 }
 
 int32_t FOC::GetQLimit(int32_t ud)
@@ -97,22 +159,19 @@ int32_t FOC::GetTotalVoltage(int32_t ud, int32_t uq)
    return sqrt((uint32_t)(ud * ud) + (uint32_t)(uq * uq));
 }
 
-/** \brief Calculate duty cycles for generating ud and uq at given angle
+/** \brief Calculate duty cycles for generating ud and uq at the advanced angle
+ * given to SetAngle()
  *
  * \param ud int32_t direct voltage
  * \param uq int32_t quadrature voltage
- * \param angle uint16_t rotor angle
  * \return void
  *
  */
-void FOC::InvParkClarke(int32_t ud, int32_t uq, uint16_t angle)
+void FOC::InvParkClarke(int32_t ud, int32_t uq)
 {
-   s32fp sin = SineCore::Sine(angle);
-   s32fp cos = SineCore::Cosine(angle);
-
    //Inverse Park transformation
-   s32fp ua = (cos * ud - sin * uq) >> CST_DIGITS;
-   s32fp ub = (cos * uq + sin * ud) >> CST_DIGITS;
+   s32fp ua = (cosMod * ud - sinMod * uq) >> CST_DIGITS;
+   s32fp ub = (cosMod * uq + sinMod * ud) >> CST_DIGITS;
    //Inverse Clarke transformation
    DutyCycles[0] = ua;
    DutyCycles[1] = (-ua + FP_MUL(SQRT3, ub)) / 2;
@@ -143,30 +202,13 @@ int32_t FOC::GetMaximumModulationIndex()
    return modMax;
 }
 
+/** \brief Integer square root, bounded execution time for use in the PWM ISR */
 uint32_t FOC::sqrt(uint32_t rad)
 {
-   uint32_t radshift = (rad < 10000 ? 5 : (rad < 10000000 ? 9 : (rad < 1000000000 ? 13 : 15)));
-   uint32_t sqrt = (rad >> radshift) + 1; //Starting value for newton iteration
-   uint32_t sqrtl;
-
-   do {
-      sqrtl = sqrt;
-      sqrt = (sqrt + rad / sqrt) / 2;
-   } while ((sqrtl - sqrt) > 1);
-
-   return sqrt;
+   return fp_isqrt(rad);
 }
 
 u32fp FOC::fpsqrt(u32fp rad)
 {
-   u32fp sqrt = RADSTART(rad);
-   u32fp sqrtl;
-
-   do {
-      sqrtl = sqrt;
-      sqrt = (sqrt + FP_DIV(rad, sqrt)) >> 1;
-   } while ((sqrtl - sqrt) > 1);
-
-   return sqrt;
+   return fp_sqrt_digits(rad, CST_DIGITS);
 }
-
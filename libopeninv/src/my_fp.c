@@ -77,18 +77,62 @@ s32fp fp_atoi(const char *str)
    return sign * (FP_FROMINT(nat) + frac);
 }
 
-u32fp fp_sqrt(u32fp rad)
+/** \brief Integer square root in bounded time
+ *
+ * The argument is normalised with CLZ so a table lookup on its top 4 bits
+ * gives the root to within 6%. Two Newton iterations then bring the error
+ * below 0.1 and a final compare rounds down. No loop depends on the input.
+ *
+ * \param rad radicand
+ * \return floor(sqrt(rad))
+ */
+uint32_t fp_isqrt(uint32_t rad)
+{
+   //2^14 * sqrt(sqrt(i * (i + 1))) for i = 4..15
+   static const uint16_t seed[] =
+   {
+      34648, 38344, 41709, 44819, 47726, 50464, 53060, 55535, 57903, 60178, 62370, 64487
+   };
+
+   if (rad == 0) return 0;
+
+   int shift = __builtin_clz(rad) & ~1;
+   uint32_t norm = rad << shift; //in [2^30, 2^32)
+   uint32_t sqrt = seed[(norm >> 28) - 4];
+
+   sqrt = (sqrt + norm / sqrt) >> 1;
+   sqrt = (sqrt + norm / sqrt) >> 1;
+   sqrt -= (uint64_t)sqrt * sqrt > norm;
+
+   return sqrt >> (shift / 2);
+}
+
+/** \brief Square root of a fixed point number
+ *
+ * \param rad radicand
+ * \param digits number of fractional digits of rad and the result
+ * \return sqrt(rad) with the same number of fractional digits
+ */
+u32fp fp_sqrt_digits(u32fp rad, int digits)
 {
-   u32fp sqrt = rad >> (rad<1000?4:8); //Starting value for newton iteration
-   u32fp sqrtl;
-   sqrt = sqrt>FP_FROMINT(1)?sqrt:FP_FROMINT(1); //Must be > 0
+   //We need sqrt(rad * 2^digits). Shift as many digits as fit into rad before
+   //taking the root, the remainder must be even so it can be applied after.
+   int shift = rad == 0 ? digits : __builtin_clz(rad);
+
+   if (shift >= digits)
+      return fp_isqrt(rad << digits);
 
-   do {
-      sqrtl = sqrt;
-      sqrt = (sqrt + FP_DIV(rad, sqrt)) >> 1;
-   } while ((sqrtl - sqrt) > 1);
+   shift -= (digits - shift) & 1;
 
-   return sqrt;
+   if (shift < 0)
+      return fp_isqrt(rad >> 1) << ((digits + 1) / 2);
+
+   return fp_isqrt(rad << shift) << ((digits - shift) / 2);
+}
+
+u32fp fp_sqrt(u32fp rad)
+{
+   return fp_sqrt_digits(rad, FRAC_DIGITS);
 }
 
 s32fp fp_ln(unsigned int x)
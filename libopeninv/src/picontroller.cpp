@@ -20,7 +20,7 @@
 #include "my_math.h"
 
 PiController::PiController()
- : kp(0), ki(0), esum(0), refVal(0), frequency(1), maxY(0), minY(0)
+ : kp(0), ki(0), kiScaled(0), esum(0), refVal(0), frqRecip(0xFFFFFFFFU), maxY(0), minY(0)
 {
 }
 
@@ -28,11 +28,13 @@ int32_t PiController::Run(s32fp curVal)
 {
    s32fp err = refVal - curVal;
 
-   esum += err;
-   int32_t y = FP_TOINT(err * kp + (esum / frequency) * ki);
+   esum += (int64_t)err * kiScaled;
+   int32_t y = FP_TOINT(err * kp + (int32_t)(esum >> PI_KI_DIGITS));
    int32_t ylim = MAX(y, minY);
    ylim = MIN(ylim, maxY);
-   esum += ((ylim - y) * frequency) / (ki + 1); //anti windup
+
+   if (kiScaled != 0)
+      esum += (int64_t)(ylim - y) << PI_KI_DIGITS; //anti windup
 
    return ylim;
 }
@@ -27,6 +27,12 @@
 #define SINTAB_MAX      (1 << BITS)
 #define BRAD_PI         (1 << (BITS - 1))
 
+/* Angle bits below the table resolution */
+#define SINTAB_FRACDIGITS (SINLU_ARGDIGITS - SINTAB_ARGDIGITS)
+/* 2 Pi / 65536 in units of 2^-21, slope of the table per angle digit */
+#define INTERP_SLOPE     201
+#define INTERP_DIGITS    21
+
 #define PHASE_SHIFT90   ((uint32_t)(     SINLU_ONEREV / 4))
 #define PHASE_SHIFT120  ((uint32_t)(     SINLU_ONEREV / 3))
 #define PHASE_SHIFT240  ((uint32_t)(2 * (SINLU_ONEREV / 3)))
@@ -91,6 +97,24 @@ s32fp SineCore::Cosine(uint16_t angle)
    return SineLookup((PHASE_SHIFT90 + angle) & 0xFFFF);
 }
 
+/** Calculate sine and cosine of the same angle with a single table access.
+  * The angle bits below the table resolution are interpolated with
+  * sin(a + d) = sin(a) + d cos(a) and cos(a + d) = cos(a) - d sin(a)
+  * @param angle 0 = 0, 2Pi = 65536
+  * @param[out] sin sine of angle, 1 = 32767
+  * @param[out] cos cosine of angle, 1 = 32767
+  */
+void SineCore::SinCos(uint16_t angle, s32fp& sin, s32fp& cos)
+{
+   uint32_t idx = angle >> SINTAB_FRACDIGITS;
+   int32_t frac = (angle & ((1 << SINTAB_FRACDIGITS) - 1)) * INTERP_SLOPE;
+   int32_t s = SinTab[idx];
+   int32_t c = SinTab[(idx + SINTAB_ENTRIES / 4) & (SINTAB_ENTRIES - 1)];
+
+   sin = s + ((c * frac) >> INTERP_DIGITS);
+   cos = c - ((s * frac) >> INTERP_DIGITS);
+}
+
 //Found here: http://www.coranac.com/documents/arctangent/
 uint16_t SineCore::Atan2(int32_t x, int32_t y)
 {
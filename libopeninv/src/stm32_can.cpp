@@ -31,6 +31,7 @@
 #include <libopencm3/cm3/common.h>
 #include <libopencm3/cm3/nvic.h>
 #include "stm32_can.h"
+#include "deferredwork.h"
 
 #define MAX_INTERFACES        2
 #define IDS_PER_BANK          4
@@ -44,8 +45,8 @@
 #define SENDMAP_ADDRESS       CANMAP_ADDRESS
 #define RECVMAP_ADDRESS       (CANMAP_ADDRESS + sizeof(canSendMap))
 #define CRC_ADDRESS           (CANMAP_ADDRESS + sizeof(canSendMap) + sizeof(canRecvMap))
-#define SENDMAP_WORDS         (sizeof(canSendMap) / sizeof(uint32_t))
-#define RECVMAP_WORDS         (sizeof(canRecvMap) / sizeof(uint32_t))
+#define SENDMAP_WORDS         (sizeof(canSendMap) / (sizeof(uint32_t)))
+#define RECVMAP_WORDS         (sizeof(canRecvMap) / (sizeof(uint32_t)))
 #define CANID_UNSET           0xffff
 #define NUMBITS_LASTMARKER    -1
 #define forEachCanMap(c,m) for (CANIDMAP *c = m; (c - m) < MAX_MESSAGES && c->canId < CANID_UNSET; c++)
@@ -449,8 +450,9 @@ void Can::HandleRx(int fifo)
                }
                val = FP_MUL(val, curPos->gain);
 
+               //parm_Change() may take long, it runs from the scheduler
                if (Param::IsParam((Param::PARAM_NUM)curPos->mapParam))
-                  Param::Set((Param::PARAM_NUM)curPos->mapParam, val);
+                  DeferredWork::SetParam(DeferredWork::CAN, (Param::PARAM_NUM)curPos->mapParam, val);
                else
                   Param::SetFlt((Param::PARAM_NUM)curPos->mapParam, val);
             }
@@ -485,14 +487,19 @@ void Can::ProcessSDO(uint32_t data[2])
    {
       if (sdo->cmd == SDO_WRITE)
       {
-         if (Param::Set((Param::PARAM_NUM)sdo->subIndex, sdo->data) == 0)
+         const Param::Attributes* attr = Param::GetAttrib((Param::PARAM_NUM)sdo->subIndex);
+         s32fp val = sdo->data;
+
+         //Range is checked here so we can reply, the value is set by the scheduler
+         if (val < attr->min || val > attr->max)
          {
-            sdo->cmd = SDO_WRITE_REPLY;
+            sdo->cmd = SDO_ABORT;
+            sdo->data = SDO_ERR_RANGE;
          }
          else
          {
-            sdo->cmd = SDO_ABORT;
-            sdo->data = SDO_ERR_RANGE;
+            DeferredWork::SetParam(DeferredWork::CAN, (Param::PARAM_NUM)sdo->subIndex, val);
+            sdo->cmd = SDO_WRITE_REPLY;
          }
       }
       else if (sdo->cmd == SDO_READ)
@@ -20,8 +20,11 @@
 
 /* return CCRc of TIMt */
 #define TIM_CCR(t,c) (*(volatile uint32_t *)(&TIM_CCR1(t) + (c)))
+/* Execution time average over roughly 2^AVG_SHIFT runs */
+#define AVG_SHIFT 4
 
 const enum tim_oc_id Stm32Scheduler::ocMap[MAX_TASKS] = { TIM_OC1, TIM_OC2, TIM_OC3, TIM_OC4 };
+Stm32Scheduler* Stm32Scheduler::instance = 0;
 
 Stm32Scheduler::Stm32Scheduler(uint32_t timer)
 {
@@ -38,9 +41,14 @@ Stm32Scheduler::Stm32Scheduler(uint32_t timer)
    {
       functions[i] = nofunc;
       periods[i] = 0xFFFF;
+      started[i] = false;
+      execTicks[i] = 0;
+      avgTicks[i] = 0;
    }
 
+   ResetStats();
    nextTask = 0;
+   instance = this;
 }
 
 void Stm32Scheduler::AddTask(void (*function)(void), uint16_t period)
@@ -75,10 +83,27 @@ void Stm32Scheduler::Run()
       if (timer_get_flag(timer, TIM_SR_CC1IF << i))
       {
          uint16_t start = timer_get_counter(timer);
+         uint16_t due = TIM_CCR(timer, i);
          timer_clear_flag(timer, TIM_SR_CC1IF << i);
-         TIM_CCR(timer, i) += periods[i];
+         TIM_CCR(timer, i) = (uint16_t)(due + periods[i]);
          functions[i]();
-         execTicks[i] = timer_get_counter(timer) - start;
+         uint16_t end = timer_get_counter(timer);
+         uint16_t ticks = end - start;
+         uint16_t jitter = start - due;
+
+         execTicks[i] = ticks;
+         avgTicks[i] += ticks - (avgTicks[i] >> AVG_SHIFT);
+         if (ticks < minTicks[i]) minTicks[i] = ticks;
+         if (ticks > maxTicks[i]) maxTicks[i] = ticks;
+
+         if (started[i])
+         {
+            if (jitter > maxJitter[i]) maxJitter[i] = jitter;
+            //The next due time has already passed, e.g. because lower tasks
+            //were held off by higher priority interrupts
+            if ((uint16_t)(end - due) >= periods[i]) missed[i]++;
+         }
+         started[i] = true;
       }
    }
 }
@@ -88,12 +113,47 @@ int Stm32Scheduler::GetCpuLoad()
    int totalLoad = 0;
    for (int i = 0; i < MAX_TASKS; i++)
    {
-      int load = (10 * execTicks[i]) / periods[i];
+      int load = (10 * (avgTicks[i] >> AVG_SHIFT)) / periods[i];
       totalLoad += load;
    }
    return totalLoad;
 }
 
+bool Stm32Scheduler::GetStats(int task, TaskStats& stats)
+{
+   if (task < 0 || task >= nextTask) return false;
+
+   stats.period = periods[task];
+   stats.lastTime = execTicks[task];
+   stats.minTime = minTicks[task] > maxTicks[task] ? 0 : minTicks[task];
+   stats.maxTime = maxTicks[task];
+   stats.avgTime = avgTicks[task] >> AVG_SHIFT;
+   stats.maxJitter = maxJitter[task];
+   stats.missed = missed[task];
+   return true;
+}
+
+int Stm32Scheduler::GetMissedDeadlines()
+{
+   int total = 0;
+
+   for (int i = 0; i < MAX_TASKS; i++)
+      total += missed[i];
+
+   return total;
+}
+
+void Stm32Scheduler::ResetStats()
+{
+   for (int i = 0; i < MAX_TASKS; i++)
+   {
+      minTicks[i] = 0xFFFF;
+      maxTicks[i] = 0;
+      maxJitter[i] = 0;
+      missed[i] = 0;
+   }
+}
+
 void Stm32Scheduler::nofunc()
 {
 }
@@ -42,84 +42,85 @@ void term_Init()
 /** Run the terminal */
 void term_Run()
 {
-   char args[TERM_BUFSIZE];
-   const TERM_CMD *pCurCmd = NULL;
-   int lastIdx = 0;
-
    while (1)
-   {
-      int numRcvd = dma_get_number_of_data(DMA1, TERM_USART_DMARX);
-      int currentIdx = TERM_BUFSIZE - numRcvd;
+      term_Poll();
+} /* term_Run */
 
-      if (0 == numRcvd)
-         ResetDMA();
+/** Handle received characters and commands without blocking
+ * @return false if there was nothing to do */
+bool term_Poll()
+{
+   static char args[TERM_BUFSIZE];
+   static const TERM_CMD *pCurCmd = NULL;
+   static int lastIdx = 0;
+   int numRcvd = dma_get_number_of_data(DMA1, TERM_USART_DMARX);
+   int currentIdx = TERM_BUFSIZE - numRcvd;
+   bool busy = lastIdx < currentIdx;
+
+   if (0 == numRcvd)
+      ResetDMA();
 
-      while (lastIdx < currentIdx) //echo
-         usart_send_blocking(TERM_USART, inBuf[lastIdx++]);
+   while (lastIdx < currentIdx) //echo
+      usart_send_blocking(TERM_USART, inBuf[lastIdx++]);
 
-      if (currentIdx > 0)
+   if (currentIdx > 0)
+   {
+      if (inBuf[currentIdx - 1] == '\n' || inBuf[currentIdx - 1] == '\r')
       {
-         if (inBuf[currentIdx - 1] == '\n' || inBuf[currentIdx - 1] == '\r')
+         inBuf[currentIdx] = 0;
+         lastIdx = 0;
+         char *space = (char*)my_strchr(inBuf, ' ');
+
+         if (0 == *space) //No args after command, look for end of line
+         {
+            space = (char*)my_strchr(inBuf, '\n');
+            args[0] = 0;
+         }
+         else //There are arguments, copy everything behind the space
          {
-            inBuf[currentIdx] = 0;
-            lastIdx = 0;
-            char *space = (char*)my_strchr(inBuf, ' ');
-
-            if (0 == *space) //No args after command, look for end of line
-            {
-               space = (char*)my_strchr(inBuf, '\n');
-               args[0] = 0;
-            }
-            else //There are arguments, copy everything behind the space
-            {
-               my_strcpy(args, space + 1);
-            }
-
-            if (0 == *space) //No \n found? try \r
-               space = (char*)my_strchr(inBuf, '\r');
-
-            *space = 0;
-            pCurCmd = CmdLookup(inBuf);
-            ResetDMA();
-
-            if (NULL != pCurCmd)
-            {
-               usart_wait_send_ready(TERM_USART);
-               pCurCmd->CmdFunc(args);
-            }
-            else if (currentIdx > 1)
-            {
-               term_send(TERM_USART, "Unknown command sequence\r\n");
-            }
+            my_strcpy(args, space + 1);
          }
-         else if (inBuf[0] == '!' && NULL != pCurCmd)
+
+         if (0 == *space) //No \n found? try \r
+            space = (char*)my_strchr(inBuf, '\r');
+
+         *space = 0;
+         pCurCmd = CmdLookup(inBuf);
+         ResetDMA();
+
+         if (NULL != pCurCmd)
          {
-            ResetDMA();
-            lastIdx = 0;
+            usart_wait_send_ready(TERM_USART);
             pCurCmd->CmdFunc(args);
          }
+         else if (currentIdx > 1)
+         {
+            term_send(TERM_USART, "Unknown command sequence\r\n");
+         }
+         busy = true;
       }
-   } /* while(1) */
-} /* term_Run */
+      else if (inBuf[0] == '!' && NULL != pCurCmd)
+      {
+         ResetDMA();
+         lastIdx = 0;
+         pCurCmd->CmdFunc(args);
+         busy = true;
+      }
+   }
+   return busy;
+} /* term_Poll */
 
 /*
- * Revision 1 hardware can only use synchronous sending as the DMA channel is
- * occupied by the encoder timer (TIM3, channel 3).
- * All other hardware can use DMA for seamless sending of data. We use double
- * buffering, so while one buffer is sent by DMA we can prepare the other
- * buffer to go next.
+ * All hardware sends via DMA, on revision 1 the encoder polls TIM3 channel 3
+ * instead of using the DMA channel it shares with the USART.
+ * We use double buffering, so while one buffer is sent by DMA we can prepare
+ * the other buffer to go next. A buffer is handed to the DMA on newline or
+ * when it is full.
 */
 int putchar(int c)
 {
    static uint32_t curIdx = 0, curBuf = 0, first = 1;
 
-#ifdef UARTDMABLOCKED
-   if (hwRev == HW_REV1)
-   {
-      usart_send_blocking(TERM_USART, c);
-   }
-   else
-#endif
    if (c == '\n' || curIdx == (TERM_BUFSIZE - 1))
    {
       outBuf[curBuf][curIdx] = c;
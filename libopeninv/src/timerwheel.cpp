@@ -0,0 +1,144 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "timerwheel.h"
+
+#define NONE -1
+
+TimerWheel::TimerWheel()
+   : now(0)
+{
+   for (int i = 0; i < WHEEL_MAX_TIMERS; i++)
+   {
+      timers[i].function = 0;
+      timers[i].linked = false;
+   }
+
+   for (int i = 0; i < WHEEL_SLOTS; i++)
+   {
+      heads[i] = NONE;
+      tails[i] = NONE;
+   }
+}
+
+int TimerWheel::AddPeriodic(void (*function)(void), uint16_t period, uint16_t phase)
+{
+   if (0 == period) return NONE;
+
+   int timer = Allocate(function, period);
+
+   if (timer != NONE)
+   {
+      //First tick after now that satisfies tick % period == phase
+      uint16_t delay = (phase % period + period - now % period) % period;
+      Schedule(timer, delay == 0 ? period : delay);
+   }
+   return timer;
+}
+
+int TimerWheel::AddOneShot(void (*function)(void), uint16_t delay)
+{
+   int timer = Allocate(function, 0);
+
+   if (timer != NONE)
+      Schedule(timer, delay == 0 ? 1 : delay);
+   return timer;
+}
+
+void TimerWheel::Remove(int handle)
+{
+   //The timer is unlinked and freed when its slot comes up
+   if (handle >= 0 && handle < WHEEL_MAX_TIMERS)
+      timers[handle].function = 0;
+}
+
+void TimerWheel::Tick()
+{
+   now++;
+
+   int slot = now & (WHEEL_SLOTS - 1);
+   int timer = heads[slot];
+
+   //Detach the slot so timers rescheduled into it run on the next turn
+   heads[slot] = NONE;
+   tails[slot] = NONE;
+
+   while (timer != NONE)
+   {
+      Timer& t = timers[timer];
+      int next = t.next;
+      void (*function)(void) = t.function;
+
+      t.linked = false;
+
+      if (0 == function)
+      {
+         //Removed, leave it unlinked
+      }
+      else if (t.rounds > 0)
+      {
+         t.rounds--;
+         Link(timer, slot);
+      }
+      else
+      {
+         if (t.period > 0)
+            Schedule(timer, t.period);
+         else
+            t.function = 0;
+
+         function();
+      }
+      timer = next;
+   }
+}
+
+int TimerWheel::Allocate(void (*function)(void), uint16_t period)
+{
+   if (0 == function) return NONE;
+
+   for (int i = 0; i < WHEEL_MAX_TIMERS; i++)
+   {
+      if (0 == timers[i].function && !timers[i].linked)
+      {
+         timers[i].function = function;
+         timers[i].period = period;
+         return i;
+      }
+   }
+   return NONE;
+}
+
+void TimerWheel::Schedule(int timer, uint16_t delay)
+{
+   timers[timer].rounds = (delay - 1) / WHEEL_SLOTS;
+   Link(timer, (now + delay) & (WHEEL_SLOTS - 1));
+}
+
+void TimerWheel::Link(int timer, int slot)
+{
+   timers[timer].next = NONE;
+   timers[timer].linked = true;
+
+   if (NONE == tails[slot])
+      heads[slot] = timer;
+   else
+      timers[tails[slot]].next = timer;
+
+   tails[slot] = timer;
+}
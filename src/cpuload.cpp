@@ -0,0 +1,114 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/cm3/cortex.h>
+#include "cpuload.h"
+#include "hwdefs.h"
+#include "params.h"
+#include "terminal.h"
+#include "my_math.h"
+
+#define CALIB_MIN_TICKS 1000 //10 ms at 100 kHz
+#define CALIB_START_PASSES 256
+
+volatile uint32_t CpuLoad::idleCount = 0;
+uint32_t CpuLoad::calibCount = 0;
+uint32_t CpuLoad::calibTicks = 0;
+int CpuLoad::peaks[3];
+
+void CpuLoad::Calibrate()
+{
+   uint32_t passes = CALIB_START_PASSES;
+   uint16_t ticks = 0;
+   uint32_t masked = cm_mask_interrupts(1);
+
+   timer_enable_counter(SCHED_TIMER);
+
+   //Double the number of passes until the measurement is long enough to be precise
+   while (ticks < CALIB_MIN_TICKS && passes < 0x80000000)
+   {
+      passes *= 2;
+      uint16_t start = timer_get_counter(SCHED_TIMER);
+
+      for (uint32_t i = 0; i < passes; i++)
+         IdlePass();
+
+      ticks = timer_get_counter(SCHED_TIMER) - start;
+   }
+
+   cm_mask_interrupts(masked);
+   calibCount = passes;
+   calibTicks = ticks;
+   idleCount = 0;
+   ResetPeaks();
+}
+
+void CpuLoad::Run()
+{
+   while (1)
+      IdlePass();
+}
+
+void CpuLoad::Update(int pwmLoad, int taskLoad)
+{
+   static bool started = false;
+   static uint16_t lastTime = 0;
+   static uint32_t lastIdle = 0;
+   uint16_t now = timer_get_counter(SCHED_TIMER);
+   uint32_t idle = idleCount;
+   uint16_t window = now - lastTime;
+   uint32_t passes = idle - lastIdle;
+
+   lastTime = now;
+   lastIdle = idle;
+
+   //The first window would include the startup
+   if (!started || 0 == window || 0 == calibTicks)
+   {
+      started = true;
+      return;
+   }
+
+   //passes * calibTicks / calibCount is the idle time in ticks
+   int idleLoad = ((uint64_t)1000 * passes * calibTicks) / ((uint64_t)window * calibCount);
+   int load = 1000 - MIN(idleLoad, 1000);
+
+   peaks[0] = MAX(peaks[0], load);
+   peaks[1] = MAX(peaks[1], pwmLoad);
+   peaks[2] = MAX(peaks[2], taskLoad);
+
+   Param::SetFlt(Param::cpuload, FP_FROMINT(load) / 10);
+   Param::SetFlt(Param::cpuloadmax, FP_FROMINT(peaks[0]) / 10);
+   Param::SetFlt(Param::pwmload, FP_FROMINT(pwmLoad) / 10);
+   Param::SetFlt(Param::pwmloadmax, FP_FROMINT(peaks[1]) / 10);
+   Param::SetFlt(Param::tskload, FP_FROMINT(taskLoad) / 10);
+   Param::SetFlt(Param::tskloadmax, FP_FROMINT(peaks[2]) / 10);
+}
+
+void CpuLoad::ResetPeaks()
+{
+   peaks[0] = peaks[1] = peaks[2] = 0;
+}
+
+/** One pass of the main loop, only passes without terminal work count as idle */
+void CpuLoad::IdlePass()
+{
+   if (!term_Poll())
+      idleCount = idleCount + 1;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "emfobserver.h"
+#include "my_math.h"
+#include "sine_core.h"
+
+#define FLUX_DIGITS 24 //Fractional digits of the integrated flux in Vs
+#define LEAK_SHIFT  3  //The integrator leaks with 1/8 of the electrical frequency...
+#define LEAK_MAX    FP_FROMINT(2) //...but at most with 2 Hz, more destabilises the current loop at high speed
+
+static int32_t rsScale = 0; //Resistance in Ohm with 16 fractional digits
+static int32_t lqScale = 0; //Turns A into Vs with FLUX_DIGITS + 16 fractional digits
+static int32_t fluxMin = 0;
+static int32_t timeScale = 0; //Turns V into Vs per PWM cycle with FLUX_DIGITS + 16 fractional digits
+static int32_t leakScale = 0; //Turns Hz into leak per PWM cycle with 16 fractional digits
+static s32fp minFrq = 0;
+static int32_t appliedUalpha = 0, appliedUbeta = 0; //Voltage output during the last PWM cycle
+static int32_t nextUalpha = 0, nextUbeta = 0; //Voltage output during the current PWM cycle
+static int32_t fluxAlpha = 0, fluxBeta = 0;
+static uint16_t estimatedAngle = 0;
+static bool valid = false;
+
+static void Rotate(uint16_t angle, int32_t d, int32_t q, int32_t& alpha, int32_t& beta)
+{
+   s32fp sin, cos;
+
+   SineCore::SinCos(angle, sin, cos);
+   alpha = ((int64_t)cos * d - (int64_t)sin * q) >> 15;
+   beta = ((int64_t)sin * d + (int64_t)cos * q) >> 15;
+}
+
+void EmfObserver::SetMotorParameters(s32fp rs, s32fp lq, s32fp fluxLinkage)
+{
+   rsScale = ((int64_t)rs << 16) / FP_FROMINT(1000);
+   lqScale = ((int64_t)lq << (FLUX_DIGITS + 16 - FRAC_DIGITS)) / FP_FROMINT(1000);
+   //Half the magnet flux
+   fluxMin = ((int64_t)fluxLinkage << (FLUX_DIGITS - 1)) / FP_FROMINT(1000);
+}
+
+void EmfObserver::SetMinFrequency(s32fp frq)
+{
+   minFrq = frq;
+}
+
+void EmfObserver::SetPwmFrequency(uint32_t frq)
+{
+   timeScale = (1LL << (FLUX_DIGITS + 16 - FRAC_DIGITS)) / frq;
+   //2 Pi * 65536 * 65536 / 32
+   leakScale = (411775LL << (16 - FRAC_DIGITS)) / frq;
+}
+
+void EmfObserver::Reset()
+{
+   appliedUalpha = appliedUbeta = 0;
+   nextUalpha = nextUbeta = 0;
+   fluxAlpha = fluxBeta = 0;
+   valid = false;
+}
+
+void EmfObserver::Run(uint16_t angle, int16_t advance, s32fp frq, s32fp id, s32fp iq, int32_t ud, int32_t uq, s32fp udc)
+{
+   s32fp absFrq = MAX(ABS(frq), minFrq);
+   s32fp leakFrq = MIN(absFrq >> LEAK_SHIFT, LEAK_MAX);
+   int32_t leak = (leakFrq * leakScale) >> 16;
+   int32_t ialpha, ibeta;
+
+   Rotate(angle, id, iq, ialpha, ibeta);
+
+   int32_t ealpha = appliedUalpha - (((int64_t)rsScale * ialpha) >> 16);
+   int32_t ebeta = appliedUbeta - (((int64_t)rsScale * ibeta) >> 16);
+
+   fluxAlpha += (((int64_t)ealpha * timeScale) >> 16) - (((int64_t)fluxAlpha * leak) >> 16);
+   fluxBeta += (((int64_t)ebeta * timeScale) >> 16) - (((int64_t)fluxBeta * leak) >> 16);
+
+   int32_t activeAlpha = fluxAlpha - (((int64_t)lqScale * ialpha) >> 16);
+   int32_t activeBeta = fluxBeta - (((int64_t)lqScale * ibeta) >> 16);
+
+   valid = (ABS(activeAlpha) + ABS(activeBeta)) > fluxMin;
+   //Atan2 needs its arguments below 2^16
+   estimatedAngle = SineCore::Atan2(activeAlpha >> (FLUX_DIGITS - 16), activeBeta >> (FLUX_DIGITS - 16));
+
+   //The leak causes a phase lead of atan(leakFrq / frq)
+   uint16_t lead = SineCore::Atan2(absFrq, leakFrq);
+   estimatedAngle += frq < 0 ? lead : -lead;
+
+   //The timer loads the new duty cycles at the next update event, so the voltage
+   //commanded now is output during the next cycle. 32768 digits are half the DC link voltage
+   appliedUalpha = nextUalpha;
+   appliedUbeta = nextUbeta;
+   Rotate(angle + advance, ((int64_t)ud * udc) >> 16, ((int64_t)uq * udc) >> 16, nextUalpha, nextUbeta);
+}
+
+uint16_t EmfObserver::GetAngle()
+{
+   return estimatedAngle;
+}
+
+bool EmfObserver::IsValid()
+{
+   return valid;
+}
@@ -59,6 +59,7 @@ void clock_setup(void)
    rcc_periph_clock_enable(RCC_TIM4); //Overcurrent / AUX PWM, scheduler on blue pill
    rcc_periph_clock_enable(RCC_DMA1);  //ADC, Encoder and UART receive
    rcc_periph_clock_enable(RCC_ADC1);
+   rcc_periph_clock_enable(RCC_ADC2); //Phase currents synchronous to PWM
    rcc_periph_clock_enable(RCC_CRC);
    rcc_periph_clock_enable(RCC_AFIO); //CAN
    rcc_periph_clock_enable(RCC_CAN1); //CAN
@@ -162,20 +163,17 @@ void usart_setup(void)
    usart_set_parity(TERM_USART, USART_PARITY_NONE);
    usart_set_flow_control(TERM_USART, USART_FLOWCONTROL_NONE);
    usart_enable_rx_dma(TERM_USART);
+   usart_enable_tx_dma(TERM_USART);
 
-   if (hwRev != HW_REV1)
-   {
-      usart_enable_tx_dma(TERM_USART);
-      dma_channel_reset(DMA1, TERM_USART_DMATX);
-      dma_set_read_from_memory(DMA1, TERM_USART_DMATX);
-      dma_set_peripheral_address(DMA1, TERM_USART_DMATX, (uint32_t)&TERM_USART_DR);
-      dma_set_peripheral_size(DMA1, TERM_USART_DMATX, DMA_CCR_PSIZE_8BIT);
-      dma_set_memory_size(DMA1, TERM_USART_DMATX, DMA_CCR_MSIZE_8BIT);
-      dma_enable_memory_increment_mode(DMA1, TERM_USART_DMATX);
-   }
+   dma_channel_reset(DMA1, TERM_USART_DMATX);
+   dma_set_read_from_memory(DMA1, TERM_USART_DMATX);
+   dma_set_peripheral_address(DMA1, TERM_USART_DMATX, (uintptr_t)&TERM_USART_DR);
+   dma_set_peripheral_size(DMA1, TERM_USART_DMATX, DMA_CCR_PSIZE_8BIT);
+   dma_set_memory_size(DMA1, TERM_USART_DMATX, DMA_CCR_MSIZE_8BIT);
+   dma_enable_memory_increment_mode(DMA1, TERM_USART_DMATX);
 
    dma_channel_reset(DMA1, TERM_USART_DMARX);
-   dma_set_peripheral_address(DMA1, TERM_USART_DMARX, (uint32_t)&TERM_USART_DR);
+   dma_set_peripheral_address(DMA1, TERM_USART_DMARX, (uintptr_t)&TERM_USART_DR);
    dma_set_peripheral_size(DMA1, TERM_USART_DMARX, DMA_CCR_PSIZE_8BIT);
    dma_set_memory_size(DMA1, TERM_USART_DMARX, DMA_CCR_MSIZE_8BIT);
    dma_enable_memory_increment_mode(DMA1, TERM_USART_DMARX);
@@ -189,8 +187,16 @@ void usart_setup(void)
 */
 void nvic_setup(void)
 {
-   nvic_enable_irq(PWM_TIMER_IRQ); //Main PWM
-   nvic_set_priority(PWM_TIMER_IRQ, 1 << 4); //Set second-highest priority
+   if (CUR_SYNC)
+   {
+      nvic_enable_irq(CUR_SYNC_IRQ); //Main PWM, started by end of current conversion
+      nvic_set_priority(CUR_SYNC_IRQ, 1 << 4); //Set second-highest priority
+   }
+   else
+   {
+      nvic_enable_irq(PWM_TIMER_IRQ); //Main PWM
+      nvic_set_priority(PWM_TIMER_IRQ, 1 << 4); //Set second-highest priority
+   }
 
    nvic_enable_irq(NVIC_TIM1_BRK_IRQ); //Emergency shut down
    nvic_set_priority(NVIC_TIM1_BRK_IRQ, 0); //Highest priority
@@ -198,6 +204,9 @@ void nvic_setup(void)
    nvic_enable_irq(NVIC_EXTI2_IRQ); //Encoder Index pulse
    nvic_set_priority(NVIC_EXTI2_IRQ, 0); //Set highest priority
 
+   nvic_enable_irq(REV_CNT_DMA_IRQ); //End of SPI encoder frame
+   nvic_set_priority(REV_CNT_DMA_IRQ, 0); //Set highest priority
+
    if (hwRev == HW_BLUEPILL)
    {
       nvic_enable_irq(NVIC_TIM4_IRQ); //Scheduler
@@ -266,3 +275,36 @@ void tim_setup()
    }
 }
 
+
+/**
+* Setup ADC2 to convert both phase currents on every PWM timer update event.
+* The update event is at a counter extremum, i.e. in the middle of a zero
+* vector, so the samples are free of switching noise and equal the average
+* current of the PWM period. The regular ADC1 scan keeps converting them as well.
+*
+* @param[in] il1Channel ADC channel of phase current 1
+* @param[in] il2Channel ADC channel of phase current 2
+*/
+void current_adc_setup(uint8_t il1Channel, uint8_t il2Channel)
+{
+   uint8_t channels[] = { il1Channel, il2Channel };
+
+   adc_power_off(CUR_SYNC_ADC);
+   //Needed for converting more than one injected channel
+   adc_enable_scan_mode(CUR_SYNC_ADC);
+   adc_set_right_aligned(CUR_SYNC_ADC);
+   //Two conversions take 3.3us at 12 MHz ADC clock
+   adc_set_sample_time(CUR_SYNC_ADC, il1Channel, ADC_SMPR_SMP_7DOT5CYC);
+   adc_set_sample_time(CUR_SYNC_ADC, il2Channel, ADC_SMPR_SMP_7DOT5CYC);
+
+   adc_power_on(CUR_SYNC_ADC);
+   /* wait for adc starting up*/
+   for (volatile int i = 0; i < 80000; i++);
+
+   adc_reset_calibration(CUR_SYNC_ADC);
+   adc_calibrate(CUR_SYNC_ADC);
+
+   adc_set_injected_sequence(CUR_SYNC_ADC, 2, channels);
+   adc_enable_external_trigger_injected(CUR_SYNC_ADC, ADC_CR2_JEXTSEL_TIM1_TRGO);
+   adc_enable_eoc_interrupt_injected(CUR_SYNC_ADC);
+}
@@ -26,10 +26,16 @@
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/adc.h>
 #include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/crc.h>
+#include <libopencm3/cm3/cortex.h>
 #include "errormessage.h"
+#include "deferredwork.h"
 #include "params.h"
 #include "sine_core.h"
 #include "printf.h"
+#include "isrbench.h"
+#include "emfobserver.h"
 
 #define TWO_PI            65536
 //Angle difference at which we assume jitter to become irrelevant
@@ -37,6 +43,31 @@
 #define MAX_CNT           TWO_PI - 1
 #define MAX_REVCNT_VALUES 5
 #define MIN_RES_AMP       1000
+#define CAL_DIGITS        16
+#define CAL_SAMPLES       4096 //Samples per calibration step
+#define CAL_MAX_SPEED     ((TWO_PI / 64) << PLL_DIGITS) //At least 64 samples per revolution
+#define CAL_MAX_GAIN      (2 << CAL_DIGITS)
+#define CAL_MIN_GAIN      (1 << (CAL_DIGITS - 1))
+#define CAL_MAX_QUAD      ((1 << CAL_DIGITS) / 2)
+#define CAL_MAX_OFS       FP_FROMINT(1000)
+#define COMP_BITS         6
+#define COMP_ENTRIES      (1 << COMP_BITS)
+#define COMP_BIN_DIGITS   (16 - COMP_BITS)
+#define COMP_MIN_SAMPLES  (2 * COMP_ENTRIES) //Fastest revolution we learn from
+#define COMP_WORDS        (COMP_ENTRIES / 2)
+#define EDGE_HISTORY      8
+#define EDGE_HISTORY_TIME 64    //Minimum distance of history entries in scheduler ticks
+#define EDGE_MAX_AGE      20000 //Older edges mean standstill, must be well below 16 bit wrap
+#define EDGE_JITTER       2     //Time stamp truncation plus latency of the capture DMA
+#define SPEED_DIGITS      16
+#define SPI_BITS          16
+#define SPI_CLOCK_PERIOD  36   //Timer ticks per bit, 2 MHz serial clock
+#define SPI_VEL_INTERVAL  8    //Every n-th frame reads the velocity register
+#define SPI_VEL_FULLSCALE 1000 //Velocity register full scale in rps with 8.192 MHz crystal
+#define SPI_MAX_AGE       16   //Older angle samples are not used for extrapolation
+#define SPI_RDVEL         (1 << 3)
+#define SPI_DOS           (1 << 1) //Active low
+#define SPI_LOT           (1 << 0) //Active low
 
 #define FRQ_TO_PSC(frq) ((72000000 / frq) - 1)
 #define NUM_ENCODER_CONFIGS (sizeof(encoderConfigurations) / sizeof(encoderConfigurations[0]))
@@ -67,16 +98,93 @@ static volatile uint16_t angle = 0;
 static uint16_t pulsesPerTurn = 0;
 static uint32_t lastPulseTimespan = 0;
 static uint32_t anglePerPulse = 0;
+static u32fp pulseFrqPerTurn = 0; //Rotor frequency at one timer tick between pulses
 static uint32_t fullTurns = 0;
 static uint32_t pwmFrq = 1;
 static u32fp lastFrequency = 0;
 static bool ignore = true;
+#ifdef ENCMODE_FIXED
+//Image built for one mode, the compiler removes the code of all others
+static const enum Encoder::mode encMode = Encoder::ENCMODE_FIXED;
+static bool modeInitialized = false;
+#else
 static enum Encoder::mode encMode = Encoder::INVALID;
+#endif
 static bool seenNorthSignal = false;
 static int32_t turnsSinceLastSample = 0;
 static int32_t resolverMin = 0, resolverMax = 0, startupDelay;
 static int32_t sinChan = 3, cosChan = 2;
 static int32_t detectedDirection = 0;
+//Angle tracking loop for resolver and sin/cos, angle and speed with PLL_DIGITS fractional digits
+static uint32_t pllAngle = 0;
+static int32_t pllSpeed = 0; //Angle increment per PWM cycle
+static Encoder::PllGains pllGains = { 0, 0 };
+static int32_t pllMinSpeed = 0;
+static uint32_t pllLatency = 0; //Age of the sensor sample in PWM cycles
+
+//Sin/cos imperfection correction, offsets in fixed point digits, gain and quadrature with CAL_DIGITS
+struct CalibrationSums
+{
+   int32_t n;
+   int32_t sinOfs, cosOfs; //residual offset before resolver inversion
+   int64_t sin2, cos2, sincos;
+};
+
+static s32fp sinOffset = 0, cosOffset = 0;
+static int32_t cosGain = 1 << CAL_DIGITS, quadComp = 0;
+static bool calLearn = false;
+static CalibrationSums calRevolution, calBatch, calResult;
+static volatile bool calResultReady = false;
+
+//Angle error compensation table indexed by sensor angle, correction in digits
+struct AngleErrorBin
+{
+   int32_t angleSum; //Angle relative to start of bin
+   int32_t sampleSum; //Sample number within revolution
+   int32_t count;
+};
+
+static int16_t angleComp[COMP_ENTRIES];
+static enum Encoder::anglecomp compMode = Encoder::COMP_OFF;
+static AngleErrorBin compBins[2][COMP_ENTRIES];
+static int compLearnBuf = 0;
+static int compResultSamples, compResultDir;
+static volatile bool compResultReady = false;
+static int pllBandwidth = 300;
+static u32fp handoverFrq = FP_FROMINT(10);
+
+//AB/ABZ speed measurement from time stamped edges of channel 1
+struct EdgeSample
+{
+   int32_t position; //Counter value at the edge, not wrapped to one turn
+   uint16_t time; //Scheduler timer value at the edge
+};
+
+static EdgeSample edgeHistory[EDGE_HISTORY];
+static EdgeSample lastEdge;
+static int edgeHistoryIdx = 0;
+static int validEdges = 0;
+static int32_t abPosition = 0;
+static uint16_t lastCount = 0;
+static int32_t abSpeed = 0; //Angle increment per scheduler tick with SPEED_DIGITS
+static uint16_t lastEdgeAngle = 0;
+//Precalculated in SetImpulsesPerTurn() so that the PWM ISR needs no division by the period
+static Encoder::CountScale abScale = { 0, 0 }; //Counter value to angle
+static uint32_t abStepAngle = 0; //Angle of one count
+static uint32_t abCountSpeed = 0; //Speed at one count per scheduler tick
+static int32_t abLineSpeed = 0; //Speed at one line (4 counts) per scheduler tick
+static int polledRemaining = MAX_REVCNT_VALUES;
+
+//AD2S frames are clocked by TIM3 channel 2 on PA7, channel 1 DMA samples PA6
+static volatile uint16_t spiData[SPI_BITS];
+static bool spiVelocity = false;
+static bool spiReadingVelocity = false;
+static int spiFrame = 0;
+static uint16_t spiAngle = 0; //Last valid angle sample
+static int spiAge = 0; //PWM cycles since spiAngle was sampled
+static int32_t spiDelta = 0; //Angle increment per PWM cycle
+static int32_t spiSpeed = 0; //Velocity register, 2048 is full scale
+static bool spiSpeedValid = false;
 
 void Encoder::Reset()
 {
@@ -85,8 +193,16 @@ void Encoder::Reset()
    resolverMin = 0;
    resolverMax = 0;
    lastFrequency = 0;
-   detectedDirection = 0;
+   //A single channel can't tell the direction and open loop rotation is forward
+   detectedDirection = encMode == SINGLE || encMode == SENSORLESS ? 1 : 0;
    startupDelay = 4000;
+   pllAngle = 0;
+   pllSpeed = 0;
+   validEdges = 0;
+   abSpeed = 0;
+   spiAge = SPI_MAX_AGE;
+   spiDelta = 0;
+   spiSpeedValid = false;
    for (uint32_t i = 0; i < MAX_REVCNT_VALUES; i++)
       timdata[i] = MAX_CNT;
 }
@@ -97,22 +213,35 @@ bool Encoder::SeenNorthSignal()
    return seenNorthSignal;
 }
 
+/** Is the angle estimated from the motor EMF instead of measured? */
+bool Encoder::IsSensorless()
+{
+   return encMode == SENSORLESS;
+}
+
 /** Set type of motor position feedback
  * @param mode type of motor position feedback */
 void Encoder::SetMode(Encoder::mode mode)
 {
+#ifdef ENCMODE_FIXED
+   //Other modes are not available, the caller reports the mismatch
+   if (encMode != mode || modeInitialized) return;
+
+   modeInitialized = true;
+#else
    if (encMode == mode) return;
 
    encMode = mode;
+#endif
 
-   switch (mode)
+   switch (encMode)
    {
       case AB:
       case ABZ:
          InitTimerABZMode();
          break;
       case SINGLE:
-         //InitTimerSingleChannelMode(); // Not supported in this branch
+         InitTimerSingleChannelMode();
          break;
       case SPI:
          InitSPIMode();
@@ -120,6 +249,11 @@ void Encoder::SetMode(Encoder::mode mode)
       case RESOLVER:
       case SINCOS:
          InitResolverMode();
+         UpdatePllGains();
+         break;
+      case SENSORLESS:
+         InitSensorlessMode();
+         UpdatePllGains();
          break;
       default:
          break;
@@ -129,6 +263,40 @@ void Encoder::SetMode(Encoder::mode mode)
 void Encoder::SetPwmFrequency(uint32_t frq)
 {
    pwmFrq = frq;
+   UpdatePllGains();
+}
+
+/** Read speed from the velocity register of the AD2S chip in SPI mode
+ * @param velocity true: read velocity every SPI_VEL_INTERVAL frames, false: differentiate angle
+ * @pre RDVEL of the chip is wired to SPI_RDVEL_PIN */
+void Encoder::SetSpiVelocity(bool velocity)
+{
+   velocity = velocity && hwRev != HW_BLUEPILL;
+
+   if (velocity == spiVelocity) return;
+
+   spiVelocity = velocity;
+   spiSpeedValid = false;
+
+   if (encMode == SPI)
+      InitSPIMode();
+}
+
+/** Set the open loop frequency of the sensorless mode. The observer takes over
+ * when the rotor follows at 3/4 of it and hands back below 3/8 of it.
+ * @param frq frequency in Hz */
+void Encoder::SetHandoverFrequency(u32fp frq)
+{
+   handoverFrq = frq;
+   EmfObserver::SetMinFrequency((3 * frq) / 8);
+}
+
+/** Set natural frequency of the resolver, sin/cos and sensorless angle tracking loop
+ * @param bandwidth natural frequency in Hz */
+void Encoder::SetPllBandwidth(int bandwidth)
+{
+   pllBandwidth = bandwidth;
+   UpdatePllGains();
 }
 
 /** set number of impulses per shaft rotation
@@ -140,6 +308,13 @@ void Encoder::SetImpulsesPerTurn(uint16_t imp)
    pulsesPerTurn = imp;
    anglePerPulse = TWO_PI / imp;
 
+   int32_t period = imp * 4;
+
+   abScale = CalcCountScale(period);
+   abStepAngle = period > 0 ? TWO_PI / period : 0;
+   abCountSpeed = period > 0 ? (1ull << (16 + SPEED_DIGITS)) / period : 0;
+   abLineSpeed = period > 0 ? ((int64_t)4 << (16 + SPEED_DIGITS)) / period : 0;
+
    if (encMode == SINGLE)
       InitTimerSingleChannelMode();
 
@@ -166,46 +341,40 @@ void Encoder::UpdateRotorAngle()
    static uint16_t lastAngle = 0;
    static uint16_t accumulatedAngle = 0;
    static int poleCounter = 0;
-   uint32_t cntVal;
-   int16_t numPulses;
+   uint32_t cycles = IsrBench::Cycles();
+   int numPulses;
    uint32_t timeSinceLastPulse;
-   uint16_t interpolatedAngle;
-   uint16_t angleDiff;
+   uint32_t interpolatedAngle;
 
    switch (encMode)
    {
       case AB:
       case ABZ:
-         cntVal = timer_get_counter(REV_CNT_TIMER);
-         cntVal *= TWO_PI;
-         cntVal /= pulsesPerTurn * 4;
-         angle = (uint16_t)cntVal;
-         detectedDirection = (TIM_CR1(REV_CNT_TIMER) & TIM_CR1_DIR_DOWN) ? -1 : 1;
-         angleDiff = (detectedDirection < 0 ?
-                     (lastAngle - angle) : (angle - lastAngle)) & 0xFFFF;
-         turnsSinceLastSample += angleDiff;
+         angle = CompensateAngle(GetAngleAB());
          break;
       case SINGLE:
-/*       // -- Not supported in this branch --  
-		 numPulses = GetPulseTimeFiltered();
+         numPulses = GetPulseTimeFiltered();
          timeSinceLastPulse = timer_get_counter(REV_CNT_TIMER);
-         interpolatedAngle = ignore ? 0 : (anglePerPulse * timeSinceLastPulse) / lastPulseTimespan;
-         accumulatedAngle += (int16_t)(dir * numPulses * anglePerPulse);
-         angle = accumulatedAngle + dir * interpolatedAngle;
-         lastFrequency = ignore ? lastFrequency : FP_FROMINT(pulseMeasFrq) / (lastPulseTimespan * pulsesPerTurn);
-         detectedDirection = dir; */
+         //Never run ahead of the next pulse when slowing down
+         interpolatedAngle = ignore ? 0 : MIN(anglePerPulse, (anglePerPulse * timeSinceLastPulse) / lastPulseTimespan);
+         accumulatedAngle += (int16_t)(detectedDirection * numPulses * anglePerPulse);
+         angle = accumulatedAngle + detectedDirection * interpolatedAngle;
+         lastFrequency = ignore ? lastFrequency : pulseFrqPerTurn / lastPulseTimespan;
          break;
       case SPI:
-         angle = GetAngleSPI();
+         angle = CompensateAngle(GetAngleSPI());
          UpdateTurns(angle, lastAngle);
          break;
       case RESOLVER:
-         angle = GetAngleResolver();
-         UpdateTurns(angle, lastAngle);
+         angle = TrackAngle(CompensateAngle(GetAngleResolver()));
          break;
       case SINCOS:
-         angle = GetAngleSinCos();
-         UpdateTurns(angle, lastAngle);
+         angle = TrackAngle(CompensateAngle(GetAngleSinCos()));
+         break;
+      case SENSORLESS:
+         angle = TrackAngle(EmfObserver::GetAngle());
+         //Hysteresis between open loop and observer
+         seenNorthSignal = lastFrequency >= (seenNorthSignal ? (3 * handoverFrq) / 8 : (3 * handoverFrq) / 4);
          break;
       default:
          break;
@@ -216,7 +385,7 @@ void Encoder::UpdateRotorAngle()
       if (poleCounter == 0)
       {
          fullTurns++;
-         poleCounter = Param::GetInt(Param::respolepairs);
+         poleCounter = Param::GetInt(encMode == SENSORLESS ? Param::polepairs : Param::respolepairs);
       }
       else
       {
@@ -226,6 +395,7 @@ void Encoder::UpdateRotorAngle()
 
    startupDelay = startupDelay > 0 ? startupDelay - 1 : 0;
    lastAngle = angle;
+   IsrBench::RecordEncoder(IsrBench::Cycles() - cycles);
 }
 
 /** Update rotor frequency.
@@ -233,16 +403,17 @@ void Encoder::UpdateRotorAngle()
  */
 void Encoder::UpdateRotorFrequency(int callingFrequency)
 {
-   if ((encMode == AB) || (encMode == ABZ))
-   {
-      //65536 is one turn
-      lastFrequency = (callingFrequency * turnsSinceLastSample) / FP_TOINT(TWO_PI);
-      turnsSinceLastSample = 0;
-   }
-   else if ((encMode == RESOLVER) || (encMode == SPI) || (encMode == SINCOS))
+   if (encMode == SPI)
    {
       int absTurns = ABS(turnsSinceLastSample);
-      if (startupDelay == 0 && absTurns > STABLE_ANGLE)
+      int absSpeed = ABS(spiSpeed);
+
+      if (spiVelocity && spiSpeedValid)
+      {
+         lastFrequency = startupDelay == 0 ? (FP_FROMINT(absSpeed) * SPI_VEL_FULLSCALE) / 2048 : 0;
+         detectedDirection = spiSpeed < 0 ? -1 : 1;
+      }
+      else if (startupDelay == 0 && absTurns > STABLE_ANGLE)
       {
          lastFrequency = (callingFrequency * absTurns) / FP_TOINT(TWO_PI);
          detectedDirection = turnsSinceLastSample > 0 ? 1 : -1;
@@ -264,7 +435,7 @@ uint16_t Encoder::GetRotorAngle()
 }
 
 /** Return rotor frequency in Hz
- * @pre in AB/ABZ encoder mode UpdateRotorFrequency must be called at a regular interval */
+ * @pre in SPI encoder mode UpdateRotorFrequency must be called at a regular interval */
 u32fp Encoder::GetRotorFrequency()
 {
    return lastFrequency;
@@ -282,6 +453,11 @@ uint32_t Encoder::GetSpeed()
    {
       return FP_TOINT(60 * lastFrequency) / Param::GetInt(Param::respolepairs);
    }
+   else if (encMode == SENSORLESS)
+   {
+      //The observer tracks the electrical angle
+      return FP_TOINT(60 * lastFrequency) / Param::GetInt(Param::polepairs);
+   }
    else
    {
       return FP_TOINT(60 * lastFrequency);
@@ -310,6 +486,436 @@ void Encoder::UpdateTurns(uint16_t angle, uint16_t lastAngle)
    turnsSinceLastSample += signedDiff;
 }
 
+static int32_t WrapCount(int32_t diff, int32_t period)
+{
+   if (diff > period / 2) diff -= period;
+   else if (diff < -period / 2) diff += period;
+   return diff;
+}
+
+/** Combined M/T-method for quadrature encoders, called once per PWM cycle.
+ * Every rising edge of channel 1 is time stamped with the scheduler timer by DMA.
+ * The speed is the number of counts between the latest edge and an edge at least
+ * EDGE_HISTORY * EDGE_HISTORY_TIME ticks before it divided by the time between them.
+ * At low speed that degrades to the time between adjacent edges. The angle is
+ * extrapolated from the latest edge but never leaves the current counter step.
+ * @return interpolated angle
+ */
+uint16_t Encoder::GetAngleAB()
+{
+   int32_t period = pulsesPerTurn * 4;
+   uint16_t now = timer_get_counter(SCHED_TIMER);
+   int remaining = dma_get_number_of_data(DMA1, REV_CNT_DMACHAN);
+   uint16_t count = timer_get_counter(REV_CNT_TIMER);
+   uint16_t capture = TIM3_CCR1;
+
+   //An edge between reading the DMA counter and the capture register, read again
+   if (dma_get_number_of_data(DMA1, REV_CNT_DMACHAN) != remaining)
+   {
+      remaining = dma_get_number_of_data(DMA1, REV_CNT_DMACHAN);
+      count = timer_get_counter(REV_CNT_TIMER);
+      capture = TIM3_CCR1;
+   }
+
+   int dir = (TIM_CR1(REV_CNT_TIMER) & TIM_CR1_DIR_DOWN) ? -1 : 1;
+   EdgeSample edge;
+
+   abPosition += WrapCount(count - lastCount, period);
+   lastCount = count;
+   //The capture holds the counter value after the edge. Counting down that is one below the edge
+   edge.position = abPosition + WrapCount(capture - count, period) + (dir < 0 ? 1 : 0);
+   edge.time = timdata[(2 * MAX_REVCNT_VALUES - remaining - 1) % MAX_REVCNT_VALUES];
+
+   if (edge.time != lastEdge.time || edge.position != lastEdge.position)
+   {
+      int32_t step = edge.position - lastEdge.position;
+
+      //No time reference yet or direction reversed since the last edge
+      if (validEdges == 0 || (validEdges > 1 && (step ^ abSpeed) < 0))
+      {
+         EdgeSample ref = validEdges == 0 ? edge : lastEdge;
+
+         for (int i = 0; i < EDGE_HISTORY; i++)
+            edgeHistory[i] = ref;
+         validEdges = 1;
+         abSpeed = 0;
+      }
+
+      if (validEdges > 0 && edge.time != edgeHistory[edgeHistoryIdx].time)
+      {
+         int i = edgeHistoryIdx;
+
+         //Oldest entry that is still young enough to be compared without wrap around
+         do
+         {
+            i = (i + 1) % EDGE_HISTORY;
+         } while (i != edgeHistoryIdx && (uint16_t)(edge.time - edgeHistory[i].time) > EDGE_MAX_AGE);
+
+         const EdgeSample& ref = edgeHistory[i];
+         uint16_t timeDiff = edge.time - ref.time;
+
+         if (timeDiff > 0)
+         {
+            abSpeed = ((int64_t)(edge.position - ref.position) * abCountSpeed) / timeDiff;
+            validEdges = 2;
+         }
+
+         if ((uint16_t)(edge.time - edgeHistory[edgeHistoryIdx].time) >= EDGE_HISTORY_TIME)
+         {
+            edgeHistoryIdx = (edgeHistoryIdx + 1) % EDGE_HISTORY;
+            edgeHistory[edgeHistoryIdx] = edge;
+         }
+      }
+      lastEdge = edge;
+
+      int32_t edgeCount = capture + (dir < 0 ? 1 : 0);
+      lastEdgeAngle = ScaleCount(abScale, edgeCount < period ? edgeCount : 0);
+   }
+
+   uint16_t age = now - lastEdge.time;
+   uint32_t countAngle = ScaleCount(abScale, count);
+
+   if (validEdges > 0 && age > EDGE_MAX_AGE)
+   {
+      validEdges = 0;
+      abSpeed = 0;
+   }
+   else if (validEdges > 1 && age > EDGE_JITTER)
+   {
+      //No edge for longer than one line period at the measured speed, so we are slower
+      int32_t maxSpeed = abLineSpeed / (age - EDGE_JITTER);
+      abSpeed = MAX(-maxSpeed, MIN(maxSpeed, abSpeed));
+   }
+
+   if (abSpeed != 0)
+   {
+      int32_t extrapolated = lastEdgeAngle + (((int64_t)abSpeed * age) >> SPEED_DIGITS);
+      int32_t maxDiff = abStepAngle - 1;
+      int32_t diff = (int16_t)(extrapolated - countAngle);
+
+      countAngle += MAX(0, MIN(maxDiff, diff));
+   }
+
+   detectedDirection = dir;
+   lastFrequency = ((uint64_t)ABS(abSpeed) * SCHED_TIMER_FRQ) >> (16 + SPEED_DIGITS - FRAC_DIGITS);
+
+   return countAngle;
+}
+
+/** Second order angle tracking loop, called once per PWM cycle.
+ * Filters the decoded sensor angle, derives the speed from the loop integrator
+ * and extrapolates the angle from the ADC sampling instant to the current PWM cycle.
+ * @param measuredAngle decoded sensor angle
+ * @return filtered angle at the time of the PWM interrupt
+ */
+uint16_t Encoder::TrackAngle(uint16_t measuredAngle)
+{
+   bool valid = encMode == SENSORLESS ? EmfObserver::IsValid() : (resolverMax - resolverMin) > MIN_RES_AMP;
+
+   if (startupDelay > 0 || !valid)
+   {
+      pllAngle = (uint32_t)measuredAngle << PLL_DIGITS;
+      pllSpeed = 0;
+      lastFrequency = 0;
+      return measuredAngle;
+   }
+
+   StepPll(pllAngle, pllSpeed, pllGains, measuredAngle);
+
+   if (calLearn && encMode != SENSORLESS)
+      LearnCalibration(pllAngle >> PLL_DIGITS);
+
+   if (ABS(pllSpeed) > pllMinSpeed)
+   {
+      //Angle increment per cycle times cycles per second gives turns per second
+      lastFrequency = ((uint64_t)ABS(pllSpeed) * pwmFrq) >> (16 + PLL_DIGITS - FRAC_DIGITS);
+      detectedDirection = pllSpeed > 0 ? 1 : -1;
+   }
+   else
+   {
+      lastFrequency = 0;
+   }
+
+   return (pllAngle + (((int64_t)pllSpeed * pllLatency) >> PLL_DIGITS)) >> PLL_DIGITS;
+}
+
+/** Set sin/cos correction and enable or disable learning it.
+ * @param sinOfs offset of the sin channel in digits
+ * @param cosOfs offset of the cos channel in digits
+ * @param gain gain applied to the cos channel in %
+ * @param quadrature fraction of the sin channel to add to the cos channel in mrad
+ * @param learn estimate the correction while spinning
+ */
+void Encoder::SetCalibration(s32fp sinOfs, s32fp cosOfs, s32fp gain, s32fp quadrature, bool learn)
+{
+   uint32_t mask = cm_mask_interrupts(1);
+   sinOffset = sinOfs;
+   cosOffset = cosOfs;
+   cosGain = (gain << (CAL_DIGITS - FRAC_DIGITS)) / 100;
+   quadComp = (quadrature << (CAL_DIGITS - FRAC_DIGITS)) / 1000;
+   cm_mask_interrupts(mask);
+
+   if (learn && !calLearn)
+   {
+      calBatch.n = 0;
+      calResultReady = false;
+   }
+   calLearn = learn;
+}
+
+/** Evaluate one batch of calibration samples collected by the PWM interrupt
+ * and refine the correction. The new values are written back to the
+ * parameters so they are stored with them. Call periodically.
+ */
+void Encoder::UpdateCalibration()
+{
+   if (!calResultReady) return;
+
+   const CalibrationSums& r = calResult;
+
+   //Only go half the way each step to average out noise
+   s32fp newSinOffset = sinOffset + (r.sinOfs << FRAC_DIGITS) / (2 * r.n);
+   s32fp newCosOffset = cosOffset + (r.cosOfs << FRAC_DIGITS) / (2 * r.n);
+   //The mean of sin*cos over a revolution vanishes when both are in quadrature
+   int32_t newQuadComp = quadComp - ((r.sincos << CAL_DIGITS) / r.sin2) / 2;
+   //Linearized sqrt(sin2/cos2)
+   int32_t gainErr = ((r.sin2 - r.cos2) << CAL_DIGITS) / (2 * r.cos2);
+   int32_t newCosGain = cosGain + (((int64_t)cosGain * gainErr) >> CAL_DIGITS) / 2;
+
+   newSinOffset = MAX(-CAL_MAX_OFS, MIN(CAL_MAX_OFS, newSinOffset));
+   newCosOffset = MAX(-CAL_MAX_OFS, MIN(CAL_MAX_OFS, newCosOffset));
+   newQuadComp = MAX(-CAL_MAX_QUAD, MIN(CAL_MAX_QUAD, newQuadComp));
+   newCosGain = MAX(CAL_MIN_GAIN, MIN(CAL_MAX_GAIN, newCosGain));
+
+   uint32_t mask = cm_mask_interrupts(1);
+   sinOffset = newSinOffset;
+   cosOffset = newCosOffset;
+   quadComp = newQuadComp;
+   cosGain = newCosGain;
+   cm_mask_interrupts(mask);
+   calResultReady = false;
+
+   Param::SetFlt(Param::ressinofs, newSinOffset);
+   Param::SetFlt(Param::rescosofs, newCosOffset);
+   Param::SetFlt(Param::rescosgain, (newCosGain * 100) >> (CAL_DIGITS - FRAC_DIGITS));
+   Param::SetFlt(Param::resquad, ((int64_t)newQuadComp * 1000) >> (CAL_DIGITS - FRAC_DIGITS));
+}
+
+/** Collect the samples of whole revolutions at steady speed.
+ * Called once per PWM cycle with the tracked angle.
+ */
+void Encoder::LearnCalibration(uint16_t angle)
+{
+   static uint16_t lastAngle = 0;
+   static bool revolutionValid = false;
+   //Crossed zero in either direction
+   bool wrapped = ((angle ^ lastAngle) & 0x8000) && ((uint16_t)(angle + TWO_PI / 4) < TWO_PI / 2);
+   int32_t absSpeed = ABS(pllSpeed);
+
+   lastAngle = angle;
+
+   if (absSpeed <= pllMinSpeed || absSpeed > CAL_MAX_SPEED)
+      revolutionValid = false;
+
+   if (wrapped)
+   {
+      if (revolutionValid && !calResultReady)
+      {
+         calBatch.n += calRevolution.n;
+         calBatch.sinOfs += calRevolution.sinOfs;
+         calBatch.cosOfs += calRevolution.cosOfs;
+         calBatch.sin2 += calRevolution.sin2;
+         calBatch.cos2 += calRevolution.cos2;
+         calBatch.sincos += calRevolution.sincos;
+
+         if (calBatch.n >= CAL_SAMPLES)
+         {
+            calResult = calBatch;
+            calResultReady = true;
+            calBatch = CalibrationSums();
+         }
+      }
+
+      calRevolution = CalibrationSums();
+      revolutionValid = absSpeed > pllMinSpeed && absSpeed <= CAL_MAX_SPEED;
+   }
+}
+
+/** Select whether the angle error table is applied and learned
+ * @param comp COMP_OFF, COMP_ON or COMP_LEARN which also applies the table
+ */
+void Encoder::SetAngleCompensation(enum anglecomp comp)
+{
+   compMode = comp;
+}
+
+/** Refine the angle error table from the revolution collected by the PWM interrupt.
+ * At constant speed the true angle grows linearly with the sample number,
+ * the deviation from that line is the sensor error. Call periodically.
+ */
+void Encoder::UpdateAngleCompensation()
+{
+   if (!compResultReady) return;
+
+   AngleErrorBin* bins = compBins[compLearnBuf ^ 1];
+   //Angle increment per sample with 16 fractional digits
+   uint32_t increment = 0xFFFFFFFF / compResultSamples;
+   int16_t error[COMP_ENTRIES];
+   int32_t meanError = 0;
+
+   for (int i = 0; i < COMP_ENTRIES; i++)
+   {
+      if (bins[i].count == 0) //A sensor glitch skipped a bin, drop the revolution
+      {
+         for (int j = 0; j < COMP_ENTRIES; j++)
+            bins[j] = AngleErrorBin();
+         compResultReady = false;
+         return;
+      }
+
+      int32_t measured = (i << COMP_BIN_DIGITS) + bins[i].angleSum / bins[i].count;
+      int32_t expected = ((uint64_t)increment * bins[i].sampleSum / bins[i].count) >> 16;
+
+      error[i] = (int16_t)(measured - compResultDir * expected);
+      meanError += error[i];
+   }
+
+   //The absolute position of the line is unknown, only the deviation counts
+   meanError /= COMP_ENTRIES;
+
+   for (int i = 0; i < COMP_ENTRIES; i++)
+   {
+      int32_t target = meanError - error[i];
+      angleComp[i] += (target - angleComp[i]) / 8;
+      bins[i] = AngleErrorBin();
+   }
+
+   compResultReady = false;
+}
+
+/** Store angle error table in its own flash page */
+void Encoder::SaveAngleCompensation()
+{
+   crc_reset();
+   uint32_t crc = crc_calculate_block((uint32_t*)angleComp, COMP_WORDS);
+
+   flash_unlock();
+   flash_set_ws(2);
+   flash_erase_page(ANGLECOMP_ADDRESS);
+
+   for (int i = 0; i < COMP_WORDS; i++)
+      flash_program_word(ANGLECOMP_ADDRESS + i * sizeof(uint32_t), ((uint32_t*)angleComp)[i]);
+
+   flash_program_word(ANGLECOMP_ADDRESS + COMP_WORDS * sizeof(uint32_t), crc);
+   flash_lock();
+}
+
+/** Load angle error table from flash
+ * @return true if a valid table was found, otherwise the table is cleared
+ */
+bool Encoder::LoadAngleCompensation()
+{
+   uint32_t* data = (uint32_t*)ANGLECOMP_ADDRESS;
+
+   crc_reset();
+   uint32_t crc = crc_calculate_block(data, COMP_WORDS);
+
+   if (crc == data[COMP_WORDS])
+   {
+      for (int i = 0; i < COMP_WORDS; i++)
+         ((uint32_t*)angleComp)[i] = data[i];
+      return true;
+   }
+
+   for (int i = 0; i < COMP_ENTRIES; i++)
+      angleComp[i] = 0;
+   return false;
+}
+
+/** Correct the sensor angle by the interpolated error table
+ * @param rawAngle angle as measured by the sensor
+ * @return compensated angle
+ */
+uint16_t Encoder::CompensateAngle(uint16_t rawAngle)
+{
+   if (compMode == COMP_OFF) return rawAngle;
+
+   if (compMode == COMP_LEARN)
+      LearnAngleError(rawAngle);
+
+   int idx = rawAngle >> COMP_BIN_DIGITS;
+   int frac = rawAngle & ((1 << COMP_BIN_DIGITS) - 1);
+   int comp = angleComp[idx];
+   int next = angleComp[(idx + 1) & (COMP_ENTRIES - 1)];
+
+   return rawAngle + comp + (((next - comp) * frac) >> COMP_BIN_DIGITS);
+}
+
+/** Sort the samples of one revolution into the bins of the error table.
+ * A revolution is only used when it took about as long as the one before.
+ */
+void Encoder::LearnAngleError(uint16_t rawAngle)
+{
+   static uint16_t lastAngle = 0;
+   static int samples = 0, lastSamples = 0, lastDir = 0;
+   AngleErrorBin* bins = compBins[compLearnBuf];
+   int bin = rawAngle >> COMP_BIN_DIGITS;
+   int dir = 0;
+
+   //Crossed zero in either direction
+   if ((uint16_t)(lastAngle + TWO_PI / 4) < TWO_PI / 2 && ((lastAngle ^ rawAngle) & 0x8000) &&
+       (uint16_t)(rawAngle + TWO_PI / 4) < TWO_PI / 2)
+      dir = rawAngle < TWO_PI / 2 ? 1 : -1;
+
+   lastAngle = rawAngle;
+
+   if (dir != 0)
+   {
+      bool steady = dir == lastDir && samples >= COMP_MIN_SAMPLES && samples < TWO_PI &&
+                    ABS(samples - lastSamples) <= samples / 32;
+
+      if (steady && !compResultReady)
+      {
+         compResultSamples = samples;
+         compResultDir = dir;
+         compLearnBuf ^= 1;
+         compResultReady = true;
+      }
+      else
+      {
+         for (int i = 0; i < COMP_ENTRIES; i++)
+            bins[i] = AngleErrorBin();
+      }
+
+      bins = compBins[compLearnBuf];
+      lastSamples = samples;
+      lastDir = dir;
+      samples = 0;
+   }
+
+   if (samples < TWO_PI)
+   {
+      bins[bin].angleSum += rawAngle & ((1 << COMP_BIN_DIGITS) - 1);
+      bins[bin].sampleSum += samples;
+      bins[bin].count++;
+      samples++;
+   }
+}
+
+void Encoder::UpdatePllGains()
+{
+   pllGains = CalcPllGains(pllBandwidth, pwmFrq);
+   //Speed that corresponds to STABLE_ANGLE in 10 ms
+   pllMinSpeed = (((int64_t)STABLE_ANGLE * 100) << PLL_DIGITS) / pwmFrq;
+
+   //The resolver is sampled shortly after the exciter edge of the previous cycle,
+   //the sin/cos conversion is started at the end of the previous cycle
+   if (encMode == RESOLVER)
+      pllLatency = (1 << PLL_DIGITS) - (((uint64_t)resolverSampleDelay * pwmFrq) << PLL_DIGITS) / 1000000;
+   else
+      pllLatency = 1 << PLL_DIGITS;
+}
+
 void Encoder::InitTimerSingleChannelMode()
 {
    const ENCODER_CONFIG* currentConfig = &encoderConfigurations[0];
@@ -328,6 +934,8 @@ void Encoder::InitTimerSingleChannelMode()
       }
    }
 
+   pulseFrqPerTurn = pulsesPerTurn > 0 ? FP_FROMINT(pulseMeasFrq) / pulsesPerTurn : 0;
+
    rcc_periph_reset_pulse(REV_CNT_TIMRST);
 
    //Some explanation: HCLK=72MHz
@@ -366,17 +974,22 @@ void Encoder::InitTimerSingleChannelMode()
    timer_set_oc_polarity_low(REV_CNT_TIMER, REV_CNT_OC);
    timer_ic_enable(REV_CNT_TIMER, REV_CNT_IC);
 
-   timer_enable_irq(REV_CNT_TIMER, REV_CNT_DMAEN);
-   timer_set_dma_on_compare_event(REV_CNT_TIMER);
-
    timer_generate_event(REV_CNT_TIMER, TIM_EGR_UG);
    timer_enable_counter(REV_CNT_TIMER);
    gpio_set_mode(NORTH_EXC_PORT, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, NORTH_EXC_PIN);
    exti_disable_request(NORTH_EXC_EXTI);
+   detectedDirection = 1;
+   polledRemaining = MAX_REVCNT_VALUES;
 
-   dma_disable_channel(DMA1, REV_CNT_DMACHAN);
+   //The DMA request of channel 3 would block the UART TX DMA, poll it instead
+   if (hwRev == HW_REV1) return;
+
+   timer_enable_irq(REV_CNT_TIMER, REV_CNT_DMAEN);
+   timer_set_dma_on_compare_event(REV_CNT_TIMER);
+
+   dma_channel_reset(DMA1, REV_CNT_DMACHAN);
    dma_set_peripheral_address(DMA1, REV_CNT_DMACHAN, REV_CNT_CCR_PTR);
-   dma_set_memory_address(DMA1, REV_CNT_DMACHAN, (uint32_t)timdata);
+   dma_set_memory_address(DMA1, REV_CNT_DMACHAN, (uintptr_t)timdata);
    dma_set_peripheral_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_PSIZE_16BIT);
    dma_set_memory_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_MSIZE_16BIT);
    dma_set_number_of_data(DMA1, REV_CNT_DMACHAN, MAX_REVCNT_VALUES);
@@ -385,13 +998,53 @@ void Encoder::InitTimerSingleChannelMode()
    dma_enable_channel(DMA1, REV_CNT_DMACHAN);
 }
 
+/** Prepare reading an AD2S chip. TIM3 channel 2 generates the serial clock on PA7,
+ * each compare event of channel 1 near the end of the clock low phase copies the
+ * data pin PA6 into spiData via DMA. GetAngleSPI() starts one frame per PWM cycle,
+ * the transfer complete interrupt ends it.
+ */
 void Encoder::InitSPIMode()
 {
    rcc_periph_reset_pulse(REV_CNT_TIMRST);
    exti_disable_request(NORTH_EXC_EXTI);
    gpio_set_mode(NORTH_EXC_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, NORTH_EXC_PIN);
-   gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, GPIO7);
+   gpio_set(NORTH_EXC_PORT, NORTH_EXC_PIN);
+   gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, GPIO7);
    gpio_set_mode(GPIOA, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, GPIO6);
+
+   if (spiVelocity)
+   {
+      gpio_set_mode(SPI_RDVEL_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, SPI_RDVEL_PIN);
+      gpio_set(SPI_RDVEL_PORT, SPI_RDVEL_PIN);
+   }
+   else if (hwRev != HW_BLUEPILL)
+   {
+      gpio_set_mode(SPI_RDVEL_PORT, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, SPI_RDVEL_PIN);
+   }
+
+   //Clock idles high, PWM mode 2 starts each bit with the falling edge
+   timer_set_period(REV_CNT_TIMER, SPI_CLOCK_PERIOD - 1);
+   timer_set_oc_value(REV_CNT_TIMER, TIM_OC2, SPI_CLOCK_PERIOD / 2);
+   timer_set_oc_value(REV_CNT_TIMER, TIM_OC1, SPI_CLOCK_PERIOD / 2 - 1);
+   timer_set_oc_mode(REV_CNT_TIMER, TIM_OC1, TIM_OCM_FROZEN);
+   timer_set_oc_mode(REV_CNT_TIMER, TIM_OC2, TIM_OCM_FORCE_HIGH);
+   timer_enable_oc_output(REV_CNT_TIMER, TIM_OC2);
+   timer_set_dma_on_compare_event(REV_CNT_TIMER);
+   timer_enable_irq(REV_CNT_TIMER, REV_CNT_DMAEN);
+
+   dma_channel_reset(DMA1, REV_CNT_DMACHAN);
+   dma_set_peripheral_address(DMA1, REV_CNT_DMACHAN, (uintptr_t)&GPIO_IDR(GPIOA));
+   dma_set_memory_address(DMA1, REV_CNT_DMACHAN, (uintptr_t)spiData);
+   dma_set_peripheral_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_PSIZE_32BIT);
+   dma_set_memory_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_MSIZE_16BIT);
+   dma_enable_memory_increment_mode(DMA1, REV_CNT_DMACHAN);
+   dma_enable_transfer_complete_interrupt(DMA1, REV_CNT_DMACHAN);
+
+   spiFrame = 0;
+   spiReadingVelocity = false;
+   spiAge = SPI_MAX_AGE;
+   spiDelta = 0;
+   spiSpeedValid = false;
    seenNorthSignal = true;
 }
 
@@ -420,7 +1073,35 @@ void Encoder::InitTimerABZMode()
    timer_ic_set_filter(REV_CNT_TIMER, TIM_IC2, TIM_IC_DTF_DIV_32_N_8);
    timer_ic_enable(REV_CNT_TIMER, TIM_IC1);
    timer_ic_enable(REV_CNT_TIMER, TIM_IC2);
+   //Copy the scheduler time into timdata on every rising edge of channel 1
+   timer_enable_irq(REV_CNT_TIMER, TIM_DIER_CC1DE);
+   timer_set_dma_on_compare_event(REV_CNT_TIMER);
    timer_enable_counter(REV_CNT_TIMER);
+   abPosition = 0;
+   lastCount = 0;
+   validEdges = 0;
+   abSpeed = 0;
+
+   dma_channel_reset(DMA1, REV_CNT_DMACHAN);
+   dma_set_peripheral_address(DMA1, REV_CNT_DMACHAN, (uintptr_t)&TIM_CNT(SCHED_TIMER));
+   dma_set_memory_address(DMA1, REV_CNT_DMACHAN, (uintptr_t)timdata);
+   dma_set_peripheral_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_PSIZE_16BIT);
+   dma_set_memory_size(DMA1, REV_CNT_DMACHAN, DMA_CCR_MSIZE_16BIT);
+   dma_set_number_of_data(DMA1, REV_CNT_DMACHAN, MAX_REVCNT_VALUES);
+   dma_enable_memory_increment_mode(DMA1, REV_CNT_DMACHAN);
+   dma_enable_circular_mode(DMA1, REV_CNT_DMACHAN);
+   dma_enable_channel(DMA1, REV_CNT_DMACHAN);
+   gpio_set_mode(NORTH_EXC_PORT, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, NORTH_EXC_PIN);
+   gpio_set_mode(GPIOA, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, GPIO6 | GPIO7);
+   seenNorthSignal = false;
+}
+
+/** No sensor is read, stop the counter timer and its DMA channel */
+void Encoder::InitSensorlessMode()
+{
+   rcc_periph_reset_pulse(REV_CNT_TIMRST);
+   dma_channel_reset(DMA1, REV_CNT_DMACHAN);
+   exti_disable_request(NORTH_EXC_EXTI);
    gpio_set_mode(NORTH_EXC_PORT, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, NORTH_EXC_PIN);
    gpio_set_mode(GPIOA, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, GPIO6 | GPIO7);
    seenNorthSignal = false;
@@ -479,25 +1160,103 @@ void Encoder::InitResolverMode()
    seenNorthSignal = true;
 }
 
-/** Gets angle from an AD2S chip */
+/** Stop the serial clock and take read high */
+static void EndFrameSPI()
+{
+   timer_disable_counter(REV_CNT_TIMER);
+   timer_set_oc_mode(REV_CNT_TIMER, TIM_OC2, TIM_OCM_FORCE_HIGH);
+   gpio_set(NORTH_EXC_PORT, NORTH_EXC_PIN);
+}
+
+/** Gets angle from an AD2S chip.
+ * Ends the frame that was started in the previous PWM cycle and starts the next one,
+ * so the serial transfer runs in the background. The sample is one cycle old and
+ * extrapolated with the angle increment between the last two valid samples.
+ */
 uint16_t Encoder::GetAngleSPI()
 {
-   uint32_t d = 0;
-   //Skip the abstraction, we need speed here
-   GPIO_BSRR(GPIOA) = GPIO7; //Clock high
-   GPIO_BRR(NORTH_EXC_PORT) = NORTH_EXC_PIN;
+   bool complete = dma_get_number_of_data(DMA1, REV_CNT_DMACHAN) == 0 && spiFrame > 0;
+   bool velocity = spiReadingVelocity;
+   uint16_t frame = 0;
+
+   if (!complete)
+      EndFrameSPI();
+
+   for (int i = 0; i < SPI_BITS; i++)
+      frame = (frame << 1) | ((spiData[i] & GPIO6) >> 6);
+
+   //Select the register for the next frame before read goes low
+   spiFrame++;
+   spiReadingVelocity = spiVelocity && (spiFrame % SPI_VEL_INTERVAL) == 0;
+
+   if (spiVelocity)
+   {
+      if (spiReadingVelocity)
+         gpio_clear(SPI_RDVEL_PORT, SPI_RDVEL_PIN);
+      else
+         gpio_set(SPI_RDVEL_PORT, SPI_RDVEL_PIN);
+   }
+
+   dma_disable_channel(DMA1, REV_CNT_DMACHAN);
+   dma_set_number_of_data(DMA1, REV_CNT_DMACHAN, SPI_BITS);
+   dma_enable_channel(DMA1, REV_CNT_DMACHAN);
+   gpio_clear(NORTH_EXC_PORT, NORTH_EXC_PIN);
+   timer_set_counter(REV_CNT_TIMER, 0);
+   timer_set_oc_mode(REV_CNT_TIMER, TIM_OC2, TIM_OCM_PWM2);
+   timer_enable_counter(REV_CNT_TIMER);
+
+   spiAge = MIN(spiAge + 1, SPI_MAX_AGE);
 
-   for (int i = 15; i >= 0; i--)
+   if (complete && DecodeFrameSPI(frame, velocity) && !velocity)
    {
-      GPIO_BRR(GPIOA) = GPIO7;
-      uint32_t bit = ((uint32_t)GPIO_IDR(GPIOA) & GPIO6);
-      GPIO_BSRR(GPIOA) = GPIO7;
-      d |= bit << i;
+      uint16_t sample = frame & 0xFFF0;
+      int cycles = spiAge - 1; //Cycles between this and the previous sample
+
+      spiDelta = cycles > 0 && spiAge < SPI_MAX_AGE ? (int16_t)(sample - spiAngle) / cycles : 0;
+      spiAngle = sample;
+      spiAge = 1;
    }
-   GPIO_BSRR(NORTH_EXC_PORT) = NORTH_EXC_PIN; //Read high
-   d >>= 10; //6 because of GPIO6, 4 because of encoder format
-   //Encoder format is ANGLE[11:0], RDVEL, Parity, DOS, LOT
-   return d << 4; //we want 16-bit representation
+
+   return spiAngle + spiDelta * spiAge;
+}
+
+/** Validates a frame of the AD2S chip, format is DATA[11:0], RDVEL, Parity, DOS, LOT
+ * @param frame the 16 bits as shifted out
+ * @param velocity true if the velocity register was selected
+ * @return true if the data can be used
+ */
+bool Encoder::DecodeFrameSPI(uint16_t frame, bool velocity)
+{
+   if (velocity)
+      spiSpeedValid = false;
+
+   //Odd parity over the whole frame
+   if (!__builtin_parity(frame))
+   {
+      DeferredWork::PostError(DeferredWork::PWM, ERR_SPIPARITY);
+      return false;
+   }
+
+   if (!(frame & SPI_DOS))
+      DeferredWork::PostError(DeferredWork::PWM, ERR_RESDOS);
+
+   if (!(frame & SPI_LOT))
+   {
+      DeferredWork::PostError(DeferredWork::PWM, ERR_RESLOT);
+      return false;
+   }
+
+   //RDVEL reads back low for the velocity register
+   if (((frame & SPI_RDVEL) == 0) != velocity)
+      return false;
+
+   if (velocity)
+   {
+      spiSpeed = (int16_t)(frame & 0xFFF0) >> 4;
+      spiSpeedValid = true;
+   }
+
+   return true;
 }
 
 /** Calculates current angle from resolver feedback
@@ -542,14 +1301,40 @@ uint16_t Encoder::GetAngleSinCos()
 */
 uint16_t Encoder::DecodeAngle(bool invert)
 {
-   int sin = adc_read_injected(ADC1, sinChan);
-   int cos = adc_read_injected(ADC1, cosChan);
+   //The injected data registers hold a sign extended 16-bit value
+   int sin = (int16_t)adc_read_injected(ADC1, sinChan);
+   int cos = (int16_t)adc_read_injected(ADC1, cosChan);
 
    //Wait for signal to reach usable amplitude
    if ((resolverMax - resolverMin) > MIN_RES_AMP)
    {
+      //The sensor offsets do not change sign with the resolver excitation
+      sin = FP_TOINT(FP_FROMINT(sin) - sinOffset);
+      cos = FP_TOINT(FP_FROMINT(cos) - cosOffset);
+
+      if (calLearn)
+      {
+         calRevolution.sinOfs += sin;
+         calRevolution.cosOfs += cos;
+      }
+
       if (invert)
-         return SineCore::Atan2(-sin, -cos);
+      {
+         sin = -sin;
+         cos = -cos;
+      }
+
+      //Equalize amplitudes and remove the sin component that quadrature error adds to cos
+      cos = (cos * cosGain + sin * quadComp) >> CAL_DIGITS;
+
+      if (calLearn)
+      {
+         calRevolution.n++;
+         calRevolution.sin2 += sin * sin;
+         calRevolution.cos2 += cos * cos;
+         calRevolution.sincos += sin * cos;
+      }
+
       return SineCore::Atan2(sin, cos);
    }
    else
@@ -561,28 +1346,67 @@ uint16_t Encoder::DecodeAngle(bool invert)
 
       if (0 == startupDelay)
       {
-         ErrorMessage::Post(ERR_LORESAMP);
+         DeferredWork::PostError(DeferredWork::PWM, ERR_LORESAMP);
       }
       return 0;
    }
 }
 
+/** Emulate the capture DMA on hardware where its channel is used by the UART.
+ * Called once per PWM cycle, so at most one pulse period per cycle is measured.
+ * @return number of remaining values like the DMA transfer counter
+ */
+int Encoder::PollPulseTime()
+{
+   if (timer_get_flag(REV_CNT_TIMER, REV_CNT_SR))
+   {
+      //Assume pulses lost to an over capture had the same period
+      int captures = timer_get_flag(REV_CNT_TIMER, TIM_SR_CC3OF) ? 2 : 1;
+      uint16_t measTm = timer_get_ic_value(REV_CNT_TIMER, REV_CNT_IC);
+
+      timer_clear_flag(REV_CNT_TIMER, REV_CNT_SR | TIM_SR_CC3OF);
+
+      for (int i = 0; i < captures; i++)
+      {
+         timdata[MAX_REVCNT_VALUES - polledRemaining] = measTm;
+         polledRemaining = polledRemaining > 1 ? polledRemaining - 1 : MAX_REVCNT_VALUES;
+      }
+   }
+   return polledRemaining;
+}
+
 int Encoder::GetPulseTimeFiltered()
 {
-   static int lastN = 0;
+   static int lastN = MAX_REVCNT_VALUES;
    static int noMovement = 0;
-   int n = dma_get_number_of_data(DMA1, REV_CNT_DMACHAN);
+   static int validValues = 0;
+   int n = hwRev == HW_REV1 ? PollPulseTime() : dma_get_number_of_data(DMA1, REV_CNT_DMACHAN);
    int measTm = timer_get_ic_value(REV_CNT_TIMER, REV_CNT_IC);
-   int pulses = n <= lastN ? lastN - n : lastN + MAX_REVCNT_VALUES - n;
+   int newValues = n <= lastN ? lastN - n : lastN + MAX_REVCNT_VALUES - n;
+   bool filterValid = validValues == MAX_REVCNT_VALUES;
+   int pulses = 0;
    int max = 0;
    int min = 0xFFFF;
+
+   for (int i = 0; i < newValues; i++)
+   {
+      int time = timdata[(MAX_REVCNT_VALUES - lastN + i) % MAX_REVCNT_VALUES] + 1;
+
+      //Interference splits a pulse period in two, don't count the short part
+      if (filterValid && 4 * time < (int)lastPulseTimespan)
+         DeferredWork::PostError(DeferredWork::PWM, ERR_ENCODER);
+      else
+         pulses++;
+   }
    lastN = n;
 
    GetMinMaxTime(min, max);
 
-   if (pulses > 0)
+   if (newValues > 0)
    {
       noMovement = 0;
+      //The first value after standstill measured a timer overflow, not a pulse
+      validValues = ignore ? 0 : MIN(validValues + newValues, MAX_REVCNT_VALUES);
       ignore = false;
    }
    else
@@ -601,10 +1425,16 @@ int Encoder::GetPulseTimeFiltered()
          timdata[i] = MAX_CNT;
    }
 
+   //Until all values stem from the current movement there is nothing to compare
+   if (!filterValid)
+   {
+      if (newValues > 0 && validValues > 0)
+         lastPulseTimespan = measTm + 1;
+   }
    //spike detection, a factor of 8 between adjacent pulses is most likely caused by interference
-   if (max > (8 * min) && min > 0)
+   else if (max > (8 * min) && min > 0)
    {
-      ErrorMessage::Post(ERR_ENCODER);
+      DeferredWork::PostError(DeferredWork::PWM, ERR_ENCODER);
    }
    //a factor of 2 is still not stable, use the maximum
    else if (max > (2 * min))
@@ -632,12 +1462,23 @@ extern "C" void exti2_isr(void)
 {
    exti_reset_request(EXTI2);
    timer_set_counter(REV_CNT_TIMER, 0);
+   //The first reset makes the counter jump, start speed measurement over
+   if (!seenNorthSignal) validEdges = 0;
    seenNorthSignal = true;
 }
 
+/** The last bit of an AD2S frame has been sampled */
+extern "C" void rev_dma_isr(void)
+{
+   dma_clear_interrupt_flags(DMA1, REV_CNT_DMACHAN, DMA_TCIF);
+   EndFrameSPI();
+}
+
 extern "C" void exti15_10_isr(void)
 {
    exti_reset_request(EXTI14);
    timer_set_counter(REV_CNT_TIMER, 0);
+   //The first reset makes the counter jump, start speed measurement over
+   if (!seenNorthSignal) validEdges = 0;
    seenNorthSignal = true;
 }
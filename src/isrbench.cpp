@@ -0,0 +1,207 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/cm3/cortex.h>
+#include "isrbench.h"
+#include "anain.h"
+#include "sine_core.h"
+#include "picontroller.h"
+#include "printf.h"
+#if CONTROL == CTRL_FOC
+#include "foc.h"
+#endif
+
+//Spread the inputs over the whole angle range, 65536 / golden ratio
+#define ANGLE_STEP 40503
+
+IsrBench::Stats IsrBench::pwmRun;
+IsrBench::Stats IsrBench::encoder;
+
+static PiController controller;
+static volatile int32_t sink;
+
+static void BenchSineCalc(int i)
+{
+   SineCore::Calc(i * ANGLE_STEP);
+}
+
+static void BenchSinCos(int i)
+{
+   s32fp sin, cos;
+   SineCore::SinCos(i * ANGLE_STEP, sin, cos);
+   sink = sin + cos;
+}
+
+static void BenchAtan2(int i)
+{
+   sink = SineCore::Atan2(2048 - (i & 4095), ((i * 37) & 4095) - 2048);
+}
+
+static void BenchPiController(int i)
+{
+   sink = controller.Run(FP_FROMINT((i & 63) - 32));
+}
+
+static void BenchSqrt(int i)
+{
+   sink = fp_sqrt(i * 104729);
+}
+
+static void BenchAnaIn(int i)
+{
+   sink = i & 1 ? AnaIn::il1.Get() : AnaIn::il2.Get();
+}
+
+#if CONTROL == CTRL_FOC
+static void BenchSetAngle(int i)
+{
+   FOC::SetAngle(i * ANGLE_STEP, 100);
+}
+
+static void BenchParkClarke(int i)
+{
+   FOC::ParkClarke(FP_FROMINT(100), -FP_FROMINT(50) + i);
+}
+
+static void BenchInvParkClarke(int i)
+{
+   FOC::InvParkClarke(1000, 10000 + i);
+}
+
+static void BenchGetQLimit(int i)
+{
+   //Whole modulation range so min and max show any input dependency
+   sink = FOC::GetQLimit((i * 7919) % FOC::GetMaximumModulationIndex());
+}
+
+static void BenchGetTotalVoltage(int i)
+{
+   sink = FOC::GetTotalVoltage((i * 7919) & 0x7FFF, (i * 104729) & 0x7FFF);
+}
+#endif
+
+static const struct
+{
+   const char* name;
+   void (*run)(int i);
+} stages[] =
+{
+#if CONTROL == CTRL_FOC
+   { "SetAngle", BenchSetAngle },
+   { "ParkClarke", BenchParkClarke },
+   { "InvParkClarke", BenchInvParkClarke },
+   { "GetQLimit", BenchGetQLimit },
+   { "GetTotalVoltage", BenchGetTotalVoltage },
+#endif
+   { "PiController", BenchPiController },
+   { "SineCore::Calc", BenchSineCalc },
+   { "SinCos", BenchSinCos },
+   { "Atan2", BenchAtan2 },
+   { "fp_sqrt", BenchSqrt },
+   { "AnaIn::Get", BenchAnaIn },
+};
+
+void IsrBench::Stats::Reset()
+{
+   min = UINT32_MAX;
+   max = 0;
+   count = 0;
+   sum = 0;
+}
+
+void IsrBench::Stats::Add(uint32_t cycles)
+{
+   min = cycles < min ? cycles : min;
+   max = cycles > max ? cycles : max;
+   sum += cycles;
+   count++;
+}
+
+void IsrBench::Init()
+{
+   dwt_enable_cycle_counter();
+   pwmRun.Reset();
+   encoder.Reset();
+}
+
+void IsrBench::Run(int iterations)
+{
+   uint32_t overhead = UINT32_MAX;
+   Stats stats;
+
+   controller.SetGains(100, 1000);
+   controller.SetCallingFrequency(8800);
+   controller.SetMinMaxY(-10000, 10000);
+   controller.SetRef(0);
+
+   //Cost of reading the counter itself, subtracted from all samples
+   for (int i = 0; i < 16; i++)
+   {
+      cm_disable_interrupts();
+      uint32_t start = Cycles();
+      uint32_t cycles = Cycles() - start;
+      cm_enable_interrupts();
+      overhead = cycles < overhead ? cycles : overhead;
+   }
+
+   printf("%-20s%8s%8s%8s\r\n", "cycles", "min", "mean", "max");
+
+   for (unsigned stage = 0; stage < sizeof(stages) / sizeof(stages[0]); stage++)
+   {
+      stats.Reset();
+
+      for (int i = 0; i < iterations; i++)
+      {
+         //Only lock out interrupts for a single call so the PWM ISR is merely delayed
+         cm_disable_interrupts();
+         uint32_t start = Cycles();
+         stages[stage].run(i);
+         uint32_t cycles = Cycles() - start;
+         cm_enable_interrupts();
+         stats.Add(cycles > overhead ? cycles - overhead : 0);
+      }
+
+      PrintStats(stages[stage].name, stats);
+   }
+
+   controller.ResetIntegrator();
+
+   cm_disable_interrupts();
+   stats = pwmRun;
+   pwmRun.Reset();
+   cm_enable_interrupts();
+
+   if (stats.count > 0)
+      PrintStats("PwmGeneration::Run", stats);
+   else
+      printf("PwmGeneration::Run not called since last benchmark\r\n");
+
+   //Encoder cost depends on encmode, so it is only measured in the real ISR
+   cm_disable_interrupts();
+   stats = encoder;
+   encoder.Reset();
+   cm_enable_interrupts();
+
+   if (stats.count > 0)
+      PrintStats("Encoder::Update", stats);
+}
+
+void IsrBench::PrintStats(const char* name, const Stats& stats)
+{
+   printf("%-20s%8u%8u%8u\r\n", name, stats.min, stats.Mean(), stats.max);
+}
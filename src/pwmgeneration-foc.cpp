@@ -25,14 +25,16 @@
 #include "sine_core.h"
 #include "fu.h"
 #include "errormessage.h"
+#include "deferredwork.h"
 #include "digio.h"
 #include "anain.h"
 #include "my_math.h"
 #include "foc.h"
 #include "picontroller.h"
+#include "telemetry.h"
+#include "emfobserver.h"
 
 #define FRQ_TO_ANGLE(frq) FP_TOINT((frq << SineCore::BITS) / pwmfrq)
-#define DIGIT_TO_DEGREE(a) FP_FROMINT(angle) / (65536 / 360)
 
 static int initwait = 0;
 static int fwBaseGain = 0;
@@ -49,16 +51,20 @@ void PwmGeneration::Run()
    if (opmode == MOD_MANUAL || opmode == MOD_RUN)
    {
       static s32fp frqFiltered;
+      const Config& cfg = *config;
       int dir = Encoder::GetRotorDirection();
-      int kifrqgain = Param::GetInt(Param::curkifrqgain);
       s32fp id, iq;
 
       Encoder::UpdateRotorAngle();
 
       CalcNextAngleSync(dir);
 
+      //The new voltage takes effect in the next PWM period, modulate for the rotor position at that time
+      int16_t advance = dir * FP_TOINT(FRQ_TO_ANGLE(frq) * cfg.modadvance);
+      FOC::SetAngle(angle, advance);
+
       frqFiltered = IIRFILTER(frqFiltered, frq, 8);
-      int moddedKi = curki + kifrqgain * FP_TOINT(frqFiltered);
+      int moddedKi = curki + cfg.curkifrqgain * FP_TOINT(frqFiltered);
 
       qController.SetIntegralGain(moddedKi);
       dController.SetIntegralGain(moddedKi);
@@ -73,25 +79,28 @@ void PwmGeneration::Run()
       }
       else if (opmode == MOD_MANUAL)
       {
-         idref = Param::Get(Param::manualid);
+         idref = cfg.manualid;
          dController.SetRef(idref);
-         qController.SetRef(Param::Get(Param::manualiq));
+         qController.SetRef(cfg.manualiq);
       }
 
       int32_t ud = dController.Run(id);
       int32_t qlimit = FOC::GetQLimit(ud);
       qController.SetMinMaxY(-qlimit, qlimit);
       int32_t uq = qController.Run(iq);
-      FOC::InvParkClarke(ud, uq, angle);
+      FOC::InvParkClarke(ud, uq);
+
+      if (Encoder::IsSensorless())
+         EmfObserver::Run(angle, advance, dir * frq, id, iq, ud, uq, cfg.udc);
 
       //This is probably not correct for IPM motors
       s32fp idc = (iq * uq) / FOC::GetMaximumModulationIndex();
 
-      Param::SetFlt(Param::fstat, frq);
-      Param::SetFlt(Param::angle, DIGIT_TO_DEGREE(angle));
-      Param::SetFlt(Param::idc, idc);
-      Param::SetInt(Param::uq, uq);
-      Param::SetInt(Param::ud, ud);
+      Telemetry::Add(Telemetry::fstat, frq);
+      Telemetry::Add(Telemetry::angle, angle);
+      Telemetry::Add(Telemetry::idc, idc);
+      Telemetry::Add(Telemetry::uq, uq);
+      Telemetry::Add(Telemetry::ud, ud);
 
       /* Shut down PWM on stopped motor, neutral gear or init phase */
       if ((0 == frq && 0 == idref && 0 == qController.GetRef()) || 0 == dir || initwait > 0)
@@ -100,6 +109,7 @@ void PwmGeneration::Run()
          dController.ResetIntegrator();
          qController.ResetIntegrator();
          fwController.ResetIntegrator();
+         EmfObserver::Reset(); //No voltage is applied
          idleCounter++;
       }
       else
@@ -187,6 +197,8 @@ void PwmGeneration::PwmInit()
    pwmfrq = TimerSetup(Param::GetInt(Param::deadtime), Param::GetInt(Param::pwmpol));
    slipIncr = FRQ_TO_ANGLE(fslip);
    Encoder::SetPwmFrequency(pwmfrq);
+   EmfObserver::SetPwmFrequency(pwmfrq);
+   EmfObserver::Reset();
    initwait = pwmfrq / 2; //0.5s
    idref = 0;
    qController.ResetIntegrator();
@@ -233,8 +245,8 @@ s32fp PwmGeneration::ProcessCurrents(s32fp& id, s32fp& iq)
 
       if (initwait <= offsetSamples)
       {
-         il1Avg += AnaIn::il1.Get();
-         il2Avg += AnaIn::il2.Get();
+         il1Avg += ilSamples[0];
+         il2Avg += ilSamples[1];
       }
       else
       {
@@ -243,25 +255,33 @@ s32fp PwmGeneration::ProcessCurrents(s32fp& id, s32fp& iq)
 
       if (initwait == 1)
       {
-         SetCurrentOffset(il1Avg / offsetSamples, il2Avg / offsetSamples);
+         int offset1 = il1Avg / offsetSamples;
+         int offset2 = il2Avg / offsetSamples;
+
+         SetCurrentOffset(offset1, offset2);
+
+         if (CHK_BIPOLAR_OFS(offset1))
+            DeferredWork::PostError(DeferredWork::PWM, ERR_HICUROFS1);
+         if (CHK_BIPOLAR_OFS(offset2))
+            DeferredWork::PostError(DeferredWork::PWM, ERR_HICUROFS2);
       }
    }
    else
    {
-      s32fp il1 = GetCurrent(AnaIn::il1, ilofs[0], Param::Get(Param::il1gain));
-      s32fp il2 = GetCurrent(AnaIn::il2, ilofs[1], Param::Get(Param::il2gain));
+      s32fp il1 = GetCurrent(0, config->il1gain);
+      s32fp il2 = GetCurrent(1, config->il2gain);
 
-      if ((Param::GetInt(Param::pinswap) & SWAP_CURRENTS) > 0)
-         FOC::ParkClarke(il2, il1, angle);
+      if (config->swapCurrents)
+         FOC::ParkClarke(il2, il1);
       else
-         FOC::ParkClarke(il1, il2, angle);
+         FOC::ParkClarke(il1, il2);
       id = FOC::id;
       iq = FOC::iq;
 
-      Param::SetFlt(Param::id, FOC::id);
-      Param::SetFlt(Param::iq, FOC::iq);
-      Param::SetFlt(Param::il1, il1);
-      Param::SetFlt(Param::il2, il2);
+      Telemetry::Add(Telemetry::id, FOC::id);
+      Telemetry::Add(Telemetry::iq, FOC::iq);
+      Telemetry::Add(Telemetry::il1, il1);
+      Telemetry::Add(Telemetry::il2, il2);
    }
 
    return 0;
@@ -271,13 +291,9 @@ void PwmGeneration::CalcNextAngleSync(int dir)
 {
    if (Encoder::SeenNorthSignal())
    {
-      uint16_t syncOfs = Param::GetInt(Param::syncofs);
       uint16_t rotorAngle = Encoder::GetRotorAngle();
 
-      //Compensate rotor movement that happened between sampling and processing
-      syncOfs += FP_TOINT(dir * frq * 10);
-
-      angle = polePairRatio * rotorAngle + syncOfs;
+      angle = polePairRatio * rotorAngle + config->syncofs;
       frq = polePairRatio * Encoder::GetRotorFrequency();
    }
    else
@@ -25,14 +25,15 @@
 #include "sine_core.h"
 #include "fu.h"
 #include "errormessage.h"
+#include "deferredwork.h"
 #include "digio.h"
 #include "anain.h"
 #include "my_math.h"
+#include "telemetry.h"
 
 #define SHIFT_180DEG (uint16_t)32768
 #define SHIFT_90DEG  (uint16_t)16384
 #define FRQ_TO_ANGLE(frq) FP_TOINT((frq << SineCore::BITS) / pwmfrq)
-#define DIGIT_TO_DEGREE(a) FP_FROMINT(angle) / (65536 / 360)
 
 void PwmGeneration::Run()
 {
@@ -41,7 +42,7 @@ void PwmGeneration::Run()
       int dir = Encoder::GetRotorDirection();
       uint16_t dc[3];
 
-      Encoder::UpdateRotorAngle(dir);
+      Encoder::UpdateRotorAngle();
       s32fp ampNomLimited = LimitCurrent();
 
       if (opmode == MOD_SINE)
@@ -52,9 +53,9 @@ void PwmGeneration::Run()
       uint32_t amp = MotorVoltage::GetAmpPerc(frq, ampNomLimited);
 
       SineCore::SetAmp(amp);
-      Param::SetInt(Param::amp, amp);
-      Param::SetFlt(Param::fstat, frq);
-      Param::SetFlt(Param::angle, DIGIT_TO_DEGREE(angle));
+      Telemetry::Add(Telemetry::amp, amp);
+      Telemetry::Add(Telemetry::fstat, frq);
+      Telemetry::Add(Telemetry::angle, angle);
       SineCore::Calc(angle);
 
       /* Match to PWM resolution */
@@ -160,8 +161,8 @@ void PwmGeneration::PwmInit()
 s32fp PwmGeneration::LimitCurrent()
 {
    static s32fp curLimSpntFiltered = 0, slipFiltered = 0;
-   s32fp slipmin = Param::Get(Param::fslipmin);
-   s32fp imax = Param::Get(Param::iacmax);
+   s32fp slipmin = config->fslipmin;
+   s32fp imax = config->iacmax;
    s32fp ilMax = ProcessCurrents();
 
    //setting of 0 disables current limiting
@@ -173,7 +174,7 @@ s32fp PwmGeneration::LimitCurrent()
    s32fp slipSpnt = FP_DIV(FP_MUL(fslip, imargin), a);
    slipSpnt = MAX(slipmin, slipSpnt);
    curLimSpnt = MAX(FP_FROMINT(40), curLimSpnt); //Never go below 40%
-   int filter = Param::GetInt(curLimSpnt < curLimSpntFiltered ? Param::ifltfall : Param::ifltrise);
+   int filter = curLimSpnt < curLimSpntFiltered ? config->ifltfall : config->ifltrise;
    curLimSpntFiltered = IIRFILTER(curLimSpntFiltered, curLimSpnt, filter);
    slipFiltered = IIRFILTER(slipFiltered, slipSpnt, 1);
 
@@ -182,7 +183,7 @@ s32fp PwmGeneration::LimitCurrent()
    slipIncr = FRQ_TO_ANGLE(slipSpnt);
 
    if (curLimSpnt < ampnom)
-      ErrorMessage::Post(ERR_CURRENTLIMIT);
+      DeferredWork::PostError(DeferredWork::PWM, ERR_CURRENTLIMIT);
 
    return ampNomLimited;
 }
@@ -205,7 +206,9 @@ s32fp PwmGeneration::GetIlMax(s32fp il1, s32fp il2)
 PwmGeneration::EdgeType PwmGeneration::CalcRms(s32fp il, EdgeType& lastEdge, s32fp& max, s32fp& rms, int& samples, s32fp prevRms)
 {
    const s32fp oneOverSqrt2 = FP_FROMFLT(0.707106781187);
-   int minSamples = pwmfrq / (4 * FP_TOINT(frq));
+   int intFrq = FP_TOINT(frq);
+   //Below 1 Hz the Cortex-M3 division by zero yielded 0, make that explicit
+   int minSamples = intFrq > 0 ? pwmfrq / (4 * intFrq) : 0;
    EdgeType edgeType = NoEdge;
 
    minSamples = MAX(10, minSamples);
@@ -241,8 +244,8 @@ s32fp PwmGeneration::ProcessCurrents()
    static int sign = 1;
    static EdgeType lastEdge[2] = { PosEdge, PosEdge };
 
-   s32fp il1 = GetCurrent(AnaIn::il1, ilofs[0], Param::Get(Param::il1gain));
-   s32fp il2 = GetCurrent(AnaIn::il2, ilofs[1], Param::Get(Param::il2gain));
+   s32fp il1 = GetCurrent(0, config->il1gain);
+   s32fp il2 = GetCurrent(1, config->il2gain);
    s32fp rms;
    s32fp il1PrevRms = Param::Get(Param::il1rms);
    s32fp il2PrevRms = Param::Get(Param::il2rms);
@@ -258,7 +261,7 @@ s32fp PwmGeneration::ProcessCurrents()
          s32fp idc = (SineCore::GetAmp() * rms) / SineCore::MAXAMP;
          idc = FP_DIV(idc, FP_FROMFLT(1.2247)); //divide by sqrt(3)/sqrt(2)
          idc *= fslip < 0 ? -1 : 1;
-         Param::SetFlt(Param::idc, idc);
+         Telemetry::Add(Telemetry::idc, idc);
       }
    }
    if (CalcRms(il2, lastEdge[1], currentMax[1], rms, samples[1], il2PrevRms))
@@ -268,9 +271,9 @@ s32fp PwmGeneration::ProcessCurrents()
 
    s32fp ilMax = sign * GetIlMax(il1, il2);
 
-   Param::SetFlt(Param::il1, il1);
-   Param::SetFlt(Param::il2, il2);
-   Param::SetFlt(Param::ilmax, ilMax);
+   Telemetry::Add(Telemetry::il1, il1);
+   Telemetry::Add(Telemetry::il2, il2);
+   Telemetry::Add(Telemetry::ilmax, ilMax);
 
    return ilMax;
 }
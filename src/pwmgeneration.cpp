@@ -18,6 +18,8 @@
  */
 #include <libopencm3/stm32/timer.h>
 #include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/adc.h>
+#include <libopencm3/cm3/cortex.h>
 #include "pwmgeneration.h"
 #include "hwdefs.h"
 #include "params.h"
@@ -25,15 +27,17 @@
 #include "sine_core.h"
 #include "fu.h"
 #include "errormessage.h"
+#include "deferredwork.h"
 #include "digio.h"
 #include "anain.h"
 #include "my_math.h"
 #include "picontroller.h"
+#include "isrbench.h"
+#include "telemetry.h"
 
 #define SHIFT_180DEG (uint16_t)32768
 #define SHIFT_90DEG  (uint16_t)16384
 #define FRQ_TO_ANGLE(frq) FP_TOINT((frq << SineCore::BITS) / pwmfrq)
-#define DIGIT_TO_DEGREE(a) FP_FROMINT(angle) / (65536 / 360)
 #define FRQ_DIVIDER 8192 //PWM ISR callback frequency divider
 
 uint16_t PwmGeneration::pwmfrq = 1;
@@ -45,9 +49,13 @@ s32fp    PwmGeneration::frq;
 uint8_t  PwmGeneration::shiftForTimer;
 int      PwmGeneration::opmode;
 s32fp    PwmGeneration::ilofs[2];
+int      PwmGeneration::ilSamples[2];
 int      PwmGeneration::polePairRatio;
+PwmGeneration::Config PwmGeneration::configBuffers[2];
+const PwmGeneration::Config* PwmGeneration::config = &configBuffers[0];
 
-static int      execTicks;
+static uint32_t execTicksSum; //Both wrap, GetCpuLoad() uses differences
+static uint32_t execCount;
 static bool     tripped;
 static uint8_t  pwmdigits;
 static PiController chargeController;
@@ -73,30 +81,106 @@ void PwmGeneration::SetFslip(s32fp _fslip)
    fslip = _fslip;
 }
 
+/**
+* Set the current sensor offsets. Implausible offsets are reported by the caller,
+* from the PWM interrupt that has to go through DeferredWork.
+*/
 void PwmGeneration::SetCurrentOffset(int offset1, int offset2)
 {
    ilofs[0] = FP_FROMINT(offset1);
    ilofs[1] = FP_FROMINT(offset2);
 
-   if (CHK_BIPOLAR_OFS(offset1))
-   {
-      ErrorMessage::Post(ERR_HICUROFS1);
-   }
-   if (CHK_BIPOLAR_OFS(offset2))
-   {
-      ErrorMessage::Post(ERR_HICUROFS2);
-   }
-
    SetCurrentLimitThreshold(Param::Get(Param::ocurlim));
 }
 
+/** \brief Copy the parameters used by the PWM interrupt to the buffer it is not
+ * reading and then switch it over with a single pointer write.
+ *
+ * The interrupt thus sees either the old or the new set, never a mix. Interrupts
+ * are only masked while copying so that publishing from the scheduler (deferred
+ * CAN parameter writes and SetUdc()) cannot interleave with publishing from the
+ * terminal in the main loop.
+ */
+void PwmGeneration::PublishConfig()
+{
+   Config next;
+
+   next.il1gain = Param::Get(Param::il1gain);
+   next.il2gain = Param::Get(Param::il2gain);
+   next.chargeflt = Param::GetInt(Param::chargeflt);
+#if CONTROL == CTRL_FOC
+   next.swapCurrents = (Param::GetInt(Param::pinswap) & SWAP_CURRENTS) > 0;
+   next.curkifrqgain = Param::GetInt(Param::curkifrqgain);
+   next.modadvance = Param::Get(Param::modadvance);
+   next.manualid = Param::Get(Param::manualid);
+   next.manualiq = Param::Get(Param::manualiq);
+   next.syncofs = Param::GetInt(Param::syncofs);
+#elif CONTROL == CTRL_SINE
+   next.fslipmin = Param::Get(Param::fslipmin);
+   next.iacmax = Param::Get(Param::iacmax);
+   next.ifltrise = Param::GetInt(Param::ifltrise);
+   next.ifltfall = Param::GetInt(Param::ifltfall);
+#endif
+
+   uint32_t masked = cm_mask_interrupts(1);
+   Config* inactive = config == &configBuffers[0] ? &configBuffers[1] : &configBuffers[0];
+   *inactive = next;
+   inactive->udc = config->udc; //Measured value, published by SetUdc()
+   __sync_synchronize(); //buffer is complete before the interrupt can see it
+   config = inactive;
+   cm_mask_interrupts(masked);
+}
+
+/** \brief Publish the measured DC link voltage to the PWM interrupt.
+ *
+ * Uses the same double buffer as PublishConfig(), the parameters are carried over.
+ */
+void PwmGeneration::SetUdc(s32fp udc)
+{
+   uint32_t masked = cm_mask_interrupts(1);
+   Config* inactive = config == &configBuffers[0] ? &configBuffers[1] : &configBuffers[0];
+   *inactive = *config;
+   inactive->udc = udc;
+   __sync_synchronize();
+   config = inactive;
+   cm_mask_interrupts(masked);
+}
+
+/**
+* Check whether the control step has stopped running although the PWM timer counts.
+* With synchronous current sampling it depends on the ADC trigger, a missing
+* trigger would otherwise leave the last duty cycle applied without notice
+* \return true if no control step ran since the last call
+*/
+bool PwmGeneration::ControlStalled()
+{
+   static uint32_t lastCount = 0;
+   uint32_t count = execCount;
+   bool stalled = count == lastCount && (TIM_CR1(PWM_TIMER) & TIM_CR1_CEN);
+
+   lastCount = count;
+   return stalled;
+}
+
+/** Average load since the last call, must only be called from one task */
 int PwmGeneration::GetCpuLoad()
 {
+   static uint32_t lastSum = 0, lastCount = 0;
+   uint32_t count = execCount;
+   uint32_t sum = execTicksSum;
+   uint32_t runs = count - lastCount;
+   uint32_t ticks = sum - lastSum;
+
+   lastCount = count;
+   lastSum = sum;
+
+   if (0 == runs) return 0;
    //PWM period 2x counter because of center aligned mode
-   return (1000 * execTicks) / FRQ_DIVIDER;
+   return ((uint64_t)1000 * ticks) / ((uint64_t)runs * FRQ_DIVIDER);
 }
 
-static void ConfigureChargeController()
+//Only called by the boost and buck modes, which are disabled in SetOpmode()
+static void __attribute__((unused)) ConfigureChargeController()
 {
    chargeController.SetCallingFrequency(rcc_apb2_frequency / FRQ_DIVIDER);
    chargeController.SetMinMaxY(0, FP_TOINT((Param::Get(Param::chargemax) * (1 << pwmdigits)) / 100));
@@ -122,7 +206,6 @@ void PwmGeneration::SetOpmode(int _opmode)
       default:
       case MOD_OFF:
          DisableOutput();
-         execTicks = 0;
          break;
       case MOD_ACHEAT:
 /*          DisableOutput();
@@ -153,13 +236,13 @@ void PwmGeneration::SetOpmode(int _opmode)
 extern "C" void tim1_brk_isr(void)
 {
    if (!DigIo::desat_in.Get() && hwRev != HW_REV1 && hwRev != HW_BLUEPILL)
-      ErrorMessage::Post(ERR_DESAT);
+      DeferredWork::PostError(DeferredWork::FAULT, ERR_DESAT);
    else if (!DigIo::emcystop_in.Get() && hwRev != HW_REV3)
-      ErrorMessage::Post(ERR_EMCYSTOP);
+      DeferredWork::PostError(DeferredWork::FAULT, ERR_EMCYSTOP);
    else if (!DigIo::mprot_in.Get() && hwRev != HW_BLUEPILL)
-      ErrorMessage::Post(ERR_MPROT);
+      DeferredWork::PostError(DeferredWork::FAULT, ERR_MPROT);
    else //if (ocur || hwRev == HW_REV1)
-      ErrorMessage::Post(ERR_OVERCURRENT);
+      DeferredWork::PostError(DeferredWork::FAULT, ERR_OVERCURRENT);
 
    timer_disable_irq(PWM_TIMER, TIM_DIER_BIE);
    Param::SetInt(Param::opmode, MOD_OFF);
@@ -167,20 +250,35 @@ extern "C" void tim1_brk_isr(void)
    tripped = true;
 }
 
-extern "C" void pwm_timer_isr(void)
+static void RunControlStep()
 {
    int start = timer_get_counter(PWM_TIMER);
-   /* Clear interrupt pending flag */
-   timer_clear_flag(PWM_TIMER, TIM_SR_UIF);
-
+   uint32_t cycles = IsrBench::Cycles();
+   PwmGeneration::SampleCurrents();
    PwmGeneration::Run();
+   IsrBench::RecordPwmRun(IsrBench::Cycles() - cycles);
 
    int time = timer_get_counter(PWM_TIMER) - start;
 
    if (TIM_CR1(PWM_TIMER) & TIM_CR1_DIR_DOWN)
       time = (2 << pwmdigits) - timer_get_counter(PWM_TIMER) - start;
 
-   execTicks = ABS(time);
+   execTicksSum += ABS(time);
+   execCount++;
+}
+
+extern "C" void pwm_timer_isr(void)
+{
+   /* Clear interrupt pending flag */
+   timer_clear_flag(PWM_TIMER, TIM_SR_UIF);
+   RunControlStep();
+}
+
+/** The conversion was triggered by the PWM timer update, so the samples are fresh */
+extern "C" void cur_sync_isr(void)
+{
+   ADC_SR(CUR_SYNC_ADC) &= ~ADC_SR_JEOC;
+   RunControlStep();
 }
 
 /**
@@ -262,26 +360,26 @@ void PwmGeneration::CalcNextAngleConstant(int dir)
 void PwmGeneration::Charge()
 {
    static s32fp iFlt;
-   s32fp il1 = GetCurrent(AnaIn::il1, ilofs[0], Param::Get(Param::il1gain));
-   s32fp il2 = GetCurrent(AnaIn::il2, ilofs[1], Param::Get(Param::il2gain));
+   s32fp il1 = GetCurrent(0, config->il1gain);
+   s32fp il2 = GetCurrent(1, config->il2gain);
 
    il1 = ABS(il1);
    il2 = ABS(il2);
 
    s32fp ilMax = MAX(il1, il2);
 
-   iFlt = IIRFILTER(iFlt, ilMax, Param::GetInt(Param::chargeflt));
+   iFlt = IIRFILTER(iFlt, ilMax, config->chargeflt);
 
    int dc = chargeController.Run(iFlt);
 
    if (opmode == MOD_BOOST)
-      Param::SetFlt(Param::idc, FP_MUL((FP_FROMINT(100) - ampnom), iFlt) / 100);
+      Telemetry::Add(Telemetry::idc, FP_MUL((FP_FROMINT(100) - ampnom), iFlt) / 100);
    else
-      Param::SetFlt(Param::idc, iFlt);
+      Telemetry::Add(Telemetry::idc, iFlt);
 
-   Param::SetInt(Param::amp, dc);
-   Param::SetFlt(Param::il1, il1);
-   Param::SetFlt(Param::il2, il2);
+   Telemetry::Add(Telemetry::amp, dc);
+   Telemetry::Add(Telemetry::il1, il1);
+   Telemetry::Add(Telemetry::il2, il2);
 
    timer_set_oc_value(PWM_TIMER, TIM_OC2, dc);
 }
@@ -297,16 +395,36 @@ void PwmGeneration::AcHeat()
    {
       timer_enable_break_main_output(PWM_TIMER);
       int dc = FP_TOINT((ampnom * 30000) / 100);
-      Param::SetInt(Param::amp, dc);
+      Telemetry::Add(Telemetry::amp, dc);
       timer_set_period(PWM_TIMER, dc);
       timer_set_oc_value(PWM_TIMER, TIM_OC2, dc / 2);
    }
 }
 
-s32fp PwmGeneration::GetCurrent(AnaIn& input, s32fp offset, s32fp gain)
+/**
+* Fetch the raw phase current samples of this PWM cycle.
+* Where supported they were converted by ADC2 on the PWM timer update event
+* and the ISR only runs once that conversion has finished.
+* Otherwise use the latest values of the ADC1 scan.
+*/
+void PwmGeneration::SampleCurrents()
+{
+   if (CUR_SYNC)
+   {
+      ilSamples[0] = adc_read_injected(CUR_SYNC_ADC, 1);
+      ilSamples[1] = adc_read_injected(CUR_SYNC_ADC, 2);
+   }
+   else
+   {
+      ilSamples[0] = AnaIn::il1.Get();
+      ilSamples[1] = AnaIn::il2.Get();
+   }
+}
+
+s32fp PwmGeneration::GetCurrent(int phase, s32fp gain)
 {
-   s32fp il = FP_FROMINT(input.Get());
-   il -= offset;
+   s32fp il = FP_FROMINT(ilSamples[phase]);
+   il -= ilofs[phase];
    return FP_DIV(il, gain);
 }
 
@@ -341,6 +459,8 @@ uint16_t PwmGeneration::TimerSetup(uint16_t deadtime, bool activeLow)
 
    /* Center aligned PWM */
    timer_set_alignment(PWM_TIMER, TIM_CR1_CMS_CENTER_1);
+   //Trigger current sampling on the update event, the same that invokes the ISR
+   timer_set_master_mode(PWM_TIMER, TIM_CR2_MMS_UPDATE);
    timer_enable_preload(PWM_TIMER);
 
    for (int channel = TIM_OC1; channel <= TIM_OC3N; channel++)
@@ -368,7 +488,8 @@ uint16_t PwmGeneration::TimerSetup(uint16_t deadtime, bool activeLow)
    timer_set_enabled_off_state_in_idle_mode(PWM_TIMER);
    timer_set_deadtime(PWM_TIMER, deadtime);
    timer_clear_flag(PWM_TIMER, TIM_SR_UIF | TIM_SR_BIF);
-   timer_enable_irq(PWM_TIMER, TIM_DIER_UIE | TIM_DIER_BIE);
+   //With synchronous current sampling the end of conversion interrupt runs the control step
+   timer_enable_irq(PWM_TIMER, CUR_SYNC ? TIM_DIER_BIE : TIM_DIER_UIE | TIM_DIER_BIE);
 
    timer_set_prescaler(PWM_TIMER, 0);
    /* PWM frequency */
@@ -39,23 +39,52 @@
 #include "my_math.h"
 #include "errormessage.h"
 #include "pwmgeneration.h"
+#include "foc.h"
 #include "printf.h"
 #include "stm32scheduler.h"
+#include "timerwheel.h"
+#include "deferredwork.h"
+#include "cpuload.h"
+#include "isrbench.h"
+#include "telemetry.h"
+#include "emfobserver.h"
 
 #define RMS_SAMPLES 256
 #define SQRT2OV1 0.707106781187
 #define PRECHARGE_TIMEOUT 500 //5s
 #define CAN_TIMEOUT       50  //500ms
 
+#ifndef HWREV_FIXED
 HWREV hwRev; //Hardware variant of board we are running on
+#endif
+static HWREV detectedHwRev;
 
 //Precise control of executing the boost controller
 static Stm32Scheduler* scheduler;
+static TimerWheel* wheel;
 
 static Can* can;
 static s32fp torquePercent = 0;
 static int CanMessageTimeCounter = 0;
 
+/** An image built for one board variant or encoder mode must not start on anything else */
+static bool ImageMatches()
+{
+   bool matches = true;
+
+#ifdef HWREV_FIXED
+   matches = matches && detectedHwRev == hwRev;
+#endif
+#ifdef ENCMODE_FIXED
+   matches = matches && Param::GetInt(Param::encmode) == Encoder::ENCMODE_FIXED;
+#endif
+
+   if (!matches)
+      ErrorMessage::Post(ERR_WRONGIMAGE);
+
+   return matches;
+}
+
 static void GetDigInputs()
 {
    static bool canIoActive = false;
@@ -259,12 +288,15 @@ static s32fp ProcessUdc()
    #endif // CONTROL
 
    Param::SetFlt(Param::udc, udcfp);
+   PwmGeneration::SetUdc(udcfp);
 
    return udcfp;
 }
 
 static void Ms1Task(void)
 {
+   DeferredWork::Drain();
+
    /*
    static int speedCnt = 0;
 
@@ -295,8 +327,9 @@ static void Ms10Task(void)
 
    ErrorMessage::SetTime(rtc_get_counter_val());
    Encoder::UpdateRotorFrequency(100);
+   Encoder::UpdateCalibration();
+   Encoder::UpdateAngleCompensation();
    GetDigInputs();
-   CalcAndOutputTemp();
    Param::SetInt(Param::speed, Encoder::GetSpeed());
 
    if (MOD_RUN == opmode && initWait == -1)
@@ -304,6 +337,7 @@ static void Ms10Task(void)
       PwmGeneration::SetTorquePercent(torquePercent);
    }
 
+   stt |= ImageMatches() ? STAT_NONE : STAT_WRONGIMAGE;
    stt |= DigIo::mprot_in.Get() ? STAT_NONE : STAT_MPROT;
    stt |= udc >= Param::Get(Param::udcsw) ? STAT_NONE : STAT_UDCBELOWUDCSW;
    stt |= udc < Param::Get(Param::udclim) ? STAT_NONE : STAT_UDCLIM;
@@ -338,6 +372,13 @@ static void Ms10Task(void)
       Param::SetInt(Param::opmode, opmode);
    }
 
+   //Also overrides a start request via CAN
+   if (stt & STAT_WRONGIMAGE)
+   {
+      opmode = MOD_OFF;
+      Param::SetInt(Param::opmode, opmode);
+   }
+
    if (MOD_OFF == opmode)
    {
       initWait = 50;
@@ -360,7 +401,15 @@ static void Ms10Task(void)
    }
    else if (initWait == 10)
    {
-      PwmGeneration::SetCurrentOffset(AnaIn::il1.Get(), AnaIn::il2.Get());
+      int offset1 = AnaIn::il1.Get();
+      int offset2 = AnaIn::il2.Get();
+
+      PwmGeneration::SetCurrentOffset(offset1, offset2);
+
+      if (CHK_BIPOLAR_OFS(offset1))
+         ErrorMessage::Post(ERR_HICUROFS1);
+      if (CHK_BIPOLAR_OFS(offset2))
+         ErrorMessage::Post(ERR_HICUROFS2);
       if (hwRev == HW_TESLAM3)
          DigIo::vtg_out.Set();
       initWait--;
@@ -370,16 +419,58 @@ static void Ms10Task(void)
       initWait--;
    }
 
+   Telemetry::Publish(Param::GetInt(Param::tlmperiod) / 10);
+
    if (Param::GetInt(Param::canperiod) == CAN_PERIOD_10MS)
       can->SendAll();
 }
 
+static void WheelTask(void)
+{
+   wheel->Tick();
+}
+
+static void PublishTaskStats()
+{
+   static const Param::PARAM_NUM maxTimeParams[] = { Param::ms1max, Param::ms10max, Param::ms100max };
+#if TASK_OVERRUN_ERROR
+   static int lastMissed = 0;
+#endif
+   Stm32Scheduler::TaskStats stats;
+   int jitter = 0;
+
+   for (int i = 0; scheduler->GetStats(i, stats); i++)
+   {
+      if (i < (int)(sizeof(maxTimeParams) / sizeof(maxTimeParams[0])))
+         Param::SetInt(maxTimeParams[i], stats.maxTime * SCHED_US_PER_TICK);
+      jitter = MAX(jitter, stats.maxJitter * SCHED_US_PER_TICK);
+   }
+
+   int missed = scheduler->GetMissedDeadlines();
+
+#if TASK_OVERRUN_ERROR
+   //Debug aid, tskmissed and the per task counters are the regular output
+   if (missed != lastMissed)
+      ErrorMessage::Post(ERR_TASKOVERRUN);
+
+   lastMissed = missed;
+#endif
+   Param::SetInt(Param::tskjitter, jitter);
+   Param::SetInt(Param::tskmissed, missed);
+}
+
 static void Ms100Task(void)
 {
    DigIo::led_out.Toggle();
    iwdg_reset();
-   s32fp cpuLoad = FP_FROMINT(PwmGeneration::GetCpuLoad() + scheduler->GetCpuLoad());
-   Param::SetFlt(Param::cpuload, cpuLoad / 10);
+   CpuLoad::Update(PwmGeneration::GetCpuLoad(), scheduler->GetCpuLoad());
+
+   if (PwmGeneration::ControlStalled())
+   {
+      ErrorMessage::Post(ERR_PWMSTALL);
+      Param::SetInt(Param::opmode, MOD_OFF);
+   }
+   PublishTaskStats();
    Param::SetInt(Param::turns, Encoder::GetFullTurns());
    Param::SetInt(Param::lasterr, ErrorMessage::GetLastError());
 
@@ -416,10 +507,11 @@ static void Ms100Task(void)
 
    Param::SetFlt(Param::uac, uac);
    #endif // CONTROL
+}
 
-    
-
-    // 
+//Runs on the timer wheel, half way between two Ms100Task runs
+static void SendCanStatus(void)
+{
     uint16_t speedTmp = (Param::Get(Param::speed) + 20000);
     uint16_t idcTmp = (Param::Get(Param::idc) + 10000);
     uint16_t udcTmp = (Param::Get(Param::udc) * 10);
@@ -473,18 +565,35 @@ extern void parm_Change(Param::PARAM_NUM paramNum)
          break;
       default:
          PwmGeneration::SetCurrentLimitThreshold(Param::Get(Param::ocurlim));
-         PwmGeneration::SetPolePairRatio(Param::GetInt(Param::polepairs) / Param::GetInt(Param::respolepairs));
+         //The observer tracks the electrical angle directly
+         if (Param::GetInt(Param::encmode) == Encoder::SENSORLESS)
+            PwmGeneration::SetPolePairRatio(1);
+         else
+            PwmGeneration::SetPolePairRatio(Param::GetInt(Param::polepairs) / Param::GetInt(Param::respolepairs));
 
          #if CONTROL == CTRL_FOC
          PwmGeneration::SetControllerGains(Param::GetInt(Param::curkp), Param::GetInt(Param::curki), Param::GetInt(Param::fwkp));
+         FOC::SetMotorParameters(Param::Get(Param::fluxlinkage), Param::Get(Param::ld), Param::Get(Param::lq),
+                                 FP_TOINT(100 * Param::Get(Param::throtcur)));
          Encoder::SwapSinCos((Param::GetInt(Param::pinswap) & SWAP_RESOLVER) > 0);
+         EmfObserver::SetMotorParameters(Param::Get(Param::rs), Param::Get(Param::lq), Param::Get(Param::fluxlinkage));
+         Encoder::SetHandoverFrequency(Param::Get(Param::sensfrq));
+         //Before the observer takes over the field rotates open loop
+         PwmGeneration::SetFslip(Param::GetInt(Param::encmode) == Encoder::SENSORLESS ? Param::Get(Param::sensfrq) : 0);
          #elif CONTROL == CTRL_SINE
          MotorVoltage::SetMinFrq(FP_FROMFLT(0.2));
          SineCore::SetMinPulseWidth(1000);
          #endif // CONTROL
 
+         PwmGeneration::PublishConfig();
          Encoder::SetMode((enum Encoder::mode)Param::GetInt(Param::encmode));
          Encoder::SetImpulsesPerTurn(Param::GetInt(Param::numimp));
+         Encoder::SetPllBandwidth(Param::GetInt(Param::pllbw));
+         Encoder::SetCalibration(Param::Get(Param::ressinofs), Param::Get(Param::rescosofs),
+                                 Param::Get(Param::rescosgain), Param::Get(Param::resquad),
+                                 Param::GetBool(Param::rescal));
+         Encoder::SetAngleCompensation((enum Encoder::anglecomp)Param::GetInt(Param::angcomp));
+         Encoder::SetSpiVelocity(Param::GetBool(Param::spivel));
 /*
          Throttle::potmin[0] = Param::GetInt(Param::potmin);
          Throttle::potmax[0] = Param::GetInt(Param::potmax);
@@ -534,8 +643,11 @@ static void InitPWMIO()
 
 static void ConfigureVariantIO()
 {
-   hwRev = detect_hw();
-   Param::SetInt(Param::hwver, hwRev);
+   detectedHwRev = detect_hw();
+#ifndef HWREV_FIXED
+   hwRev = detectedHwRev;
+#endif
+   Param::SetInt(Param::hwver, detectedHwRev);
 
    ANA_IN_CONFIGURE(ANA_IN_LIST);
    DIG_IO_CONFIGURE(DIG_IO_LIST);
@@ -564,6 +676,9 @@ static void ConfigureVariantIO()
    }
 
    AnaIn::Start();
+
+   if (CUR_SYNC)
+      current_adc_setup(AnaIn::il1.GetChannel(), AnaIn::il2.GetChannel());
 }
 
 extern "C" void tim2_isr(void)
@@ -615,6 +730,7 @@ static void CanCallback(uint32_t id, uint32_t data[2])
 extern "C" int main(void)
 {
    clock_setup();
+   IsrBench::Init();
    rtc_setup();
    ConfigureVariantIO();
    write_bootloader_pininit();
@@ -627,14 +743,18 @@ extern "C" int main(void)
    Encoder::Reset();
    term_Init();
    parm_load();
+   Encoder::LoadAngleCompensation();
    parm_Change(Param::PARAM_LAST);
    ErrorMessage::SetTime(1);
    InitPWMIO();
 
    MotorVoltage::SetMaxAmp(SineCore::MAXAMP);
 
-   Stm32Scheduler s(hwRev == HW_BLUEPILL ? TIM4 : TIM2); //We never exit main so it's ok to put it on stack
+   Stm32Scheduler s(SCHED_TIMER); //We never exit main so it's ok to put it on stack
    scheduler = &s;
+   TimerWheel w;
+   wheel = &w;
+   CpuLoad::Calibrate();
    
    Can c(CAN1, (Can::baudrates)Param::GetInt(Param::canspeed));
    c.SetReceiveCallback(CanCallback);
@@ -644,6 +764,11 @@ extern "C" int main(void)
    s.AddTask(Ms1Task, 1);
    s.AddTask(Ms10Task, 10);
    s.AddTask(Ms100Task, 100);
+   s.AddTask(WheelTask, 1);
+
+   //Phases in ms keep these off the ticks of Ms10Task and Ms100Task
+   w.AddPeriodic(CalcAndOutputTemp, 10, 5);
+   w.AddPeriodic(SendCanStatus, 100, 50);
 
    DigIo::prec_out.Set();
 
@@ -654,7 +779,7 @@ extern "C" int main(void)
    if (Param::Get(Param::brkmax) > 0)
       Param::Set(Param::brkmax, -Param::Get(Param::brkmax));
 
-   term_Run();
+   CpuLoad::Run();
 
    return 0;
 }
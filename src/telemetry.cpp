@@ -0,0 +1,69 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "telemetry.h"
+
+static const Param::PARAM_NUM params[] =
+{
+   #define TELEMETRY_ENTRY(name, reduction, format) Param::name,
+   TELEMETRY_LIST
+   #undef TELEMETRY_ENTRY
+};
+
+static const Telemetry::Format formats[] =
+{
+   #define TELEMETRY_ENTRY(name, reduction, format) Telemetry::format,
+   TELEMETRY_LIST
+   #undef TELEMETRY_ENTRY
+};
+
+constexpr Telemetry::Reduction Telemetry::reductions[];
+Telemetry::Accumulator Telemetry::acc[2][CHANNEL_COUNT];
+volatile int Telemetry::active = 0;
+int Telemetry::ticks = 0;
+
+void Telemetry::Publish(int period)
+{
+   if (++ticks < period) return;
+
+   ticks = 0;
+
+   //The interrupt cannot be halfway through Add() as it preempts us
+   int published = active;
+   active = !published;
+
+   for (int i = 0; i < CHANNEL_COUNT; i++)
+   {
+      Accumulator& a = acc[published][i];
+
+      if (a.count > 0)
+      {
+         int32_t value = reductions[i] == AVG ? a.sum / a.count : a.value;
+
+         if (formats[i] == INT)
+            Param::SetInt(params[i], value);
+         else if (formats[i] == ANGLE)
+            Param::SetFlt(params[i], FP_FROMINT(value) / (65536 / 360));
+         else
+            Param::SetFlt(params[i], value);
+      }
+
+      a.count = 0;
+      a.sum = 0;
+   }
+}
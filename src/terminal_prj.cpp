@@ -29,8 +29,14 @@
 #include "errormessage.h"
 #include "pwmgeneration.h"
 #include "stm32_can.h"
+#include "isrbench.h"
+#include "inc_encoder.h"
+#include "stm32scheduler.h"
+#include "deferredwork.h"
+#include "cpuload.h"
 
 #define NUM_BUF_LEN 15
+#define BENCH_ITERATIONS 256
 
 static void ParamGet(char *arg);
 static void ParamStream(char *arg);
@@ -51,6 +57,8 @@ static void MapCan(char *arg);
 static void PrintErrors(char *arg);
 static void Reset(char *arg);
 static void FastUart(char *arg);
+static void RunBenchmark(char *arg);
+static void PrintTaskStats(char *arg);
 
 extern "C" const TERM_CMD TermCmds[] =
 {
@@ -73,6 +81,8 @@ extern "C" const TERM_CMD TermCmds[] =
   { "errors", PrintErrors },
   { "reset", Reset },
   { "fastuart", FastUart },
+  { "bench", RunBenchmark },
+  { "tasks", PrintTaskStats },
   { NULL, NULL }
 };
 
@@ -492,9 +502,19 @@ static void StartInverter(char *arg)
    s32fp val = fp_atoi(arg);
    if (val < FP_FROMINT(MOD_LAST))
    {
+      s32fp lastMode = Param::Get(Param::opmode);
+
       Param::SetFlt(Param::opmode, val);
-      PwmGeneration::SetOpmode(FP_TOINT(val));
-      printf("Inverter started\r\n");
+      //Ms10Task also switches the mode, so don't do it from the main loop
+      if (DeferredWork::Call(DeferredWork::MAIN, PwmGeneration::SetOpmode, FP_TOINT(val)))
+      {
+         printf("Inverter started\r\n");
+      }
+      else
+      {
+         Param::SetFlt(Param::opmode, lastMode);
+         printf("Inverter not started, deferred work queue full\r\n");
+      }
    }
    else
    {
@@ -509,6 +529,8 @@ static void SaveParameters(char *arg)
    printf("Parameters stored, CRC=%x\r\n", crc);
    Can::GetInterface(0)->Save();
    printf("CANMAP stored\r\n");
+   Encoder::SaveAngleCompensation();
+   printf("Angle compensation stored\r\n");
 }
 
 static void LoadParameters(char *arg)
@@ -523,6 +545,9 @@ static void LoadParameters(char *arg)
    {
       printf("Parameter CRC error\r\n");
    }
+
+   if (Encoder::LoadAngleCompensation())
+      printf("Angle compensation loaded\r\n");
 }
 
 static void PrintErrors(char *arg)
@@ -531,6 +556,45 @@ static void PrintErrors(char *arg)
    ErrorMessage::PrintAllErrors();
 }
 
+//bench [iterations]
+static void RunBenchmark(char *arg)
+{
+   int iterations = my_atoi(my_trim(arg));
+
+   IsrBench::Run(iterations > 0 ? iterations : BENCH_ITERATIONS);
+}
+
+//tasks [reset]
+static void PrintTaskStats(char *arg)
+{
+   Stm32Scheduler* scheduler = Stm32Scheduler::GetInstance();
+   Stm32Scheduler::TaskStats stats;
+
+   if (0 == scheduler) return;
+
+   arg = my_trim(arg);
+
+   if (arg[0] == 'r')
+   {
+      scheduler->ResetStats();
+      CpuLoad::ResetPeaks();
+      printf("Task statistics and load peaks cleared\r\n");
+      return;
+   }
+
+   printf("task period[us] last[us] min[us] avg[us] max[us] jitter[us] missed\r\n");
+
+   for (int i = 0; scheduler->GetStats(i, stats); i++)
+   {
+      printf("%d %d %d %d %d %d %d %d\r\n", i,
+             stats.period * SCHED_US_PER_TICK, stats.lastTime * SCHED_US_PER_TICK,
+             stats.minTime * SCHED_US_PER_TICK, stats.avgTime * SCHED_US_PER_TICK,
+             stats.maxTime * SCHED_US_PER_TICK, stats.maxJitter * SCHED_US_PER_TICK,
+             stats.missed);
+   }
+   printf("deferred work items dropped: %d\r\n", DeferredWork::GetDropped());
+}
+
 static void PrintSerial(char *arg)
 {
    arg = arg;
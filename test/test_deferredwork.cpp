@@ -0,0 +1,128 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deferredwork.h"
+#include "test_list.h"
+
+using namespace std;
+
+static int posts[ERROR_MESSAGE_LAST];
+static int sets[Param::PARAM_LAST];
+static s32fp setValues[Param::PARAM_LAST];
+
+//Stand-ins for the parts of libopeninv DeferredWork hands the work to
+void ErrorMessage::Post(ERROR_MESSAGE_NUM err)
+{
+   posts[err]++;
+}
+
+int Param::Set(Param::PARAM_NUM param, s32fp value)
+{
+   sets[param]++;
+   setValues[param] = value;
+   return 0;
+}
+
+static void ClearPosts()
+{
+   for (int i = 0; i < ERROR_MESSAGE_LAST; i++)
+      posts[i] = 0;
+}
+
+static void ClearSets()
+{
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+      sets[i] = setValues[i] = 0;
+}
+
+static void TestPersistentErrorDoesNotCrowdOut()
+{
+   int drains = 1;
+
+   ClearPosts();
+
+   //Current limit active for 1 s of 8.8 kHz PWM, drained every 1 ms
+   for (int cycle = 0; cycle < 8800; cycle++)
+   {
+      DeferredWork::PostError(DeferredWork::PWM, ERR_CURRENTLIMIT);
+
+      if (cycle == 4321)
+         DeferredWork::PostError(DeferredWork::PWM, ERR_SPIPARITY);
+      if ((cycle % 9) == 0)
+      {
+         DeferredWork::Drain();
+         drains++;
+      }
+   }
+   DeferredWork::Drain();
+
+   ASSERT(posts[ERR_SPIPARITY] == 1);
+   //At most one post per drain, the rest is coalesced
+   ASSERT(posts[ERR_CURRENTLIMIT] == drains);
+   ASSERT(DeferredWork::GetDropped() == 0);
+}
+
+static void TestRepostAfterDrain()
+{
+   ClearPosts();
+
+   DeferredWork::PostError(DeferredWork::FAULT, ERR_OVERCURRENT);
+   DeferredWork::PostError(DeferredWork::FAULT, ERR_OVERCURRENT);
+   DeferredWork::Drain();
+   DeferredWork::Drain();
+   ASSERT(posts[ERR_OVERCURRENT] == 1);
+
+   DeferredWork::PostError(DeferredWork::FAULT, ERR_OVERCURRENT);
+   DeferredWork::Drain();
+   ASSERT(posts[ERR_OVERCURRENT] == 2);
+}
+
+static void TestCanBurstIsApplied()
+{
+   ClearSets();
+
+   //Several full receive maps within one drain interval, every parameter is mapped
+   for (int frame = 0; frame < 4; frame++)
+   {
+      for (int i = 0; i < Param::PARAM_LAST; i++)
+         DeferredWork::SetParam(DeferredWork::CAN, (Param::PARAM_NUM)i, frame * 1000 + i);
+   }
+   DeferredWork::Drain();
+
+   int wrong = 0;
+
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      if (sets[i] != 1 || setValues[i] != 3000 + i)
+         wrong++;
+   }
+   ASSERT(wrong == 0);
+   ASSERT(DeferredWork::GetDropped() == 0);
+
+   //Nothing pending any more
+   DeferredWork::Drain();
+   ASSERT(sets[0] == 1);
+}
+
+void DeferredWorkTest::RunTest()
+{
+   TestPersistentErrorDoesNotCrowdOut();
+   TestRepostAfterDrain();
+   TestCanBurstIsApplied();
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "inc_encoder.h"
+#include "test_list.h"
+
+using namespace std;
+
+static void TestCountScale()
+{
+   int mismatches = 0;
+
+   for (uint32_t ppr = 8; ppr <= 8192; ppr++)
+   {
+      uint32_t counts = ppr * 4;
+      Encoder::CountScale scale = Encoder::CalcCountScale(counts);
+
+      for (uint32_t count = 0; count < counts; count++)
+      {
+         if (Encoder::ScaleCount(scale, count) != (count * 65536) / counts)
+            mismatches++;
+      }
+   }
+   ASSERT(mismatches == 0);
+}
+
+static void TestCountScalePowerOfTwo()
+{
+   Encoder::CountScale scale = Encoder::CalcCountScale(4096);
+
+   ASSERT(scale.factor == 0);
+   ASSERT(scale.shift == 4);
+   ASSERT(Encoder::ScaleCount(scale, 4095) == 65520);
+}
+
+static int AngleError(uint32_t pllAngle, uint16_t angle)
+{
+   int err = (int16_t)(angle - (pllAngle >> PLL_DIGITS));
+   return err < 0 ? -err : err;
+}
+
+static void TestPllMaxBandwidth()
+{
+   //ISR rate and lowest PWM frequency at 72 MHz
+   const uint32_t frqs[] = { 72000000 / 8192, 72000000 / 16384 };
+
+   for (uint32_t frq : frqs)
+   {
+      Encoder::PllGains gains = Encoder::CalcPllGains(1000, frq);
+      uint32_t angle = 0;
+      int32_t speed = 0;
+
+      ASSERT(gains.kp <= (1 << PLL_DIGITS));
+
+      //The largest possible error must pull the loop towards the sensor angle
+      Encoder::StepPll(angle, speed, gains, 32767);
+      ASSERT((int32_t)angle > 0);
+      ASSERT(speed > 0);
+
+      for (int i = 0; i < 1000; i++)
+         Encoder::StepPll(angle, speed, gains, 32767);
+      ASSERT(AngleError(angle, 32767) <= 1);
+
+      //Follow a rotor turning at 1000 digits per cycle
+      uint16_t rotor = 32767;
+
+      for (int i = 0; i < 1000; i++)
+      {
+         rotor += 1000;
+         Encoder::StepPll(angle, speed, gains, rotor);
+      }
+      ASSERT(AngleError(angle, rotor) <= 1);
+   }
+}
+
+void EncoderTest::RunTest()
+{
+   TestCountScale();
+   TestCountScalePowerOfTwo();
+   TestPllMaxBandwidth();
+}
@@ -24,6 +24,7 @@
 #include "sine_core.h"
 #include "test_list.h"
 #include "string.h"
+#include <math.h>
 
 using namespace std;
 
@@ -68,6 +69,61 @@ static void TestAtan2()
    ASSERT(SineCore::Atan2(2048, 3547) == 10922); //60°
 }
 
+static void TestSinCos()
+{
+   int maxErr = 0, maxErrLookup = 0;
+   s32fp sin, cos;
+
+   for (uint32_t angle = 0; angle < 65536; angle++)
+   {
+      double rad = angle * 2 * M_PI / 65536;
+      int sinErr, cosErr, lookupErr;
+
+      SineCore::SinCos(angle, sin, cos);
+      sinErr = sin - lround(32767 * ::sin(rad));
+      cosErr = cos - lround(32767 * ::cos(rad));
+      lookupErr = SineCore::Sine(angle) - lround(32767 * ::sin(rad));
+      maxErr = MAX(maxErr, ABS(sinErr));
+      maxErr = MAX(maxErr, ABS(cosErr));
+      maxErrLookup = MAX(maxErrLookup, ABS(lookupErr));
+   }
+
+   SineCore::SinCos(16384, sin, cos); //90°
+   ASSERT(sin == 32767 && cos == 0);
+   SineCore::SinCos(0x1234 & ~31, sin, cos); //table entries are not altered
+   ASSERT(sin == SineCore::Sine(0x1234 & ~31) && cos == SineCore::Cosine(0x1234 & ~31));
+   ASSERT(maxErr <= 2);
+   ASSERT(maxErrLookup > 50);
+}
+
+static void TestSqrt()
+{
+   bool exact = true;
+
+   //Integer Newton iterations fail at the edges of each root's interval,
+   //check both edges of every possible result
+   for (uint32_t root = 1; root < 65536; root++)
+   {
+      uint32_t square = root * root;
+      exact &= fp_isqrt(square) == root;
+      exact &= fp_isqrt(square - 1) == root - 1;
+   }
+   exact &= fp_isqrt(0xFFFFFFFF) == 65535;
+
+   //Every radicand that is normalised by the seed lookup
+   for (uint32_t rad = 0; rad < (1 << 20); rad++)
+   {
+      uint32_t root = fp_isqrt(rad);
+      exact &= root * root <= rad && (root + 1) * (root + 1) > rad;
+   }
+
+   ASSERT(exact);
+   ASSERT(fp_sqrt(FP_FROMINT(4)) == FP_FROMINT(2));
+   ASSERT(fp_sqrt(FP_FROMINT(2)) == FP_FROMFLT(1.41421356));
+   ASSERT(fp_sqrt_digits(2 << 15, 15) == (uint32_t)(1.41421356 * 32768));
+   ASSERT(fp_sqrt_digits(0xFFFFFFFF, 15) >> 15 == 362); //sqrt(131072)
+}
+
 static void TestLn()
 {
    //ASSERT(fp_ln(1) == 0);
@@ -82,5 +138,7 @@ void FPTest::RunTest()
    TestAtoi();
    TestMedian3();
    TestAtan2();
+   TestSinCos();
+   TestSqrt();
    TestLn();
 }
@@ -35,6 +35,30 @@ class FUTest: public IUnitTest
       virtual void RunTest();
 };
 
+class EncoderTest: public IUnitTest
+{
+   public:
+      virtual void RunTest();
+};
+
+class TimerWheelTest: public IUnitTest
+{
+   public:
+      virtual void RunTest();
+};
+
+class SpscQueueTest: public IUnitTest
+{
+   public:
+      virtual void RunTest();
+};
+
+class DeferredWorkTest: public IUnitTest
+{
+   public:
+      virtual void RunTest();
+};
+
 class ThrottleTest: public IUnitTest
 {
    public:
@@ -46,7 +70,11 @@ IUnitTest* testList[] =
 {
    new FPTest(),
    new FUTest(),
-   new ThrottleTest(),
+   new EncoderTest(),
+   new TimerWheelTest(),
+   new SpscQueueTest(),
+   new DeferredWorkTest(),
+   //ThrottleTest needs throttle.cpp, which this inverter does not use (torque comes via CAN)
    NULL
 };
 #endif
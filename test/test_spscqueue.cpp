@@ -0,0 +1,65 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spscqueue.h"
+#include "test_list.h"
+
+using namespace std;
+
+static void TestFullAndEmpty()
+{
+   SpscQueue<int, 4> q;
+   int item = 0;
+   bool ok = true;
+
+   ASSERT(!q.Get(item));
+
+   for (int i = 0; i < 4; i++)
+      ok = ok && q.Put(i);
+
+   ASSERT(ok && q.Count() == 4);
+   ASSERT(!q.Put(4));
+}
+
+static void TestOrderAcrossWrap()
+{
+   SpscQueue<int, 4> q;
+   int item, next = 0, errors = 0;
+
+   //Indexes wrap around the buffer many times
+   for (int i = 0; i < 1000; i++)
+   {
+      q.Put(2 * i);
+      q.Put(2 * i + 1);
+
+      while (q.Count() > 1 && q.Get(item))
+         errors += item != next++;
+   }
+
+   while (q.Get(item))
+      errors += item != next++;
+
+   ASSERT(errors == 0 && next == 2000);
+}
+
+void SpscQueueTest::RunTest()
+{
+   TestFullAndEmpty();
+   TestOrderAcrossWrap();
+}
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the tumanako_vc project.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "timerwheel.h"
+#include "test_list.h"
+
+using namespace std;
+
+static TimerWheel* wheel;
+static uint32_t lastRun[3];
+static int runs[3];
+static int periodErrors[3];
+static int phaseErrors;
+
+static void Record(int task, uint16_t period)
+{
+   uint32_t t = wheel->GetTicks();
+
+   if (runs[task] > 0 && t - lastRun[task] != period)
+      periodErrors[task]++;
+   lastRun[task] = t;
+   runs[task]++;
+}
+
+static void Task7() { Record(0, 7); if (wheel->GetTicks() % 7 != 3) phaseErrors++; }
+static void Task100() { Record(1, 100); if (wheel->GetTicks() % 100 != 50) phaseErrors++; }
+static void Task1000() { Record(2, 1000); if (wheel->GetTicks() % 1000 != 0) phaseErrors++; }
+
+static void ResetRecords()
+{
+   for (int i = 0; i < 3; i++)
+   {
+      runs[i] = 0;
+      periodErrors[i] = 0;
+   }
+   phaseErrors = 0;
+}
+
+static void TestPeriodsDoNotDrift()
+{
+   TimerWheel w;
+   wheel = &w;
+   ResetRecords();
+
+   w.AddPeriodic(Task7, 7, 3);
+   w.AddPeriodic(Task100, 100, 50);
+   w.AddPeriodic(Task1000, 1000);
+
+   for (int i = 0; i < 100000; i++)
+      w.Tick();
+
+   ASSERT(runs[0] == 14286 && runs[1] == 1000 && runs[2] == 100);
+   ASSERT(periodErrors[0] == 0 && periodErrors[1] == 0 && periodErrors[2] == 0);
+   ASSERT(phaseErrors == 0);
+}
+
+static void TestPhaseAfterStart()
+{
+   TimerWheel w;
+   wheel = &w;
+   ResetRecords();
+
+   for (int i = 0; i < 1234; i++)
+      w.Tick();
+
+   //Added late, still lands on the same ticks as if added at start
+   w.AddPeriodic(Task100, 100, 50);
+
+   for (int i = 0; i < 10000; i++)
+      w.Tick();
+
+   ASSERT(runs[1] == 100 && lastRun[1] == 11150);
+   ASSERT(periodErrors[1] == 0 && phaseErrors == 0);
+}
+
+static void OneShot() { Record(0, 0); }
+
+static void TestOneShot()
+{
+   TimerWheel w;
+   wheel = &w;
+   ResetRecords();
+
+   w.AddOneShot(OneShot, 40);
+
+   for (int i = 0; i < 200; i++)
+      w.Tick();
+
+   ASSERT(runs[0] == 1 && lastRun[0] == 40);
+}
+
+static int removeHandle;
+static void RemoveSelf() { runs[0]++; wheel->Remove(removeHandle); }
+
+static void TestRemove()
+{
+   TimerWheel w;
+   wheel = &w;
+   ResetRecords();
+
+   removeHandle = w.AddPeriodic(RemoveSelf, WHEEL_SLOTS);
+
+   for (int i = 0; i < 10 * WHEEL_SLOTS; i++)
+      w.Tick();
+
+   ASSERT(runs[0] == 1);
+
+   //All timers are free again afterwards
+   int handles = 0;
+   while (w.AddOneShot(OneShot, 1) >= 0 && handles <= WHEEL_MAX_TIMERS)
+      handles++;
+   ASSERT(handles == WHEEL_MAX_TIMERS);
+}
+
+void TimerWheelTest::RunTest()
+{
+   TestPeriodsDoNotDrift();
+   TestPhaseAfterStart();
+   TestOneShot();
+   TestRemove();
+}